@@ -0,0 +1,139 @@
+#ifndef _BENCH_POLICIES_H_
+#define _BENCH_POLICIES_H_
+
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// the dynamic workload of test.cpp, shared by the benchmark of each allocation
+// and synchronization policy instantiation (test_new, test_malloc, test_malloc_STM,
+// test_CAS_STM) and of each engine (test_engines) so their times compare directly
+
+#define POLICY_OPERATIONS_PER_THREAD 62500
+#define POLICY_THREADS 8
+#define POLICY_INSERT_WEIGHT 5
+#define POLICY_DELETE_WEIGHT 5
+#define POLICY_SEARCH_WEIGHT 90
+
+#define POLICY_KEY_LENGTH 7
+
+typedef FixedKey<POLICY_KEY_LENGTH + 1> PolicyKey;
+
+template <class Tree>
+struct PolicyArgs
+{
+    Tree *mTree;
+    int mPid;
+    unsigned int mSeed;
+    // percentages of searches, inserts and deletes
+    uint32_t mSearchWeight;
+    uint32_t mInsertWeight;
+    uint32_t mDeleteWeight;
+};
+
+// 7 random lowercase characters, as in test.cpp
+inline void random_key(char *buffer, unsigned int *seed)
+{
+    for(int i=0; i<POLICY_KEY_LENGTH; i++) {
+        buffer[i] = rand_r(seed) % ('z' - 'a') + 'a';
+    }
+
+    buffer[POLICY_KEY_LENGTH] = '\0';
+}
+
+template <class Tree>
+void *policy_worker(void *args)
+{
+    PolicyArgs<Tree> *myArgs = (PolicyArgs<Tree> *) args;
+    uint32_t sw = myArgs->mSearchWeight;
+    uint32_t iw = myArgs->mInsertWeight + sw;
+    uint32_t dw = myArgs->mDeleteWeight + iw;
+    char buffer[POLICY_KEY_LENGTH + 1];
+
+    for(int i=0; i<POLICY_OPERATIONS_PER_THREAD; i++) {
+        uint32_t roll = rand_r(&myArgs->mSeed) % dw;
+        random_key(buffer, &myArgs->mSeed);
+        PolicyKey key (buffer);
+
+        if(roll < sw) {
+            myArgs->mTree->Search(key, myArgs->mPid);
+        }
+        else if(roll < iw) {
+            myArgs->mTree->InsertOrUpdate(key, std::string(buffer), myArgs->mPid);
+        }
+        else {
+            myArgs->mTree->Delete(key, myArgs->mPid);
+        }
+    }
+
+    myArgs->mTree->Quiesce(myArgs->mPid);
+    return nullptr;
+}
+
+// runs the workload with the given mix on tree and returns the elapsed time in ms
+template <class Tree>
+uint64 run_policy_workload(Tree *tree, uint32_t searchWeight, uint32_t insertWeight, uint32_t deleteWeight)
+{
+    pthread_t *threads = (pthread_t *) malloc(POLICY_THREADS * sizeof(pthread_t));
+    PolicyArgs<Tree> *args = (PolicyArgs<Tree> *) malloc(POLICY_THREADS * sizeof(PolicyArgs<Tree>));
+
+    unsigned int seed = time(NULL);
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i = 0; i < POLICY_THREADS; i++) {
+        args[i] = {tree, i, seed + i, searchWeight, insertWeight, deleteWeight};
+        pthread_create(&threads[i], NULL, policy_worker<Tree>, (void *) &args[i]);
+    }
+
+    for(int i = 0; i < POLICY_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64 time_elapsed = GetTimeMs64() - time_start;
+
+    free(args);
+    free(threads);
+    return time_elapsed;
+}
+
+// runs the workload on a ConcurrentTree with the given policies and prints the elapsed time
+template <class AllocPolicy, class SyncPolicy>
+int run_policy_benchmark(const char *name)
+{
+    typedef ConcurrentTree<PolicyKey, std::string, std::less<PolicyKey>, AllocPolicy, SyncPolicy> Tree;
+
+    Tree *tree = new Tree(POLICY_THREADS);
+    uint64 time_elapsed = run_policy_workload(tree, POLICY_SEARCH_WEIGHT, POLICY_INSERT_WEIGHT, POLICY_DELETE_WEIGHT);
+
+    WindowCounters counters = tree->GetWindowCounters();
+    std::cout << name << ": " << time_elapsed << " ms, "
+              << time_elapsed * 1000000.0 / (POLICY_THREADS * POLICY_OPERATIONS_PER_THREAD) << " ns per op, "
+              << counters.mCheap << " cheap / " << counters.mFull << " full window transactions" << std::endl;
+
+#ifdef _TL2_STM_HPP_
+    // the built-in STM's commits against the attempts it had to run again
+    if(std::is_same<SyncPolicy, TMSync>::value) {
+        TL2Counters stm = GetTL2Counters();
+        std::cout << "  " << stm.mCommits << " transactions committed, " << stm.mAborts << " aborted" << std::endl;
+    }
+#endif
+
+    return 0;
+}
+
+// runs the workload with the given mix on a fresh instance of an engine and prints the elapsed time
+template <class Tree>
+void run_engine_benchmark(const char *name, uint32_t searchWeight, uint32_t insertWeight, uint32_t deleteWeight)
+{
+    Tree *tree = new Tree(POLICY_THREADS);
+    uint64 time_elapsed = run_policy_workload(tree, searchWeight, insertWeight, deleteWeight);
+
+    std::cout << name << " " << searchWeight << "/" << insertWeight << "/" << deleteWeight << ": "
+              << time_elapsed << " ms, " << time_elapsed * 1000000.0 / (POLICY_THREADS * POLICY_OPERATIONS_PER_THREAD)
+              << " ns per op" << std::endl;
+}
+
+#endif
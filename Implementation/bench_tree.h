@@ -0,0 +1,80 @@
+// Helpers shared by the single-threaded microbenchmarks. The trees are built
+// directly as balanced external trees (no window transactions) over the keys
+// 0 .. numKeys-1, so lookups are measured independently of the modify path.
+
+#ifndef _BENCH_TREE_H_
+#define _BENCH_TREE_H_
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+// every key maps to this value
+uint64_t bench_value = 1;
+
+// opens a hardware cache-miss counter for this thread, -1 if unavailable
+int open_cache_miss_counter()
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// builds the subtree holding keys [lo, hi) and hangs it off the given link
+void build(PointerNode<DataNode<uint64_t, uint64_t>, Flag> *pLink, uint64_t lo, uint64_t hi, uint32_t bucketSize)
+{
+    DataNode<uint64_t, uint64_t> *dNode = DataNode<uint64_t, uint64_t>::Allocate();
+    dNode->InitializeDataNode();
+    dNode->SetSentinel(false);
+
+    if(bucketSize != 0 && hi - lo <= bucketSize) {
+        dNode->mKey = hi - 1;
+        dNode->mValData->InitializeValueRecord(bench_value);
+        dNode->mBucket = LeafBucket<uint64_t, uint64_t>::Allocate<MallocAlloc>(bucketSize);
+        for(uint64_t key=lo; key<hi; key++) {
+            dNode->mBucket->mKeys[key - lo] = key;
+            dNode->mBucket->mValues[key - lo] = dNode->mValData;
+        }
+        dNode->mBucket->mCount = hi - lo;
+    }
+    else if(hi - lo == 1) {
+        dNode->mKey = lo;
+        dNode->mValData->InitializeValueRecord(bench_value);
+    }
+    else {
+        uint64_t mid = lo + (hi - lo) / 2;
+        dNode->mKey = mid;
+        build(&dNode->mLeft, lo, mid, bucketSize);
+        build(&dNode->mRight, mid, hi, bucketSize);
+    }
+
+    pLink->InitializePointerNode(dNode, Flag::FREE);
+}
+
+Tree *build_tree(uint64_t numKeys, uint32_t bucketSize)
+{
+    Tree *tree = new Tree(1, std::less<uint64_t>(), bucketSize);
+
+    // the root sentinel keeps every finite key in its left subtree
+    DataNode<uint64_t, uint64_t> *dRoot = tree->pRoot->unpack();
+    DataNode<uint64_t, uint64_t> *dSentinelLeaf = DataNode<uint64_t, uint64_t>::Allocate();
+    dSentinelLeaf->InitializeDataNode();
+
+    dRoot->mBucket = nullptr;
+    build(&dRoot->mLeft, 0, numKeys, bucketSize);
+    dRoot->mRight.InitializePointerNode(dSentinelLeaf, Flag::FREE);
+
+    return tree;
+}
+
+#endif
@@ -1,7 +1,17 @@
+#ifndef _CONCURRENT_HPP_
+#define _CONCURRENT_HPP_
+
 #include <memory>
 #include <pthread.h>
+#include <sched.h>
 #include <climits>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <string>
+#include <type_traits>
 
 void print_bits(uint64_t data)
 {
@@ -21,27 +31,72 @@ void print_bits(uint64_t data)
     std::cout << std::endl;
 }
 
+#define CACHE_LINE_SIZE 64
+
+// number of traversals MultiSearch advances in lock-step
+#define MULTI_SEARCH_GROUP 16
+
+// deepest level the top index may cover, and the fraction (1/n) of its entries
+// that may go stale before a lookup rebuilds it
+#define MAX_TOP_INDEX_DEPTH 16
+#define TOP_INDEX_STALE_FRACTION 8
+
+// levels between a finger and the leaf it was recorded for
+#define FINGER_HEIGHT 4
+
+// split of a data node's owner word into operation pointer, sequence number and
+// the node's flags, which no acquire or release of the window changes
+#define OWNER_POINTER_MASK (((uint64_t) 1 << 48) - 1)
+#define OWNER_SEQUENCE_ONE ((uint64_t) 1 << 48)
+#define OWNER_SEQUENCE_MASK (((uint64_t) 1 << 61) - OWNER_SEQUENCE_ONE)
+#define NODE_RED ((uint64_t) 1 << 61)
+#define NODE_SENTINEL ((uint64_t) 1 << 62)
+#define NODE_REPLACED ((uint64_t) 1 << 63)
+#define NODE_FLAGS (NODE_RED | NODE_SENTINEL | NODE_REPLACED)
+
+// no thread owns the tree alone; every operation runs the wait-free protocol
+#define NO_SINGLE_OWNER UINT32_MAX
+
+// most levels above the edge leaf a sprayed PopMin or PopMax may start its random descent from
+#define MAX_SPRAY_LEVELS 8
+
+// random descents, besides the two spines, that estimate a subtree's height for Join
+#define JOIN_HEIGHT_DESCENTS 8
+
+// decision of an insert that found no expired record to take over
+#define NOT_DISPLACED ((DataNode<K, V> *) 1)
+
+#include "leaf_bucket.hpp"
+#include "hot_key_cache.hpp"
+#include "negative_filter.hpp"
+#include "helping_policy.hpp"
+#include "value_arena.hpp"
+#include "word_value.hpp"
+#include "tree_policies.hpp"
+#include "transaction_locks.hpp"
+#include "relaxed_balance.hpp"
+#include "thread_counters.hpp"
+#include "expiration.hpp"
+#include "hash_index.hpp"
+
 // #define PointerNode PackedPointer
 // #define NextNode PackedPointer
 // #define StateNode PackedPointer
 
 enum Status {NO_STATUS = -1, WAITING = 0, IN_PROGRESS = 1, COMPLETED = 2};
 enum Flag {FREE = 0, OWNED = 1};
-enum Type {SEARCH, INSERT, UPDATE, DELETE};
+enum Type {SEARCH, INSERT, UPDATE, DELETE, REBALANCE, RESHARD};
 enum Color {RED, BLACK, UNCOLORED};
 enum Gate {VALUE};
 
-template <class V>
+template <class K, class V>
 class DataNode;
 
-template <class V>
-class ValueRecord;
-
 template <class T, class U>
 class PointerNode;
 
-template <class V>
-union Position {PointerNode<DataNode<V>, Flag> *windowLocation; ValueRecord<V> *valueRecord;};
+template <class K, class V>
+union Position {PointerNode<DataNode<K, V>, Flag> *windowLocation; DataNode<K, V> *window; ValueRecord<V> *valueRecord;};
 
 // TODO: use LSB instead of MSB for pointer packing because of segfaulting
 // std::align is helpful for guaranteeing memory alignment
@@ -78,7 +133,6 @@ public:
 
     void InitializeStateNode(T *packedPointer, U tag)
     {
-        mPackedPointer = (T *) malloc(sizeof(T));
         uint64_t mask = (uint64_t) 0b11 << 62;
         mPackedPointer = (T*) ((uint64_t) packedPointer & (~mask));
         mask = (uint64_t) tag << 62;
@@ -95,7 +149,7 @@ public:
     T *unpack()
     {
         uint64_t remove_tag = (uint64_t) 0b11 << 62;
-        T *pointer = (T *) ((uint64_t) mPackedPointer & remove_tag);
+        T *pointer = (T *) ((uint64_t) mPackedPointer & (~remove_tag));
         return pointer;
     }
 
@@ -103,7 +157,7 @@ public:
     {
         uint64_t remove_tag = (uint64_t) 0b11 << 62;
         StateNode<T, U> *pointer = this;
-        pointer = (StateNode<T, U> *) ((uint64_t) pointer & remove_tag);
+        pointer = (StateNode<T, U> *) ((uint64_t) pointer & (~remove_tag));
         return pointer;
     }
 
@@ -167,7 +221,6 @@ public:
 
     void InitializeNextNode(T *packedPointer, U tag)
     {
-        mPackedPointer = (T *) malloc(sizeof(T));
         uint64_t mask = (uint64_t) 0b11 << 62;
         mPackedPointer = (T*) ((uint64_t) packedPointer & (~mask));
         mask = (uint64_t) tag << 62;
@@ -184,7 +237,7 @@ public:
     T *unpack()
     {
         uint64_t remove_tag = (uint64_t) 0b11 << 62;
-        T *pointer = (T *) ((uint64_t) mPackedPointer & remove_tag);
+        T *pointer = (T *) ((uint64_t) mPackedPointer & (~remove_tag));
         return pointer;
     }
 
@@ -192,7 +245,7 @@ public:
     {
         uint64_t remove_tag = (uint64_t) 0b11 << 62;
         NextNode<T, U> *pointer = this;
-        pointer = (NextNode<T, U> *) ((uint64_t) pointer & remove_tag);
+        pointer = (NextNode<T, U> *) ((uint64_t) pointer & (~remove_tag));
         return pointer;
     }
 
@@ -259,7 +312,6 @@ public:
 
     void InitializePointerNode(T *packedPointer, U tag)
     {
-        mPackedPointer = (T *) malloc(sizeof(T));
         uint64_t mask = (uint64_t) 0b11 << 62;
         mPackedPointer = (T*) ((uint64_t) packedPointer & (~mask));
         mask = (uint64_t) tag << 62;
@@ -276,7 +328,7 @@ public:
     T *unpack()
     {
         uint64_t remove_tag = (uint64_t) 0b11 << 62;
-        T *pointer = (T *) ((uint64_t) mPackedPointer & remove_tag);
+        T *pointer = (T *) ((uint64_t) mPackedPointer & (~remove_tag));
         return pointer;
     }
 
@@ -284,7 +336,7 @@ public:
     {
         uint64_t remove_tag = (uint64_t) 0b11 << 62;
         PointerNode<T, U> *pointer = this;
-        pointer = (PointerNode<T, U> *) ((uint64_t) pointer & remove_tag);
+        pointer = (PointerNode<T, U> *) ((uint64_t) pointer & (~remove_tag));
         return pointer;
     }
 
@@ -322,133 +374,928 @@ public:
     }
 };
 
-template <class V>
+template <class V, bool Word>
 class ValueRecord
 {
 public:
     V *mValue;
+    // version of mValue used like a seqlock: odd while a write is in progress,
+    // advanced by two by every completed write
     uint32_t mGate;
+    // negative filter generation the key was counted in; claimed by the delete that uncounts it
+    uint32_t mFilterGeneration;
+    // mValue is a copy owned by the tree, in mInline or an arena slot, rather than
+    // the caller's pointer; only read and written under the gate
+    bool mOwned;
+    // the first owned value of a small value type lives here, so a short
+    // std::string is one allocation together with its record
+    alignas(V) unsigned char mInline[ValueArena<V>::INLINE ? sizeof(V) : 1];
+    // the insert operation that built the record, so it can tell its own record
+    // from one built by a concurrent insert of the same key
+    const void *mInserter;
+    // tick from which the record reads as absent (expiration.hpp), NO_EXPIRATION if
+    // none; EXPIRATION_DEAD once a thread acted on its expiry, EXPIRATION_UNLINKED
+    // once a delete removed the key, so the hash index stops answering with the record
+    uint32_t mExpires;
 
     ValueRecord(V *value, uint32_t gate)
     {
-        mValue = value;
-        mGate = gate;
+        InitializeValueRecord(value, gate);
     }
 
     void InitializeValueRecord(V *value, uint32_t gate)
     {
         mValue = value;
         mGate = gate;
+        mFilterGeneration = NO_FILTER_GENERATION;
+        mOwned = false;
+        mInserter = nullptr;
+        mExpires = NO_EXPIRATION;
+    }
+
+    // starts the record with its own copy of value, stored inline
+    void InitializeInlineValueRecord(const V &value, uint32_t gate)
+    {
+        static_assert(ValueArena<V>::INLINE, "value type is too large to be stored inline");
+        InitializeValueRecord(new (mInline) V(value), gate);
+        mOwned = true;
+    }
+
+    V *InlineValue()
+    {
+        return (V *) mInline;
+    }
+
+    // optimistic read that takes no lock and writes nothing shared; if gate is
+    // given it receives the version the value was read at, for WriteValue
+    V *ReadValue(uint32_t *gate = nullptr)
+    {
+        while(true) {
+            uint32_t before = __atomic_load_n(&mGate, __ATOMIC_ACQUIRE);
+            if((before & 1) != 0) {
+                continue;
+            }
+
+            V *value = __atomic_load_n(&mValue, __ATOMIC_RELAXED);
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&mGate, __ATOMIC_RELAXED) == before) {
+                if(gate != nullptr) {
+                    *gate = before;
+                }
+                return value;
+            }
+        }
+    }
+
+    // installs value only if no write has completed or started since the read
+    // that returned gate; false means a conflicting update got there first.
+    // on success replaced receives the previous value if the tree owned it, for
+    // the writer to retire, and nullptr otherwise
+    bool WriteValue(V *value, uint32_t gate, bool owned = false, V **replaced = nullptr)
+    {
+        if((gate & 1) != 0 || !__sync_bool_compare_and_swap(&mGate, gate, gate + 1)) {
+            return false;
+        }
+
+        if(replaced != nullptr) {
+            *replaced = mOwned ? mValue : nullptr;
+        }
+
+        __atomic_store_n(&mValue, value, __ATOMIC_RELAXED);
+        mOwned = owned;
+        __atomic_store_n(&mGate, gate + 2, __ATOMIC_RELEASE);
+        return true;
     }
 };
 
+// record of a word-sized value, which is the value itself rather than a pointer
+// to it, so a read is one load and an update one CAS. with mInline, the gate
+// and the insert tag gone it fits in the search line of a leaf
 template <class V>
+class ValueRecord<V, true>
+{
+public:
+    alignas(sizeof(V)) V mValue;
+    // negative filter generation the key was counted in; claimed by the delete that uncounts it
+    uint32_t mFilterGeneration;
+    // expiration stamp, as in the generic record
+    uint32_t mExpires;
+
+    void InitializeValueRecord(const V &value)
+    {
+        mValue = value;
+        mFilterGeneration = NO_FILTER_GENERATION;
+        mExpires = NO_EXPIRATION;
+    }
+
+    // the value in place; reads through the pointer see later updates
+    V *ReadValue()
+    {
+        return &mValue;
+    }
+
+    V LoadValue()
+    {
+        V value;
+        __atomic_load(&mValue, &value, __ATOMIC_ACQUIRE);
+        return value;
+    }
+
+    // installs value if the record still holds *expected, otherwise loads the
+    // current value into *expected
+    bool CompareExchange(V *expected, V value)
+    {
+        return __atomic_compare_exchange(&mValue, expected, &value, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE);
+    }
+};
+
+template <class K, class V>
 class OperationRecord
 {
 public:
     Type mType;
-    uint32_t mKey;
+    K mKey;
     uint32_t mPid;
+    // negative filter generation an insert counted its key in, FILTER_GENERATION_UNDECIDED
+    // until a window transaction finds out whether the key is absent
+    uint32_t mFilterGeneration;
+    // expiration stamp of the record an insert builds
+    uint32_t mExpires;
     V *mValue;
-    StateNode<Position<V>, Status> *mState;
-
-    OperationRecord(Type type, uint32_t key, V *value)
+    // mValue is to be copied into tree-owned storage: inline for small value types,
+    // otherwise it already is the operation's arena copy
+    bool mOwnedValue;
+    // a word-sized value itself, copied in when the operation is created so that
+    // a stale helper never reads the caller's copy
+    alignas(8) unsigned char mWordValue[8];
+    StateNode<Position<K, V>, Status> *mState;
+    // outcome of the final window transaction, published before its window is released
+    Position<K, V> *mResult;
+    // record of the leaf a delete unlinks, noted before its replacement is installed
+    ValueRecord<V> *mRemoved;
+    // a delete only removes the key while it still holds this record, unless it is null
+    ValueRecord<V> *mExpected;
+    // the leaf whose expired record an insert takes over, or NOT_DISPLACED; decided
+    // once by the first helper to look, so every helper builds the same replacement
+    DataNode<K, V> *mDisplaced;
+    // an insert built the key's record rather than finding one; set by the helpers
+    // that build it, for a word record, which has no room to name its inserter
+    bool mInserted;
+    // in relaxed-balance mode, the insert hung a red node below a red one; set by the
+    // helpers that build the replacement, like mInserted
+    bool mViolation;
+    // window transactions that slid the window down without copying, and ones that restructured it
+    uint32_t mCheapTransactions;
+    uint32_t mFullTransactions;
+    // a rebalancing operation rotates this node, right (its left child moves up) or left
+    DataNode<K, V> *mRotate;
+    bool mRotateRight;
+
+    // state comes from the tree's allocation policy; an operation applied by the
+    // single owner of a tree is never published, so it has none
+    OperationRecord(Type type, const K &key, V *value, StateNode<Position<K, V>, Status> *state)
     {
-        InitializeOperationRecord(type, key, value);
+        InitializeOperationRecord(type, key, value, state);
     }
 
-    void InitializeOperationRecord(Type type, uint32_t key, V *value)
+    void InitializeOperationRecord(Type type, const K &key, V *value, StateNode<Position<K, V>, Status> *state)
     {
         mType = type;
         mKey = key;
         mValue = value;
+        mOwnedValue = false;
         mPid = -1;
-
-        mState = (StateNode<Position<V>, Status> *) malloc(sizeof(StateNode<Position<V>, Status>));
-        mState->InitializeStateNode();
+        mFilterGeneration = NO_FILTER_GENERATION;
+        mResult = nullptr;
+        mRemoved = nullptr;
+        mExpected = nullptr;
+        mDisplaced = nullptr;
+        mInserted = false;
+        mViolation = false;
+        mExpires = NO_EXPIRATION;
+        mCheapTransactions = 0;
+        mFullTransactions = 0;
+        mRotate = nullptr;
+        mRotateRight = false;
+
+        mState = state;
     }
 };
 
-template <class V>
-class DataNode
+// hot/cold split: a node is one cache line holding the fields Traverse reads.
+// the metadata of window transactions is packed into the top of the owner word
+// at the start of that line rather than given a line of its own, which would
+// double every node. the child pointer nodes are embedded and CASed in place; a
+// null child is a link whose packed pointer is null. since copying a node would
+// move links that operations further down may be working on, a window is owned
+// through the owner word of its root node rather than by swapping in a copy
+template <class K, class V>
+class alignas(CACHE_LINE_SIZE) DataNode
 {
 public:
-    Color mColor;
-    uint32_t mKey;
+    // the operation whose window is rooted at this node in the low 48 bits, a
+    // sequence number bumped by every acquire and release in the next 13, so a
+    // stale helper's CAS on a word it read earlier cannot succeed, and the flags:
+    // NODE_SENTINEL, as sentinel nodes sort above every finite key, so no key value
+    // is reserved; NODE_REPLACED, set before a window transaction swaps in the copy
+    // of this node, so holders of a link embedded in this node can tell that the
+    // link is no longer live; and NODE_RED, the node's colour
+    uint64_t mOwner;
+    K mKey;
+    PointerNode<DataNode<K, V>, Flag> mLeft;
+    PointerNode<DataNode<K, V>, Flag> mRight;
+    // sorted keys of a leaf when the tree runs with leaf buckets, null otherwise
+    LeafBucket<K, V> *mBucket;
+    // the record of a leaf's key: mRecord, or the record of the leaf this one was cloned from
     ValueRecord<V> *mValData;
-    OperationRecord<V> *mOpData;
-
-    PointerNode<DataNode<V>, Flag> *mLeft;
-    PointerNode<DataNode<V>, Flag> *mRight;
+    // embedded so that a leaf's value is not a separate allocation; a word-sized
+    // record shares the search line with a key of up to eight bytes
+    ValueRecord<V> mRecord;
 
-    NextNode<Position<V>, Status> *mNext;
-    
     // defaults to sentinel values
     DataNode()
     {
-        mColor = BLACK;
-        mKey = UINT32_MAX;
+        InitializeDataNode();
+    }
+
+    // malloc only guarantees 16-byte alignment
+    static DataNode<K, V> *Allocate()
+    {
+        return (DataNode<K, V> *) aligned_alloc(alignof(DataNode<K, V>), sizeof(DataNode<K, V>));
+    }
+
+    void InitializeDataNode()
+    {
+        mOwner = NODE_SENTINEL;
+        new (&mKey) K();
         //mValData = new ValueRecord<V>(nullptr, 0);
-        mValData = (ValueRecord<V> *) malloc(sizeof(ValueRecord<V>));
+        mValData = &mRecord;
+
+        mLeft.mPackedPointer = nullptr;
+        mRight.mPackedPointer = nullptr;
+        mBucket = nullptr;
+    }
+
+    // the flags never change while the word is shared, except NODE_REPLACED, which
+    // the tree sets through its SyncPolicy (SetReplaced), and NODE_RED, which the
+    // rebalancer changes while no window is rooted at the node (Recolor); the rest
+    // are set before publishing
+    bool Sentinel()
+    {
+        return (__atomic_load_n(&mOwner, __ATOMIC_RELAXED) & NODE_SENTINEL) != 0;
+    }
+
+    void SetSentinel(bool sentinel)
+    {
+        mOwner = sentinel ? mOwner | NODE_SENTINEL : mOwner & ~NODE_SENTINEL;
+    }
+
+    bool Replaced()
+    {
+        return (__atomic_load_n(&mOwner, __ATOMIC_ACQUIRE) & NODE_REPLACED) != 0;
+    }
+
+    bool Red()
+    {
+        return (__atomic_load_n(&mOwner, __ATOMIC_RELAXED) & NODE_RED) != 0;
+    }
 
-        mLeft = nullptr;
-        mRight = nullptr;
-        mOpData = nullptr;
-        mNext = nullptr;
+    void SetColor(Color color)
+    {
+        mOwner = color == RED ? mOwner | NODE_RED : mOwner & ~NODE_RED;
+    }
+
+    static OperationRecord<K, V> *OwnerOf(uint64_t owner)
+    {
+        return (OperationRecord<K, V> *) (owner & OWNER_POINTER_MASK);
+    }
+
+    static uint64_t NextOwner(uint64_t owner, OperationRecord<K, V> *opData)
+    {
+        return (owner & NODE_FLAGS) | ((owner + OWNER_SEQUENCE_ONE) & OWNER_SEQUENCE_MASK) | (uint64_t) opData;
     }
 
-    DataNode *clone()
+    // copies the node into memory from the tree's allocation policy
+    DataNode *clone(void *memory)
     {
         //DataNode *copy = new DataNode();
-        DataNode *copy = (DataNode<V> *) malloc(sizeof(DataNode<V>));
-        copy->mColor = mColor;
-        copy->mKey = mKey;
+        DataNode *copy = (DataNode<K, V> *) memory;
+        copy->mOwner = __atomic_load_n(&mOwner, __ATOMIC_RELAXED) & (NODE_RED | NODE_SENTINEL);
+        new (&copy->mKey) K(mKey);
         copy->mValData = mValData;
-        copy->mLeft = mLeft;
-        copy->mRight = mRight;
+        copy->mLeft.mPackedPointer = mLeft.mPackedPointer;
+        copy->mRight.mPackedPointer = mRight.mPackedPointer;
+        copy->mBucket = mBucket;
         return copy;
     }
+
+    bool isLeaf()
+    {
+        return mLeft.mPackedPointer == nullptr && mRight.mPackedPointer == nullptr;
+    }
+
+    // the link in this node that corresponds to pChild in dOriginal, which this node was cloned from
+    PointerNode<DataNode<K, V>, Flag> *translateLink(DataNode<K, V> *dOriginal, PointerNode<DataNode<K, V>, Flag> *pChild)
+    {
+        if(pChild == &dOriginal->mLeft) {
+            return &mLeft;
+        }
+        else if(pChild == &dOriginal->mRight) {
+            return &mRight;
+        }
+
+        return pChild;
+    }
 };
 
-template <class V>
+// fixed-width byte string key; shorter strings are zero padded so that
+// comparison is a single memcmp over the whole buffer
+template <size_t N>
+struct FixedKey
+{
+    char mBytes[N];
+
+    FixedKey()
+    {
+        memset(mBytes, 0, N);
+    }
+
+    FixedKey(const char *str, size_t length)
+    {
+        memset(mBytes, 0, N);
+        memcpy(mBytes, str, length < N ? length : N);
+    }
+
+    FixedKey(const char *str) : FixedKey(str, strlen(str)) {}
+
+    FixedKey(const std::string &str) : FixedKey(str.data(), str.size()) {}
+
+    int compare(const FixedKey<N> &other) const
+    {
+        return memcmp(mBytes, other.mBytes, N);
+    }
+
+    bool operator<(const FixedKey<N> &other) const { return compare(other) < 0; }
+    bool operator==(const FixedKey<N> &other) const { return compare(other) == 0; }
+
+    // heterogeneous comparisons, used through transparent comparators such as std::less<>
+    friend bool operator<(const FixedKey<N> &key, const std::string &str) { return key < FixedKey<N>(str); }
+    friend bool operator<(const std::string &str, const FixedKey<N> &key) { return FixedKey<N>(str) < key; }
+};
+
+// array copy of the upper levels of the tree: the links found at a fixed depth,
+// in key order, with the routing keys that separate them. an entry is usable
+// while the data node holding its link has not been replaced
+template <class K, class V>
+class TopIndex
+{
+public:
+    uint64_t mVersion;
+    uint32_t mCount;
+    // lookups that found their entry replaced since the build
+    uint32_t mStale;
+    // mCount - 1 separators; a sentinel separator sorts above every key
+    K *mSeparators;
+    bool *mSentinelSeparators;
+    DataNode<K, V> **mParents;
+    PointerNode<DataNode<K, V>, Flag> **mLinks;
+
+    void InitializeTopIndex(uint32_t capacity)
+    {
+        mVersion = 0;
+        mCount = 0;
+        mStale = 0;
+        mSeparators = (K *) malloc(sizeof(K) * capacity);
+        mSentinelSeparators = (bool *) malloc(sizeof(bool) * capacity);
+        mParents = (DataNode<K, V> **) malloc(sizeof(DataNode<K, V> *) * capacity);
+        mLinks = (PointerNode<DataNode<K, V>, Flag> **) malloc(sizeof(PointerNode<DataNode<K, V>, Flag> *) * capacity);
+    }
+};
+
+// one link taken on the way down, with the bounds of the subtree below it;
+// a null bound is unbounded
+template <class K, class V>
+struct FingerStep
+{
+    DataNode<K, V> *mParent;
+    PointerNode<DataNode<K, V>, Flag> *mLink;
+    const K *mLow;
+    const K *mHigh;
+};
+
+// per-thread hint remembering a link a few levels above the last leaf the
+// thread reached, and the key range [mLow, mHigh) below it. like a top index
+// entry, it is usable while the data node holding the link has not been replaced
+// and no Split or Join has moved subtrees since it was recorded. only its owner
+// thread reads or writes it
+template <class K, class V>
+struct alignas(CACHE_LINE_SIZE) Finger
+{
+    DataNode<K, V> *mParent;
+    PointerNode<DataNode<K, V>, Flag> *mLink;
+    bool mHasLow;
+    bool mHasHigh;
+    K mLow;
+    K mHigh;
+    // mReshards of the tree when the path was read
+    uint64_t mReshards;
+    // searches that started from the finger, and searches that could not
+    uint64_t mHits;
+    uint64_t mMisses;
+
+    void InitializeFinger()
+    {
+        mParent = nullptr;
+        mLink = nullptr;
+        mHasLow = false;
+        mHasHigh = false;
+        new (&mLow) K();
+        new (&mHigh) K();
+        mReshards = 0;
+        mHits = 0;
+        mMisses = 0;
+    }
+};
+
+// searches that started from a finger and ones that could not, summed over the threads
+struct FingerCounters
+{
+    uint64_t mHits;
+    uint64_t mMisses;
+};
+
+struct WindowCounters
+{
+    uint64_t mCheap;
+    uint64_t mFull;
+};
+
+// a write in progress, which a Split or Join waits for before cutting the tree;
+// padded so threads do not share lines
+struct alignas(CACHE_LINE_SIZE) ReshardWriter
+{
+    uint32_t mWriting;
+};
+
+// xorshift state of a thread's sprayed PopMin and PopMax descents, padded so
+// threads do not share lines
+struct alignas(CACHE_LINE_SIZE) SpraySeed
+{
+    uint64_t mSeed;
+};
+
+struct PopCounters
+{
+    uint64_t mPops;
+    // pops whose key another thread removed first, so they tried the next edge key
+    uint64_t mRetries;
+};
+
+// AllocPolicy and SyncPolicy (tree_policies.hpp) replace the copies of the tree
+// that differed only in how they allocated and synchronized: every allocation of
+// the protocol goes through AllocPolicy::Allocate and every access to a word it
+// shares between threads through SyncPolicy, both static and inlined
+template <class K, class V, class Compare = std::less<K>, class AllocPolicy = MallocAlloc, class SyncPolicy = AtomicSync>
 class ConcurrentTree
 {
 public:
-    PointerNode<DataNode<V>, Flag> *pRoot;
-    OperationRecord<V> **ST, **MT;
+    PointerNode<DataNode<K, V>, Flag> *pRoot;
+    OperationRecord<K, V> **ST, **MT;
     uint32_t mNumThreads;
     uint32_t mIndex;
-
-    ConcurrentTree(int numThreads)
+    Compare mCompare;
+    // keys per external leaf; 0 keeps the classic one-key leaves
+    uint32_t mBucketSize;
+    // replicated upper levels, null until EnableTopIndex is called
+    TopIndex<K, V> *mTopIndex;
+    uint32_t mTopIndexDepth;
+    uint64_t mTopIndexVersion;
+    uint32_t mTopIndexRebuilding;
+    // optional cache of hot keys in front of Search, null until EnableHotKeyCache is called
+    HotKeyCache<K, V, Compare> *mHotKeyCache;
+    // optional filter that lets Search and Delete skip absent keys, null until EnableNegativeFilter is called
+    NegativeFilter<K> *mNegativeFilter;
+    // index from key straight to its value record, null until EnableHashIndex is called
+    HashIndex<K, V, Compare> *mHashIndex;
+    // per-thread search hints, null until EnableFingers is called
+    Finger<K, V> *mFingers;
+    // decides which selected table slots get helped; HELP_ALWAYS unless SetHelpingPolicy is called
+    HelpingPolicy *mHelpingPolicy;
+    // per-thread counts of window transactions
+    ThreadCounters<WindowCounters> mWindowCounters;
+    ThreadCounters<PopCounters> mPopCounters;
+    SpraySeed *mSpraySeeds;
+    // storage and reclamation of the values copied in by the reference InsertOrUpdate
+    ValueArena<V> *mValueArena;
+    // the thread that owns the tree alone, NO_SINGLE_OWNER unless SetSingleOwner is
+    // called, and whether it is inside an operation applied without the protocol
+    uint32_t mSingleOwner;
+    uint32_t mOwnerActive;
+    // key stripes ordering Transact calls with each other and with single-key
+    // operations, null until EnableTransactions is called
+    TransactionLocks *mTransactions;
+    // relaxed-balance mode, null until EnableRelaxedBalance is called
+    RelaxedBalance<K> *mBalance;
+    // expiration clock and sweeper, null until EnableExpiration is called
+    Expiration *mExpiration;
+    // odd while a Split or Join is cutting this tree; readers that saw it change retry
+    uint64_t mReshards;
+    ReshardWriter *mReshardWriters;
+
+    ConcurrentTree(int numThreads, const Compare &compare = Compare(), uint32_t bucketSize = 0)
     {
+        mCompare = compare;
+
+        if(bucketSize != 0 && bucketSize < MIN_LEAF_BUCKET_SIZE) {
+            bucketSize = MIN_LEAF_BUCKET_SIZE;
+        }
+        else if(bucketSize > MAX_LEAF_BUCKET_SIZE) {
+            bucketSize = MAX_LEAF_BUCKET_SIZE;
+        }
+        mBucketSize = bucketSize;
+        mTopIndex = nullptr;
+        mTopIndexDepth = 0;
+        mTopIndexVersion = 0;
+        mTopIndexRebuilding = 0;
+        mHotKeyCache = nullptr;
+        mNegativeFilter = nullptr;
+        mHashIndex = nullptr;
+        mFingers = nullptr;
+        mSingleOwner = NO_SINGLE_OWNER;
+        mOwnerActive = 0;
+        mTransactions = nullptr;
+        mBalance = nullptr;
+        mExpiration = nullptr;
+        mReshards = 0;
         mIndex = 0;
         mNumThreads = numThreads;
 
+        mHelpingPolicy = (HelpingPolicy *) malloc(sizeof(HelpingPolicy));
+        mHelpingPolicy->InitializeHelpingPolicy(numThreads);
+
+        mWindowCounters.InitializeThreadCounters(numThreads);
+
+        mReshardWriters = (ReshardWriter *) aligned_alloc(CACHE_LINE_SIZE, sizeof(ReshardWriter) * numThreads);
+        memset((void *) mReshardWriters, 0, sizeof(ReshardWriter) * numThreads);
+
+        mPopCounters.InitializeThreadCounters(numThreads);
+        mSpraySeeds = (SpraySeed *) aligned_alloc(CACHE_LINE_SIZE, sizeof(SpraySeed) * numThreads);
+        for(int i=0; i<numThreads; i++) {
+            mSpraySeeds[i].mSeed = 0x9e3779b97f4a7c15 * (i + 1);
+        }
+
+        mValueArena = (ValueArena<V> *) malloc(sizeof(ValueArena<V>));
+        mValueArena->InitializeValueArena(numThreads);
+
         // initialize pRoot with sentinel-valued DataNode
-        //auto pRoot = new PointerNode<DataNode<V>, Flag>(new DataNode<V>(), Flag::FREE);
-        auto pRoot = (PointerNode<DataNode<V>, Flag> *) malloc(sizeof(PointerNode<DataNode<V>, Flag>));
-        pRoot->InitializePointerNode((DataNode<V> *)malloc(sizeof(DataNode<V>)), Flag::FREE);
+        //auto pRoot = new PointerNode<DataNode<K, V>, Flag>(new DataNode<K, V>(), Flag::FREE);
+        pRoot = (PointerNode<DataNode<K, V>, Flag> *) malloc(sizeof(PointerNode<DataNode<K, V>, Flag>));
+        typedef DataNode<K, V> DataNodeType;
+        static_assert(offsetof(DataNodeType, mBucket) + sizeof(void *) <= CACHE_LINE_SIZE,
+                      "search fields of a data node must fit in one cache line");
+
+        // the root is a sentinel internal node that is never replaced, so an operation
+        // enters the tree by owning it; every key lives in its left subtree
+        auto dRoot = NewDataNode();
+        auto dLeft = NewDataNode();
+        if(mBucketSize != 0) {
+            dLeft->mBucket = LeafBucket<K, V>::template Allocate<AllocPolicy>(mBucketSize);
+        }
+
+        auto dRight = NewDataNode();
+
+        dRoot->mLeft.InitializePointerNode(dLeft, Flag::FREE);
+        dRoot->mRight.InitializePointerNode(dRight, Flag::FREE);
+        pRoot->InitializePointerNode(dRoot, Flag::FREE);
 
-        ST = (OperationRecord<V>**) malloc (sizeof(OperationRecord<V>*) * numThreads);
-        MT = (OperationRecord<V>**) malloc (sizeof(OperationRecord<V>*) * numThreads);
+        ST = (OperationRecord<K, V>**) malloc (sizeof(OperationRecord<K, V>*) * numThreads);
+        MT = (OperationRecord<K, V>**) malloc (sizeof(OperationRecord<K, V>*) * numThreads);
         for (int i = 0; i < numThreads; i++) {
             ST[i] = nullptr;
             MT[i] = nullptr;
         }
     }
 
-    V* Search(uint32_t key, int myid);
-    void InsertOrUpdate(uint32_t key, V *value, int myid);
-    void Delete(uint32_t key, int myid);
+    V* Search(const K &key, int myid);
+    // the record holding the key's value, or nullptr if the key is absent; its
+    // ReadValue and WriteValue give a read-modify-write that fails on conflict
+    ValueRecord<V> *SearchRecord(const K &key, int myid);
+    // Search and SearchRecord between two transactions on the key's stripe, without
+    // the ordering against Split and Join the public ones add
+    V *SearchBetweenTransactions(const K &key, int myid);
+    ValueRecord<V> *SearchRecordBetweenTransactions(const K &key, int myid);
+    // SearchRecord without either ordering, for the writes
+    ValueRecord<V> *LookupRecord(const K &key, int myid);
+    void InsertOrUpdate(const K &key, V *value, int myid);
+    // stores a copy of value owned by the tree. a pointer to it returned by Search
+    // stays valid until the calling thread's next operation or Quiesce
+    void InsertOrUpdate(const K &key, const V &value, int myid);
+    // as above, for a key that reads as absent ttl clock ticks (milliseconds, see
+    // expiration.hpp) from now; needs EnableExpiration. a write without a ttl
+    // keeps the stamp of the record it updates
+    void InsertOrUpdate(const K &key, const V &value, uint32_t ttl, int myid);
+    void Delete(const K &key, int myid);
+    // the thread holds no values returned by the tree, so an idle thread does not
+    // hold back the reclamation of replaced values
+    void Quiesce(int myid);
     uint32_t Select();
-    void Traverse(OperationRecord<V> *opData);
-    void ExecuteOperation(OperationRecord<V> *opData, int myid);
-    void InjectOperation(OperationRecord<V> *opData);
-    void ExecuteWindowTransaction(Position<V> *pNode, DataNode<V> *dNode);
-    bool ExecuteCheapWindowTransaction(Position<V> *pNode, DataNode<V> *dNode);
-    void SlideWindowDown(Position<V> *pMoveFrom, DataNode<V> *dMoveFrom, Position<V> *pMoveTo, DataNode<V> *dMoveTo);
-    Position<V> *GetPRootAsPosition();
-    Position<V> *GetPointerNodeAsPosition(PointerNode<DataNode<V>, Flag> *pointerNode);
+
+    // while one thread owns the tree its operations change it with plain stores,
+    // without operation records, table publication or helping. call before the
+    // tree is shared; any other thread must call RegisterThread before its first
+    // operation, which switches every thread to the wait-free protocol for good
+    void SetSingleOwner(int myid);
+    void RegisterThread(int myid);
+    bool EnterSingleOwner(int myid);
+    void ExitSingleOwner();
+    // applies an unpublished operation in place, returning the record that is its outcome
+    ValueRecord<V> *ApplyAlone(OperationRecord<K, V> *opData, bool *changed, int myid);
+
+    // parameter is the k of HELP_EVERY_KTH and HELP_AGED; call before the tree is shared
+    void SetHelpingPolicy(HelpingMode mode, uint64_t parameter = 1);
+    // whether to help the operation announced in a slot picked by Select()
+    bool ShouldHelp(OperationRecord<K, V> *pidOpData, uint32_t slot, int myid);
+    HelpingCounters GetHelpingCounters();
+    void Traverse(OperationRecord<K, V> *opData, Finger<K, V> *finger = nullptr);
+
+    // heterogeneous lookup, only available with a transparent comparator such as std::less<>
+    template <class Q, class C = Compare, class = typename C::is_transparent>
+    V* Search(const Q &key, int myid);
+
+    template <class Q>
+    DataNode<K, V> *FindLeaf(const Q &key, OperationRecord<K, V> *opData, Finger<K, V> *finger = nullptr);
+
+    // Search consults a cache of numSets sets once this is called
+    void EnableHotKeyCache(uint32_t numSets);
+    HotKeyCounters GetHotKeyCacheCounters();
+
+    // absent keys are rejected without a traversal once this is called; it must be
+    // called while the tree is still empty, since existing keys are not counted
+    void EnableNegativeFilter(uint64_t expectedKeys);
+    // counts an insert's key if it adds a record; decided once per insert
+    void CountInsert(OperationRecord<K, V> *opData, bool absent);
+    // opens a larger generation and moves the keys of the older ones into it
+    void GrowNegativeFilter(int myid);
+    FilterCounters GetNegativeFilterCounters();
+
+    // point lookups are answered from a hash index of the value records once this
+    // is called, and traverse only for keys it has not seen yet; modifications keep
+    // it in step. keys present before the call are indexed as they are looked up
+    void EnableHashIndex(uint64_t expectedKeys);
+    HashIndexCounters GetHashIndexCounters();
+
+    // searches start below the top depth levels once this is called
+    void EnableTopIndex(uint32_t depth);
+    bool BuildTopIndex();
+    void CollectTopIndex(TopIndex<K, V> *index, DataNode<K, V> *dNode, uint32_t depth, DataNode<K, V> **visited, uint32_t *numVisited);
+    template <class Q>
+    DataNode<K, V> *EnterTopIndex(const Q &key, DataNode<K, V> **dParent, const K **low, const K **high);
+
+    // each thread's searches start from its finger when the finger covers the key
+    // once this is called. modifications still enter at the root: the window
+    // transactions are ordered by the root, so only their search phase uses it
+    void EnableFingers();
+    FingerCounters GetFingerCounters();
+    template <class Q>
+    DataNode<K, V> *EnterFinger(const Q &key, Finger<K, V> *finger, uint64_t reshards, DataNode<K, V> **dParent, const K **low, const K **high);
+    void RecordFinger(Finger<K, V> *finger, FingerStep<K, V> *steps, uint32_t numSteps, bool enteredFromFinger, uint64_t reshards);
+
+    // Transact can be used once this is called, before the tree is shared. from then
+    // on single-key lookups and writes are ordered with transactions through the
+    // stripe of their key, and PeekMin and the heterogeneous Search, which have no
+    // stripe to go by, with every transaction
+    void EnableTransactions(uint64_t numStripes);
+    // applies ops atomically: other transactions and single-key operations see all of
+    // them or none. transactions on disjoint key stripes run in parallel. false if
+    // transactions are not enabled or ops touch more than TRANSACTION_MAX_KEYS keys
+    bool Transact(std::initializer_list<TransactionOp<K, V>> ops, int myid);
+    void ApplyTransactionOp(const TransactionOp<K, V> &op, int myid);
+    // announces a single-key modification on the key's stripe, waiting for a
+    // transaction holding it; nullptr if transactions are not enabled or the calling
+    // thread already holds or announced it. the write ends with EndWrite
+    uint64_t *EnterKeyStripe(const K &key, int myid);
+    TransactionCounters GetTransactionCounters();
+
+    // the tree is not restructured by writers. once this is called the nodes an insert
+    // adds are red, as in a red-black tree, and an insert that hangs one below a red
+    // node logs its key as a violation; Rebalance repairs the logged keys' paths later,
+    // rotating through the same window protocol
+    void EnableRelaxedBalance();
+    // repairs the paths of the keys logged so far, and no other part of the tree;
+    // returns the rotations applied. any thread may call it to help, one repair runs at a time
+    uint64_t Rebalance(int myid);
+    // removes the red-red violations on key's path from the top down: a red parent
+    // at the top of the tree turns black, a red uncle is recoloured with the parent
+    // and the grandparent, which moves the violation two levels up, and otherwise a
+    // single or double rotation at the grandparent ends it. returns the rotations applied
+    uint64_t RepairPath(const K &key, int myid);
+    // sets dNode's colour while no window is rooted at it; false if one is, or if the node left the tree
+    bool Recolor(DataNode<K, V> *dNode, Color color);
+    // runs Rebalance on a background thread whenever violations have been marked;
+    // myid is the table slot the rebalancer uses, which no other thread may use
+    void StartRebalancer(int myid);
+    void StopRebalancer();
+    static void *RebalancerMain(void *tree);
+    // whether dNode was rotated (or otherwise replaced) by the time the rotation completed
+    bool Rotate(DataNode<K, V> *dNode, bool right, int myid);
+    // rotated copy of dNode and the child it lifts; dLifted receives that child. the
+    // lifted copy takes dNode's colour and the lowered one turns red
+    DataNode<K, V> *NewRotation(DataNode<K, V> *dNode, bool right, DataNode<K, V> **dLifted);
+    BalanceCounters GetBalanceCounters();
+
+    // per-key expiration: once this is called, a key written with a ttl reads as absent
+    // from its stamp on, to Search, MultiSearch and the pops alike. traffic removes it
+    // on the way: an insert whose leaf is an expired key's, whether the same key or
+    // its neighbour, takes that leaf over in its own window transaction, and a pop
+    // that reaches an expired edge key removes it and moves on. Sweep removes the
+    // rest. call before the tree is shared
+    void EnableExpiration();
+    // removes every expired key, collecting EXPIRATION_SWEEP_BATCH of them per descent
+    // and removing each with a DELETE that only succeeds while the key still holds the
+    // expired record; returns how many were removed
+    uint64_t Sweep(int myid);
+    // adds to keys and records the expired keys under dNode that come after *after
+    // (all if after is null), in order, until count reaches EXPIRATION_SWEEP_BATCH
+    void CollectExpired(DataNode<K, V> *dNode, const K *after, uint32_t now, K *keys, ValueRecord<V> **records, uint32_t *count);
+    // runs Sweep on a background thread every EXPIRATION_IDLE_MICROSECONDS; myid is
+    // the table slot the sweeper uses, which no other thread may use
+    void StartExpirationSweeper(int myid);
+    void StopExpirationSweeper();
+    static void *SweeperMain(void *tree);
+    // whether valData reads as absent, killing its stamp if it just expired; only
+    // records with a stamp read the clock
+    bool IsExpired(ValueRecord<V> *valData);
+    // valData, or nullptr if it has expired
+    ValueRecord<V> *Unexpired(ValueRecord<V> *valData, int myid);
+    // removes key while it still holds the dead record valData; whether this call removed it
+    bool RemoveExpired(const K &key, ValueRecord<V> *valData, int myid);
+    // whether an insert takes over the record at the leaf dChild; the first helper
+    // to ask decides, so all of them build the same replacement
+    bool Displaces(OperationRecord<K, V> *opData, DataNode<K, V> *dChild);
+    // closes the expired record an insert took over, as a delete closes the one it removes
+    void ReleaseDisplaced(OperationRecord<K, V> *opData, int myid);
+    ExpirationCounters GetExpirationCounters();
+
+    // looks up count keys at once, writing each value (or nullptr) to values
+    void MultiSearch(const K *keys, V **values, size_t count, int myid);
+
+    // priority-queue use of the tree: the smallest or largest key and a copy of its
+    // value (value may be null), false if the tree is empty. a pop finds the edge
+    // leaf with a read-only descent and removes its key with a DELETE window
+    // transaction; if another thread removed it first, the pop moves on to the next
+    // edge key, so every key is popped once. with spray > 0 a pop starts a random
+    // descent up to spray levels above the edge leaf, which spreads concurrent pops
+    // over the first keys instead of all contending for the smallest one
+    bool PeekMin(K *key, V *value, int myid);
+    bool PeekFirst(K *key, V *value, int myid);
+    bool PopMin(K *key, V *value, int myid, uint32_t spray = 0);
+    bool PopMax(K *key, V *value, int myid, uint32_t spray = 0);
+    bool Pop(bool right, K *key, V *value, uint32_t spray, int myid);
+    // the leaf holding the smallest key under dNode (the largest if right), nullptr if none does
+    DataNode<K, V> *EdgeLeaf(DataNode<K, V> *dNode, bool right);
+    // a leaf near the edge, reached by a random descent from spray levels above the edge leaf
+    DataNode<K, V> *SprayLeaf(bool right, uint32_t spray, int myid);
+    // the smallest (largest if right) key of a leaf that holds keys, and its record
+    void LeafEdge(DataNode<K, V> *dLeaf, bool right, K *key, ValueRecord<V> **valData);
+    PopCounters GetPopCounters();
+
+    // re-sharding. Split moves the keys from key on into right, which must be empty,
+    // and keeps the smaller ones; Join moves every key of right, all ordered after
+    // the keys here, into this tree and leaves right empty. both copy only the nodes
+    // on one path and reuse the subtrees beside it; Join hangs the shorter tree where
+    // the taller one comes down to its height and rebalances the path above, so the
+    // height grows by about a level at most. other threads may go on using both
+    // trees: the call owns each root through the window protocol, lets the
+    // operations already inside finish, and cuts while writes wait; a search that
+    // overlaps the cut runs again. a record SearchRecord returned before the call
+    // may then belong to the other tree. myid is the caller's id in both trees.
+    // they change nothing and return false for trees with leaf buckets, a negative
+    // filter or a hash index, a right tree that is not empty (Split) or keys out of
+    // order (Join)
+    bool Split(const K &key, ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right, int myid);
+    bool Join(ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right, int myid);
+    // cuts the subtree at dNode into the keys before key and the rest (nullptr when
+    // there are none); nodes on the cut are copied, and the originals marked replaced
+    void SplitSubtree(DataNode<K, V> *dNode, const K &key, DataNode<K, V> **dLow, DataNode<K, V> **dHigh);
+    // joins dLow and dHigh, whose keys come before and from separator, under a new
+    // node keyed by separator where the taller one comes down to the other's height,
+    // and rebalances the nodes above it; those are rebuilt, and the originals marked
+    // replaced. height receives the estimated height of the result
+    DataNode<K, V> *JoinSubtrees(DataNode<K, V> *dLow, DataNode<K, V> *dHigh, const K &separator, uint32_t lowHeight, uint32_t highHeight, uint32_t *height, uint64_t *seed);
+    // a node over dLeft and dRight, rotated once or twice if one side is two levels taller
+    DataNode<K, V> *BalanceJoined(DataNode<K, V> *dLeft, uint32_t leftHeight, const K &key, DataNode<K, V> *dRight, uint32_t rightHeight, uint32_t *height, uint64_t *seed);
+    DataNode<K, V> *NewJoinNode(DataNode<K, V> *dLeft, const K &key, DataNode<K, V> *dRight);
+    // the deepest of a few descents from dNode, in links
+    uint32_t EstimateHeight(DataNode<K, V> *dNode, uint64_t *seed);
+    // the steps around a cut of both trees, taken in address order of the trees
+    void BeginReshard(ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right, int myid);
+    void EndReshard(ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right);
+    // makes mReshards odd, then waits out the writes already announced
+    void LockReshards();
+    // owns the root for a RESHARD operation and finishes every operation below it
+    void OwnRootAndDrain();
+    void ReleaseRoot();
+    // writes announce themselves for their whole length; false if this thread already has
+    bool EnterReshardWriter(int myid);
+    void ExitReshardWriter(int myid);
+    // a lookup between two cuts: the first waits out a cut in progress, the second
+    // tells if one started since. a writing thread holds cuts off and never retries
+    uint64_t BeginReshardRead(int myid);
+    bool EndReshardRead(uint64_t reshards, int myid);
+    // the keys of the tree hang left of the sentinel the first insert put under the
+    // root; the subtree holding them, nullptr if the tree is empty
+    DataNode<K, V> *FiniteSubtree();
+    void SetFiniteSubtree(DataNode<K, V> *dSubtree);
+    // the top index and the hot key cache may lead to subtrees that moved to another tree
+    void DropCachedPaths();
+
+    // is key ordered before the node's key; sentinels are above everything
+    template <class Q>
+    bool KeyLess(const Q &key, DataNode<K, V> *dNode)
+    {
+        // bitwise or keeps integer keys branchless
+        return dNode->Sentinel() | mCompare(key, dNode->mKey);
+    }
+
+    template <class Q>
+    bool KeyEquals(const Q &key, DataNode<K, V> *dNode)
+    {
+        return !dNode->Sentinel() & !mCompare(key, dNode->mKey) & !mCompare(dNode->mKey, key);
+    }
+
+    // the link of dNode on the path to key
+    PointerNode<DataNode<K, V>, Flag> *ChildLink(DataNode<K, V> *dNode, const K &key)
+    {
+        return KeyLess(key, dNode) ? &dNode->mLeft : &dNode->mRight;
+    }
+
+    // InsertOrUpdate with the stamp of a record it builds or renews, NO_EXPIRATION for none
+    void WriteKey(const K &key, V *value, uint32_t expires, int myid);
+    void WriteKey(const K &key, const V &value, uint32_t expires, int myid);
+    // phase 2 of InsertOrUpdate: adds the key and returns the record now holding it;
+    // inserted tells whether this call built the record or found the key present
+    ValueRecord<V> *InsertKey(const K &key, V *value, bool ownedValue, uint32_t expires, bool *inserted, int myid);
+    void PrepareInsert(OperationRecord<K, V> *opData, bool ownedValue, uint32_t expires);
+    // phase 2 of Delete: removes the key and returns its record, nullptr if it was
+    // already gone or, with expected set, held another record
+    ValueRecord<V> *DeleteKey(const K &key, ValueRecord<V> *expected, int myid);
+    // removes the key, found with record valData, and takes its record out of the
+    // indexes; whether this call removed it. value (may be null) receives its last
+    // value. if exact, the key is only removed while valData still holds it
+    bool RemoveKey(const K &key, ValueRecord<V> *valData, V *value, bool exact, int myid);
+    // takes a record out of the tree's indexes once its key no longer holds it, and
+    // closes it so a racing update cannot install a value in it
+    void CloseRecord(const K &key, ValueRecord<V> *valData, V *value, int myid);
+    void InitializeInsertedRecord(ValueRecord<V> *valData, OperationRecord<K, V> *opData);
+    // destroys the inline copy in a replacement that lost the race to be installed
+    void DiscardReplacement(DataNode<K, V> *dReplacement, OperationRecord<K, V> *opData);
+    void RetireValue(ValueRecord<V> *valData, V *replaced, int myid);
+
+    void ExecuteOperation(OperationRecord<K, V> *opData, int myid);
+    void InjectOperation(OperationRecord<K, V> *opData);
+    void HelpWindowOwner(OperationRecord<K, V> *owner, DataNode<K, V> *dNode);
+    void ExecuteWindowTransaction(OperationRecord<K, V> *opData, Position<K, V> *pNode);
+    bool ExecuteCheapWindowTransaction(OperationRecord<K, V> *opData, Position<K, V> *pNode, DataNode<K, V> *dChild);
+    // whether the operation takes effect at the link to dChild
+    bool IsFinalWindow(OperationRecord<K, V> *opData, DataNode<K, V> *dChild);
+    // the node to put in place of dChild, or nullptr if the operation changes nothing;
+    // valData receives the record that is the outcome, dLeaf a leaf a delete unlinks
+    DataNode<K, V> *BuildReplacement(OperationRecord<K, V> *opData, DataNode<K, V> *dChild, DataNode<K, V> **dLeaf, ValueRecord<V> **valData);
+    void MarkReplaced(DataNode<K, V> *dChild, DataNode<K, V> *dLeaf, DataNode<K, V> *dReplacement);
+    // sets NODE_REPLACED in dNode's owner word, keeping whatever owner it holds
+    void SetReplaced(DataNode<K, V> *dNode);
+    void CompleteWindowTransaction(OperationRecord<K, V> *opData, Position<K, V> *pNode);
+    void ApplyToBucket(DataNode<K, V> *dLeaf, OperationRecord<K, V> *opData);
+    void SlideWindowDown(OperationRecord<K, V> *opData, Position<K, V> *pMoveFrom, DataNode<K, V> *dMoveTo);
+    bool AdvanceState(OperationRecord<K, V> *opData, Position<K, V> *sExpected, Position<K, V> *pNext, Status status);
+    DataNode<K, V> *NewInternalWithLeaf(DataNode<K, V> *dLeaf, OperationRecord<K, V> *opData);
+    ValueRecord<V> *FindRecord(DataNode<K, V> *dNode, const K &key);
+    Position<K, V> *GetWindowAsPosition(DataNode<K, V> *dNode);
+    Position<K, V> *GetValueAsPosition(ValueRecord<V> *valData);
+
+    // allocation and shared accesses of the protocol, through the policies
+    template <class T>
+    T *Allocate()
+    {
+        return (T *) AllocPolicy::Allocate(sizeof(T), alignof(T));
+    }
+
+    DataNode<K, V> *NewDataNode();
+    DataNode<K, V> *CloneDataNode(DataNode<K, V> *dNode);
+    OperationRecord<K, V> *NewOperationRecord(Type type, const K &key, V *value);
+    Position<K, V> *NewPosition();
+    OperationRecord<K, V> *GetOwner(DataNode<K, V> *dNode);
+
+    // window transactions of completed modify operations, cheap (slid down) and full (restructured)
+    WindowCounters GetWindowCounters();
+    // checks the shape of a tree no operation is running on: every internal node has
+    // two children, every key lies in the range the routing keys above it give, and
+    // no node is owned by an operation or marked replaced. keys receives the key count,
+    // and height, if given, the most links from the root to a leaf
+    bool CheckInvariants(uint64_t *keys, uint32_t *height = nullptr);
 };
 
-#include "concurrent.tcc"
\ No newline at end of file
+#include "concurrent.tcc"
+
+#endif
@@ -1,128 +1,2313 @@
-template <class V>
-V *ConcurrentTree<V>::Search(uint32_t key, int myid)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+V *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Search(const K &key, int myid)
 {
+    // the value read falls between two cuts of Split or Join as well
+    V *value;
+    uint64_t reshards;
+
+    do {
+        reshards = BeginReshardRead(myid);
+        value = SearchBetweenTransactions(key, myid);
+    } while(!EndReshardRead(reshards, myid));
+
+    return value;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SearchRecord(const K &key, int myid)
+{
+    ValueRecord<V> *valData;
+    uint64_t reshards;
+
+    do {
+        reshards = BeginReshardRead(myid);
+        valData = SearchRecordBetweenTransactions(key, myid);
+    } while(!EndReshardRead(reshards, myid));
+
+    return valData;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+V *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SearchBetweenTransactions(const K &key, int myid)
+{
+    // outside a transaction the lookup, value included, falls between two
+    // transactions on the key's stripe
+    if(mTransactions != nullptr) {
+        uint64_t *stripe = mTransactions->StripeOf(hash_key(key));
+
+        while(!mTransactions->Holds(stripe, myid)) {
+            uint64_t word = mTransactions->BeginRead(stripe);
+            ValueRecord<V> *valData = LookupRecord(key, myid);
+            V *value = valData != nullptr ? valData->ReadValue() : nullptr;
+
+            if(mTransactions->EndRead(stripe, word, myid)) {
+                return value;
+            }
+        }
+    }
+
+    ValueRecord<V> *valData = LookupRecord(key, myid);
+    return valData != nullptr ? valData->ReadValue() : nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SearchRecordBetweenTransactions(const K &key, int myid)
+{
+    // as in Search, the record found falls between two transactions on the key's stripe
+    if(mTransactions != nullptr) {
+        uint64_t *stripe = mTransactions->StripeOf(hash_key(key));
+
+        while(!mTransactions->Holds(stripe, myid)) {
+            uint64_t word = mTransactions->BeginRead(stripe);
+            ValueRecord<V> *valData = LookupRecord(key, myid);
+
+            if(mTransactions->EndRead(stripe, word, myid)) {
+                return valData;
+            }
+        }
+    }
+
+    return LookupRecord(key, myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::LookupRecord(const K &key, int myid)
+{
+    // every operation starts here; values the thread got from earlier ones may now be
+    // reclaimed. word-sized values are never retired, so they need no announcement
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    // indexed keys are answered from the hash index in a probe or two
+    if(mHashIndex != nullptr) {
+        ValueRecord<V> *indexed = mHashIndex->Lookup(key, myid);
+        // an expired record is checked against the tree, which may hold a newer one already
+        if(indexed != nullptr && !IsExpired(indexed)) {
+            return indexed;
+        }
+    }
+
+    // hot keys are answered from the cache without touching the tree
+    uint32_t cacheEpoch = 0;
+    if(mHotKeyCache != nullptr) {
+        ValueRecord<V> *cached = mHotKeyCache->Lookup(key, myid);
+        if(cached != nullptr && !IsExpired(cached)) {
+            return cached;
+        }
+
+        cacheEpoch = mHotKeyCache->Epoch(key);
+    }
+
+    // keys the filter has never counted are not in the tree
+    if(mNegativeFilter != nullptr) {
+        if(!mNegativeFilter->MayContain(key)) {
+            mNegativeFilter->mCounters[myid].mRejected++;
+            return nullptr;
+        }
+        mNegativeFilter->mCounters[myid].mPassed++;
+    }
+
+    // the single owner of the tree looks the key up without publishing the search
+    if(EnterSingleOwner(myid)) {
+        ValueRecord<V> *valData = FindRecord(FindLeaf(key, nullptr, mFingers != nullptr ? &mFingers[myid] : nullptr), key);
+        ExitSingleOwner();
+
+        if(valData == nullptr && mNegativeFilter != nullptr) {
+            mNegativeFilter->mCounters[myid].mFalsePositives++;
+        }
+        if(valData != nullptr && mHotKeyCache != nullptr) {
+            mHotKeyCache->Fill(key, valData, cacheEpoch, myid);
+        }
+        if(valData != nullptr && mHashIndex != nullptr) {
+            mHashIndex->Publish(key, valData, myid);
+        }
+        return Unexpired(valData, myid);
+    }
+
+    // create and initialize a new operation record
+    OperationRecord<K, V> *opData = NewOperationRecord(Type::SEARCH, key, nullptr);
+
+    // initialize the operation state
+    opData->mState->setTag(Status::IN_PROGRESS);
+
+    // initialize the search table entry
+    ST[myid] = opData;
+
+    // traverse the tree
+    Traverse(opData, mFingers != nullptr ? &mFingers[myid] : nullptr);
+
+    // the record holding the value, if the key is present
+    ValueRecord<V> *valData = opData->mState->unpack()->valueRecord;
+
+    if(valData == nullptr && mNegativeFilter != nullptr) {
+        mNegativeFilter->mCounters[myid].mFalsePositives++;
+    }
+    if(valData != nullptr && mHotKeyCache != nullptr) {
+        mHotKeyCache->Fill(key, valData, cacheEpoch, myid);
+    }
+
+    // the traversal found a key the index did not answer for; the next lookup will not miss
+    if(valData != nullptr && mHashIndex != nullptr) {
+        mHashIndex->Publish(key, valData, myid);
+    }
+
+    return Unexpired(valData, myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::InsertOrUpdate(const K &key, V *value, int myid)
+{
+    WriteKey(key, value, NO_EXPIRATION, myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::InsertOrUpdate(const K &key, const V &value, int myid)
+{
+    WriteKey(key, value, NO_EXPIRATION, myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::InsertOrUpdate(const K &key, const V &value, uint32_t ttl, int myid)
+{
+    WriteKey(key, value, mExpiration->Stamp(ttl), myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::WriteKey(const K &key, V *value, uint32_t expires, int myid)
+{
+    // a Split or Join waits for the write before cutting, so the record it finds
+    // and updates is still in this tree when it does
+    if(EnterReshardWriter(myid)) {
+        WriteKey(key, value, expires, myid);
+        ExitReshardWriter(myid);
+        return;
+    }
+
+    // outside a transaction the update is announced on the key's stripe for its whole length
+    uint64_t *stripe = EnterKeyStripe(key, myid);
+    if(stripe != nullptr) {
+        WriteKey(key, value, expires, myid);
+        mTransactions->EndWrite(myid);
+        return;
+    }
+
+    ValueRecord<V> *valData = nullptr;
+    bool inserted = false;
+
+    // phase 1: determine if the key already exists in the tree
+    valData = LookupRecord(key, myid);
+
+    while(true) {
+        if(valData == nullptr) {
+            // phase 2: try to add the key-value pair to the tree using the MTL-framework
+            valData = InsertKey(key, value, false, expires, &inserted, myid);
+        }
+
+        if(valData == nullptr || inserted) {
+            return;
+        }
+
+        // a write with a ttl renews the stamp of the record it found, one without
+        // keeps it; if the record has expired since, the key is absent and an insert
+        // takes its leaf over
+        if(expires == NO_EXPIRATION ? !IsExpired(valData) : mExpiration->Renew(&valData->mExpires, expires)) {
+            break;
+        }
+        // a stamp that has passed already leaves the key absent; inserting it again would too
+        if(expires != NO_EXPIRATION && mExpiration->Expired(expires)) {
+            return;
+        }
+        valData = nullptr;
+    }
+
+    // phase 3: update the value in the record
+    if constexpr(WordValue<V>::value) {
+        // a word is stored by value; a record already holding it was just inserted
+        V current = valData->LoadValue();
+        while(memcmp(&current, value, sizeof(V)) != 0 && !valData->CompareExchange(&current, *value));
+    }
+    else {
+        // the write is conditional on the gate seen by the read, so only a racing
+        // update of the same key retries; a record holding no value was removed by
+        // a delete that has the last word
+        uint32_t gate;
+        V *current, *replaced;
+        while((current = valData->ReadValue(&gate)) != value && current != nullptr) {
+            if(valData->WriteValue(value, gate, false, &replaced)) {
+                RetireValue(valData, replaced, myid);
+                break;
+            }
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::WriteKey(const K &key, const V &value, uint32_t expires, int myid)
+{
+    if(EnterReshardWriter(myid)) {
+        WriteKey(key, value, expires, myid);
+        ExitReshardWriter(myid);
+        return;
+    }
+
+    uint64_t *stripe = EnterKeyStripe(key, myid);
+    if(stripe != nullptr) {
+        WriteKey(key, value, expires, myid);
+        mTransactions->EndWrite(myid);
+        return;
+    }
+
+    // a word is copied into the operation and the record, so the tree always owns it
+    if constexpr(WordValue<V>::value) {
+        WriteKey(key, const_cast<V *>(&value), expires, myid);
+    }
+    else {
+        // phase 1: determine if the key already exists in the tree
+        ValueRecord<V> *valData = LookupRecord(key, myid);
+        V *copy = nullptr;
+
+        while(true) {
+            if(valData == nullptr) {
+                // phase 2: the value is copied once here. a small value is copied again into
+                // the record by whichever helper builds it; a stale helper may still read the
+                // staged copy after the operation, so it is retired rather than released
+                if(copy == nullptr) {
+                    copy = mValueArena->Copy(value, myid);
+                }
+
+                bool inserted;
+                valData = InsertKey(key, copy, true, expires, &inserted, myid);
+
+                if(ValueArena<V>::INLINE) {
+                    mValueArena->Retire(copy, false, myid);
+                    copy = nullptr;
+                }
+
+                // the record's value is this insert's copy; from here on it is retired by
+                // whichever update or delete replaces it
+                if(inserted) {
+                    return;
+                }
+            }
+
+            // renewed as in the other WriteKey
+            if(valData == nullptr || (expires == NO_EXPIRATION ? !IsExpired(valData) : mExpiration->Renew(&valData->mExpires, expires))) {
+                break;
+            }
+            if(expires != NO_EXPIRATION && mExpiration->Expired(expires)) {
+                valData = nullptr;
+                break;
+            }
+            valData = nullptr;
+        }
+
+        if(valData != nullptr) {
+            // phase 3: as above, with the value copied into an arena slot
+            if(copy == nullptr) {
+                copy = mValueArena->Copy(value, myid);
+            }
+
+            uint32_t gate;
+            V *replaced;
+            while(valData->ReadValue(&gate) != nullptr) {
+                if(valData->WriteValue(copy, gate, true, &replaced)) {
+                    RetireValue(valData, replaced, myid);
+                    return;
+                }
+            }
+        }
+
+        // the key was deleted before the copy was published
+        if(copy != nullptr) {
+            mValueArena->Release(copy, myid);
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::InsertKey(const K &key, V *value, bool ownedValue, uint32_t expires, bool *inserted, int myid)
+{
+    // the single owner of the tree inserts in place; the key was absent in phase 1
+    // and nobody else changes the tree, so the record is built by this call
+    if(EnterSingleOwner(myid)) {
+        OperationRecord<K, V> opData(Type::INSERT, key, value, nullptr);
+        PrepareInsert(&opData, ownedValue, expires);
+
+        ValueRecord<V> *valData = ApplyAlone(&opData, inserted, myid);
+        ExitSingleOwner();
+        ReleaseDisplaced(&opData, myid);
+        if(mNegativeFilter != nullptr && mNegativeFilter->Overflowing()) {
+            GrowNegativeFilter(myid);
+        }
+
+        if(valData != nullptr && mHashIndex != nullptr) {
+            mHashIndex->Publish(key, valData, myid);
+        }
+        return valData;
+    }
+
+    // select a search operation to help at the end of phase 2 to ensure wait freedom
+    uint32_t pid = Select(); // the process selected to help in round-robin manner
+    OperationRecord<K, V> *pidOpData = this->ST[pid];
+
+    // create and initialize a new operation record
+    OperationRecord<K, V> *opData = NewOperationRecord(Type::INSERT, key, value);
+    PrepareInsert(opData, ownedValue, expires);
+
+    // add the key-value pair to the tree
+    ExecuteOperation(opData, myid);
+    ReleaseDisplaced(opData, myid);
+    if(mNegativeFilter != nullptr && mNegativeFilter->Overflowing()) {
+        GrowNegativeFilter(myid);
+    }
+    ValueRecord<V> *valData = opData->mState->unpack()->valueRecord;
+    if constexpr(WordValue<V>::value) {
+        *inserted = valData != nullptr && SyncPolicy::Load(&opData->mInserted);
+    }
+    else {
+        *inserted = valData != nullptr && valData->mInserter == opData;
+    }
+
+    // the record is indexed by the insert that added it, or found it added
+    if(valData != nullptr && mHashIndex != nullptr) {
+        mHashIndex->Publish(key, valData, myid);
+    }
+
+    // help the selected search operation complete
+    if(ShouldHelp(pidOpData, pid, myid)) {
+        Traverse(pidOpData);
+    }
+
+    return valData;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::PrepareInsert(OperationRecord<K, V> *opData, bool ownedValue, uint32_t expires)
+{
+    opData->mOwnedValue = ownedValue;
+    opData->mExpires = expires;
+    if constexpr(WordValue<V>::value) {
+        memcpy(opData->mWordValue, opData->mValue, sizeof(V));
+    }
+
+    // the key is counted by the window transaction that finds it absent (CountInsert)
+    if(mNegativeFilter != nullptr) {
+        opData->mFilterGeneration = FILTER_GENERATION_UNDECIDED;
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Delete(const K &key, int myid)
+{
+    uint64_t *stripe = EnterKeyStripe(key, myid);
+    if(stripe != nullptr) {
+        Delete(key, myid);
+        mTransactions->EndWrite(myid);
+        return;
+    }
+
+    // phase 1: determine if the key already exists in the tree
+    ValueRecord<V> *valData = LookupRecord(key, myid);
+
+    if(valData != nullptr) {
+        // phase 2: remove the key
+        RemoveKey(key, valData, nullptr, false, myid);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RemoveKey(const K &key, ValueRecord<V> *valData, V *value, bool exact, int myid)
+{
+    // the single owner of the tree removes the key in place
+    ValueRecord<V> *removed;
+    if(EnterSingleOwner(myid)) {
+        OperationRecord<K, V> opData(Type::DELETE, key, nullptr, nullptr);
+        opData.mExpected = exact ? valData : nullptr;
+        removed = ApplyAlone(&opData, nullptr, myid);
+        ExitSingleOwner();
+    }
+    else {
+        removed = DeleteKey(key, exact ? valData : nullptr, myid);
+    }
+
+    if(removed != nullptr) {
+        CloseRecord(key, removed, value, myid);
+    }
+
+    return removed != nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CloseRecord(const K &key, ValueRecord<V> *valData, V *value, int myid)
+{
+    // the index stops answering with the record before the delete returns
+    if(mHashIndex != nullptr) {
+        mHashIndex->Unlink(valData);
+    }
+
+    // close the removed record, so a racing update cannot install a value in it
+    // after its last value has been retired. words are never retired
+    if constexpr(WordValue<V>::value) {
+        if(value != nullptr) {
+            *value = valData->LoadValue();
+        }
+    }
+    else {
+        uint32_t gate;
+        V *replaced = nullptr;
+        while(valData->ReadValue(&gate) != nullptr && !valData->WriteValue(nullptr, gate, false, &replaced));
+        if(value != nullptr && replaced != nullptr) {
+            *value = *replaced;
+        }
+        RetireValue(valData, replaced, myid);
+    }
+
+    // the record is out of the tree now; exactly one of the operations that took it out uncounts it
+    if(mNegativeFilter != nullptr) {
+        mNegativeFilter->Remove(key, &valData->mFilterGeneration);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::DeleteKey(const K &key, ValueRecord<V> *expected, int myid)
+{
+    // try to delete the key from the tree using the MTL-framework
+    // select a search operation to help at the end of phase 2 to ensure wait-freedom
+    uint32_t pid = Select(); // the process selected to help in a round-robin manner
+    OperationRecord<K, V> *pidOpData = ST[pid];
+
     // create and initialize a new operation record
-    OperationRecord<V> *opData = new OperationRecord<V>(Type::SEARCH, key, nullptr);
+    OperationRecord<K, V> *opData = NewOperationRecord(Type::DELETE, key, nullptr);
+    opData->mExpected = expected;
+    // = (OperationRecord<K, V> *) malloc(sizeof(OperationRecord<K, V>));
+    // opData->InitializeOperationRecord(Type::DELETE, key, nullptr);
+    // opData->mType = Type::DELETE;
+    // opData->mKey = key;
+    // opData->mValue = nullptr;
+
+    //remove the key from the tree
+    ExecuteOperation(opData, myid);
+
+    if(ShouldHelp(pidOpData, pid, myid)) {
+        // help the selected search operation complete
+        Traverse(pidOpData);
+    }
+
+    return opData->mState->unpack()->valueRecord;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Transact(std::initializer_list<TransactionOp<K, V>> ops, int myid)
+{
+    if(mTransactions == nullptr) {
+        return false;
+    }
+
+    // the stripes of every key, in address order so that transactions never wait
+    // on each other in a cycle
+    uint64_t *stripes[TRANSACTION_MAX_KEYS];
+    uint32_t count = 0;
+
+    for(const TransactionOp<K, V> &op : ops) {
+        if(count + (op.mType == TX_MOVE ? 2 : 1) > TRANSACTION_MAX_KEYS) {
+            return false;
+        }
+
+        stripes[count++] = mTransactions->StripeOf(hash_key(op.mKey));
+        if(op.mType == TX_MOVE) {
+            stripes[count++] = mTransactions->StripeOf(hash_key(op.mTarget));
+        }
+    }
+
+    std::sort(stripes, stripes + count);
+    count = std::unique(stripes, stripes + count) - stripes;
+
+    // announced as a write before waiting for the stripes: a Split waits for the
+    // single-key write holding one of them off, so this must not wait for the Split
+    bool writer = EnterReshardWriter(myid);
+
+    // holding every stripe, the operations run one after the other through the
+    // single-key paths, which see the stripes as held and skip them
+    while(!mTransactions->TryLockAll(stripes, count, myid));
+
+    mTransactions->BeginApply();
+    for(const TransactionOp<K, V> &op : ops) {
+        ApplyTransactionOp(op, myid);
+    }
+    mTransactions->EndApply();
+
+    for(uint32_t i=0; i<count; i++) {
+        mTransactions->Unlock(stripes[i]);
+    }
+
+    if(writer) {
+        ExitReshardWriter(myid);
+    }
+
+    mTransactions->mCounters[myid].mCommits++;
+    return true;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ApplyTransactionOp(const TransactionOp<K, V> &op, int myid)
+{
+    switch(op.mType) {
+    case TX_INSERT:
+        InsertOrUpdate(op.mKey, op.mValue, myid);
+        break;
+    case TX_UPDATE:
+        if(Search(op.mKey, myid) != nullptr) {
+            InsertOrUpdate(op.mKey, op.mValue, myid);
+        }
+        break;
+    case TX_DELETE:
+        Delete(op.mKey, myid);
+        break;
+    case TX_MOVE:
+        if(mCompare(op.mKey, op.mTarget) || mCompare(op.mTarget, op.mKey)) {
+            // copied out before the delete retires the value
+            V *value = Search(op.mKey, myid);
+            if(value != nullptr) {
+                V moved = *value;
+                Delete(op.mKey, myid);
+                InsertOrUpdate(op.mTarget, moved, myid);
+            }
+        }
+        break;
+    case TX_ADD:
+        if constexpr(std::is_arithmetic<V>::value) {
+            V *value = Search(op.mKey, myid);
+            if(value != nullptr) {
+                InsertOrUpdate(op.mKey, (V) (*value + op.mValue), myid);
+            }
+        }
+        break;
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint64_t *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnterKeyStripe(const K &key, int myid)
+{
+    if(mTransactions == nullptr) {
+        return nullptr;
+    }
+
+    uint64_t *stripe = mTransactions->StripeOf(hash_key(key));
+    if(mTransactions->Holds(stripe, myid) || mTransactions->Writing(stripe, myid)) {
+        return nullptr;
+    }
+
+    mTransactions->BeginWrite(stripe, myid);
+    return stripe;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+TransactionCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetTransactionCounters()
+{
+    return mTransactions->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableRelaxedBalance()
+{
+    auto balance = (RelaxedBalance<K> *) malloc(sizeof(RelaxedBalance<K>));
+    balance->InitializeRelaxedBalance(mNumThreads);
+    mBalance = balance;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint64_t ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Rebalance(int myid)
+{
+    if(mBalance == nullptr || !__sync_bool_compare_and_swap(&mBalance->mRepairing, 0, 1)) {
+        return 0;
+    }
+
+    // keys logged from here on are left to the next repair
+    uint64_t rotations = 0;
+    for(uint32_t pid=0; pid<mNumThreads; pid++) {
+        for(uint64_t pending = mBalance->Pending(pid); pending > 0; pending--) {
+            rotations += RepairPath(mBalance->Take(pid), myid);
+            mBalance->mCounters[myid].mRepairs++;
+        }
+    }
+
+    mBalance->mCounters[myid].mRotations += rotations;
+    __atomic_store_n(&mBalance->mRepairing, 0, __ATOMIC_RELEASE);
+    return rotations;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint64_t ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RepairPath(const K &key, int myid)
+{
+    // colours are read while other operations go on, so a step may act on a shape
+    // that has changed since; each step walks the path again from the root
+    DataNode<K, V> *dRoot = this->pRoot->unpack();
+    uint64_t rotations = 0;
+    uint64_t recolorings = 0;
+
+    for(uint32_t step = 0; step < BALANCE_MAX_STEPS; step++) {
+        DataNode<K, V> *dGreat = nullptr;
+        DataNode<K, V> *dGrand = nullptr;
+        DataNode<K, V> *dParent = dRoot;
+        DataNode<K, V> *dNode = ChildLink(dRoot, key)->unpack();
+        bool found = false;
+        bool repaired = false;
+
+        while(!found && !dNode->isLeaf()) {
+            // a violation the tree cannot rotate away, as sentinel routing keys stay on
+            // the right spine, is passed over for the ones below it
+            if(dNode->Red() && dParent->Red()) {
+                bool parentLeft = dGrand->mLeft.unpack() == dParent;
+                bool nodeLeft = dParent->mLeft.unpack() == dNode;
+                DataNode<K, V> *dUncle = parentLeft ? dGrand->mRight.unpack() : dGrand->mLeft.unpack();
+
+                if(dGrand == dRoot) {
+                    // the top of the tree may turn black, which adds a level to every path alike
+                    found = true;
+                    repaired = Recolor(dParent, BLACK);
+                    recolorings += repaired;
+                }
+                else if(dUncle->Red()) {
+                    found = true;
+                    repaired = Recolor(dUncle, BLACK) && Recolor(dParent, BLACK);
+                    if(repaired && dGreat != dRoot) {
+                        Recolor(dGrand, RED);
+                    }
+                    recolorings += repaired;
+                }
+                else if(!dGrand->Sentinel() && !dParent->Sentinel() && (nodeLeft == parentLeft || !dNode->Sentinel())) {
+                    // an inner node is lifted into its parent's place first
+                    found = true;
+                    repaired = true;
+                    if(nodeLeft != parentLeft && Rotate(dParent, nodeLeft, myid)) {
+                        rotations++;
+                    }
+                    if(Rotate(dGrand, parentLeft, myid)) {
+                        rotations++;
+                    }
+                }
+            }
+
+            dGreat = dGrand;
+            dGrand = dParent;
+            dParent = dNode;
+            dNode = ChildLink(dNode, key)->unpack();
+        }
+
+        if(!found) {
+            break;
+        }
+
+        if(!repaired) {
+            // a window is rooted at a node to recolour; let its operation move on
+            sched_yield();
+        }
+    }
+
+    mBalance->mCounters[myid].mRecolorings += recolorings;
+    return rotations;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Recolor(DataNode<K, V> *dNode, Color color)
+{
+    // the acquire and release of a window both read the owner word first, so a
+    // change while no window is rooted here only fails an acquire, which is retried
+    uint64_t owner = SyncPolicy::Load(&dNode->mOwner);
+    if(DataNode<K, V>::OwnerOf(owner) != nullptr || (owner & NODE_REPLACED) != 0) {
+        return false;
+    }
+
+    uint64_t colored = color == RED ? owner | NODE_RED : owner & ~NODE_RED;
+    return owner == colored || SyncPolicy::CompareAndSwap(&dNode->mOwner, owner, colored);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::StartRebalancer(int myid)
+{
+    RegisterThread(myid);
+
+    mBalance->mRebalancerId = myid;
+    __atomic_store_n(&mBalance->mRunning, 1, __ATOMIC_RELEASE);
+    pthread_create(&mBalance->mThread, NULL, RebalancerMain, (void *) this);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::StopRebalancer()
+{
+    __atomic_store_n(&mBalance->mRunning, 0, __ATOMIC_RELEASE);
+    pthread_join(mBalance->mThread, NULL);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RebalancerMain(void *tree)
+{
+    auto self = (ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *) tree;
+    RelaxedBalance<K> *balance = self->mBalance;
+
+    while(__atomic_load_n(&balance->mRunning, __ATOMIC_ACQUIRE) != 0) {
+        if(balance->Pending()) {
+            self->Rebalance(balance->mRebalancerId);
+        }
+        else {
+            usleep(BALANCE_IDLE_MICROSECONDS);
+        }
+    }
+
+    return nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Rotate(DataNode<K, V> *dNode, bool right, int myid)
+{
+    // the node is found by its routing key, which lies inside its own key range
+    if(dNode->isLeaf() || dNode->Sentinel()) {
+        return false;
+    }
+
+    if(EnterSingleOwner(myid)) {
+        OperationRecord<K, V> opData(Type::REBALANCE, dNode->mKey, nullptr, nullptr);
+        opData.mRotate = dNode;
+        opData.mRotateRight = right;
+
+        bool changed;
+        ApplyAlone(&opData, &changed, myid);
+        ExitSingleOwner();
+        return changed;
+    }
+
+    OperationRecord<K, V> *opData = NewOperationRecord(Type::REBALANCE, dNode->mKey, nullptr);
+    opData->mRotate = dNode;
+    opData->mRotateRight = right;
+    ExecuteOperation(opData, myid);
+
+    return (SyncPolicy::Load(&dNode->mOwner) & NODE_REPLACED) != 0;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::NewRotation(DataNode<K, V> *dNode, bool right, DataNode<K, V> **dLifted)
+{
+    DataNode<K, V> *dChild = right ? dNode->mLeft.unpack() : dNode->mRight.unpack();
+
+    // sentinel routing keys stay on the right spine, where no rotation moves them
+    if(dNode->Sentinel() || dChild->isLeaf() || dChild->Sentinel()) {
+        return nullptr;
+    }
+
+    // right: dNode(dChild(a, b), c) becomes dChild'(a, dNode'(b, c)); left mirrors it.
+    // both are copies, and the subtrees a, b and c move to links they were never at
+    DataNode<K, V> *dLowered = NewDataNode();
+    dLowered->SetSentinel(false);
+    dLowered->SetColor(RED);
+    dLowered->mKey = dNode->mKey;
+
+    DataNode<K, V> *dTop = NewDataNode();
+    dTop->SetSentinel(false);
+    dTop->SetColor(dNode->Red() ? RED : BLACK);
+    dTop->mKey = dChild->mKey;
+
+    if(right) {
+        dLowered->mLeft.InitializePointerNode(dChild->mRight.unpack(), Flag::FREE);
+        dLowered->mRight.InitializePointerNode(dNode->mRight.unpack(), Flag::FREE);
+        dTop->mLeft.InitializePointerNode(dChild->mLeft.unpack(), Flag::FREE);
+        dTop->mRight.InitializePointerNode(dLowered, Flag::FREE);
+    }
+    else {
+        dLowered->mLeft.InitializePointerNode(dNode->mLeft.unpack(), Flag::FREE);
+        dLowered->mRight.InitializePointerNode(dChild->mLeft.unpack(), Flag::FREE);
+        dTop->mLeft.InitializePointerNode(dLowered, Flag::FREE);
+        dTop->mRight.InitializePointerNode(dChild->mRight.unpack(), Flag::FREE);
+    }
+
+    *dLifted = dChild;
+    return dTop;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+BalanceCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetBalanceCounters()
+{
+    return mBalance->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SetSingleOwner(int myid)
+{
+    mSingleOwner = myid;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RegisterThread(int myid)
+{
+    if(__atomic_load_n(&mSingleOwner, __ATOMIC_ACQUIRE) == NO_SINGLE_OWNER || (uint32_t) myid == mSingleOwner) {
+        return;
+    }
+
+    // end the single-owner mode, then wait out an operation the owner may be applying
+    // in place. the owner announces itself before checking the mode and this thread
+    // clears the mode before checking the announcement, so at least one of them sees
+    // the other: either the owner falls back to the protocol, or its operation is
+    // complete and visible here by the time the wait ends
+    __atomic_store_n(&mSingleOwner, NO_SINGLE_OWNER, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&mOwnerActive, __ATOMIC_SEQ_CST) != 0);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnterSingleOwner(int myid)
+{
+    if(__atomic_load_n(&mSingleOwner, __ATOMIC_RELAXED) != (uint32_t) myid) {
+        return false;
+    }
+
+    __atomic_store_n(&mOwnerActive, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&mSingleOwner, __ATOMIC_SEQ_CST) != (uint32_t) myid) {
+        __atomic_store_n(&mOwnerActive, 0, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    return true;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ExitSingleOwner()
+{
+    __atomic_store_n(&mOwnerActive, 0, __ATOMIC_RELEASE);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ApplyAlone(OperationRecord<K, V> *opData, bool *changed, int myid)
+{
+    // walk down to the final window; with no other thread in the tree there is
+    // nothing to own, and the window transaction becomes a single store
+    DataNode<K, V> *dNode = this->pRoot->unpack();
+    PointerNode<DataNode<K, V>, Flag> *pChild = ChildLink(dNode, opData->mKey);
+    DataNode<K, V> *dChild = pChild->unpack();
+
+    while(!IsFinalWindow(opData, dChild)) {
+        dNode = dChild;
+        pChild = ChildLink(dChild, opData->mKey);
+        dChild = pChild->unpack();
+    }
+
+    DataNode<K, V> *dLeaf = nullptr;
+    ValueRecord<V> *valData = nullptr;
+    DataNode<K, V> *dReplacement = BuildReplacement(opData, dChild, &dLeaf, &valData);
+
+    if(dReplacement != nullptr) {
+        if(mBalance != nullptr && opData->mType == Type::INSERT && dReplacement->Red() && dNode->Red()) {
+            mBalance->Mark(opData->mKey, myid);
+        }
+
+        MarkReplaced(dChild, dLeaf, dReplacement);
+
+        // the tree keeps the shape the protocol relies on, so it can take over at any time
+        PointerNode<DataNode<K, V>, Flag> pReplacement(nullptr);
+        pReplacement.InitializePointerNode(dReplacement, Flag::FREE);
+        SyncPolicy::Store(&pChild->mPackedPointer, pReplacement.mPackedPointer);
+
+        if(opData->mType == Type::INSERT) {
+            valData = FindRecord(dReplacement, opData->mKey);
+        }
+    }
+
+    if(changed != nullptr) {
+        *changed = dReplacement != nullptr;
+    }
+
+    if(mHotKeyCache != nullptr) {
+        mHotKeyCache->Invalidate(opData->mKey, myid);
+    }
+
+    return valData;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Quiesce(int myid)
+{
+    mValueArena->Quiesce(myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RetireValue(ValueRecord<V> *valData, V *replaced, int myid)
+{
+    if(replaced != nullptr) {
+        mValueArena->Retire(replaced, replaced == valData->InlineValue(), myid);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint32_t ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Select()
+{
+    uint32_t fetched_pid = this->mIndex;
+    this->mIndex = (this->mIndex + 1) % this->mNumThreads;
+    return fetched_pid;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SetHelpingPolicy(HelpingMode mode, uint64_t parameter)
+{
+    // helping every 0th operation would mean never helping, which loses the step bound
+    if(mode == HELP_EVERY_KTH && parameter == 0) {
+        parameter = 1;
+    }
+
+    mHelpingPolicy->mMode = mode;
+    mHelpingPolicy->mParameter = parameter;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ShouldHelp(OperationRecord<K, V> *pidOpData, uint32_t slot, int myid)
+{
+    // only the state is read, so a skipped slot costs no shared write
+    bool pending = pidOpData != nullptr && pidOpData->mState->getTag() != Status::COMPLETED;
+    return mHelpingPolicy->ShouldHelp(myid, slot, pidOpData, pending);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+HelpingCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetHelpingCounters()
+{
+    return mHelpingPolicy->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+template <class Q, class C, class>
+V *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Search(const Q &key, int myid)
+{
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    // the probe key has no stripe to read between transactions on, so with
+    // transactions enabled the lookup falls between changes of any stripe
+    uint64_t word = 0, reshards;
+    V *value;
+
+    do {
+        reshards = BeginReshardRead(myid);
+        if(mTransactions != nullptr) {
+            word = mTransactions->BeginReadAll();
+        }
+
+        // the probe key has no operation record, so the traversal is not published
+        // in the search table; it is read-only and bounded by the height of the tree
+        DataNode<K, V> *dLeaf = FindLeaf(key, nullptr, mFingers != nullptr ? &mFingers[myid] : nullptr);
+
+        ValueRecord<V> *valData = nullptr;
+        if(dLeaf->mBucket != nullptr) {
+            int32_t index = dLeaf->mBucket->Find(key, mCompare);
+            valData = index != -1 ? dLeaf->mBucket->mValues[index] : nullptr;
+        }
+        else if(KeyEquals(key, dLeaf)) {
+            valData = dLeaf->mValData;
+        }
+
+        valData = Unexpired(valData, myid);
+        value = valData != nullptr ? valData->ReadValue() : nullptr;
+    } while((mTransactions != nullptr && !mTransactions->EndReadAll(word, myid)) || !EndReshardRead(reshards, myid));
+
+    return value;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+template <class Q>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::FindLeaf(const Q &key, OperationRecord<K, V> *opData, Finger<K, V> *finger)
+{
+    // bounds of the subtree being searched; only tracked to record the finger
+    DataNode<K, V> *dParent = nullptr;
+    DataNode<K, V> *dCurrent = nullptr;
+    const K *low = nullptr;
+    const K *high = nullptr;
+
+    // start from the finger if it covers the key, else from the top index entry
+    // covering the key, or from the root of the tree. a finger is only recorded
+    // from a path no Split or Join cut while it was read
+    uint64_t reshards = 0;
+    if(finger != nullptr) {
+        reshards = __atomic_load_n(&mReshards, __ATOMIC_ACQUIRE);
+        dCurrent = EnterFinger(key, finger, reshards, &dParent, &low, &high);
+    }
+
+    bool enteredFromFinger = dCurrent != nullptr;
+    if(!enteredFromFinger) {
+        dCurrent = EnterTopIndex(key, &dParent, &low, &high);
+    }
+
+    // the last FINGER_HEIGHT + 1 links taken, in a ring
+    FingerStep<K, V> steps[FINGER_HEIGHT + 1];
+    uint32_t numSteps = 0;
+
+    while(true)
+    {
+        // find a leaf
+        while(!dCurrent->isLeaf())
+        {
+            // abort the traversal if no longer needed
+            if(opData != nullptr && opData->mState->getTag() == Status::COMPLETED) {
+                return nullptr;
+            }
+
+            // find the next node to visit; the links are embedded, so this is a single load per level
+            if(dCurrent->mLeft.mPackedPointer && KeyLess(key, dCurrent)) {
+                if(finger != nullptr) {
+                    high = dCurrent->Sentinel() ? nullptr : &dCurrent->mKey;
+                    steps[numSteps++ % (FINGER_HEIGHT + 1)] = {dCurrent, &dCurrent->mLeft, low, high};
+                }
+                dCurrent = dCurrent->mLeft.unpack();
+            }
+            else if(dCurrent->mRight.mPackedPointer) {
+                if(finger != nullptr) {
+                    low = &dCurrent->mKey;
+                    steps[numSteps++ % (FINGER_HEIGHT + 1)] = {dCurrent, &dCurrent->mRight, low, high};
+                }
+                dCurrent = dCurrent->mRight.unpack();
+            }
+        }
+
+        if(dParent == nullptr || !dParent->Replaced()) {
+            if(finger != nullptr) {
+                RecordFinger(finger, steps, numSteps, enteredFromFinger, reshards);
+            }
+
+            return dCurrent;
+        }
+
+        // the entry's link stopped being live during the search; redo it from the root
+        dParent = nullptr;
+        dCurrent = this->pRoot->unpack();
+        low = nullptr;
+        high = nullptr;
+        numSteps = 0;
+        enteredFromFinger = false;
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableFingers()
+{
+    auto fingers = (Finger<K, V> *) aligned_alloc(CACHE_LINE_SIZE, sizeof(Finger<K, V>) * mNumThreads);
+    for(uint32_t i=0; i<mNumThreads; i++) {
+        fingers[i].InitializeFinger();
+    }
+    mFingers = fingers;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+FingerCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetFingerCounters()
+{
+    // each finger is only written by its thread; the sum is approximate while threads run
+    FingerCounters total = {0, 0};
+
+    for(uint32_t i=0; i<mNumThreads; i++) {
+        total.mHits += mFingers[i].mHits;
+        total.mMisses += mFingers[i].mMisses;
+    }
+
+    return total;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+template <class Q>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnterFinger(const Q &key, Finger<K, V> *finger, uint64_t reshards, DataNode<K, V> **dParent, const K **low, const K **high)
+{
+    // a subtree only gains keys while the node above it stays in the tree (a
+    // delete widens its sibling's range, a rotation keeps it), so the recorded
+    // range is still covered if the node holding the link has not been replaced.
+    // a Split or Join moves whole subtrees without replacing the nodes above them
+    if(finger->mParent == nullptr || finger->mReshards != reshards ||
+       (finger->mHasLow && mCompare(key, finger->mLow)) ||
+       (finger->mHasHigh && !mCompare(key, finger->mHigh)) ||
+       finger->mParent->Replaced()) {
+        finger->mMisses++;
+        return nullptr;
+    }
+
+    finger->mHits++;
+    *dParent = finger->mParent;
+    *low = finger->mHasLow ? &finger->mLow : nullptr;
+    *high = finger->mHasHigh ? &finger->mHigh : nullptr;
+    return finger->mLink->unpack();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RecordFinger(Finger<K, V> *finger, FingerStep<K, V> *steps, uint32_t numSteps, bool enteredFromFinger, uint64_t reshards)
+{
+    // a finger already within FINGER_HEIGHT levels of the leaf stays where it is,
+    // otherwise it would sink a level with every search
+    if(numSteps == 0 || (enteredFromFinger && numSteps <= FINGER_HEIGHT)) {
+        return;
+    }
+
+    // the path may lead into the other tree of a cut that overlapped it; a cut that
+    // starts after this check leaves the finger with an old mReshards
+    if((reshards & 1) != 0 || __atomic_load_n(&mReshards, __ATOMIC_ACQUIRE) != reshards) {
+        return;
+    }
+
+    uint32_t step = numSteps > FINGER_HEIGHT ? numSteps - 1 - FINGER_HEIGHT : 0;
+    FingerStep<K, V> *fingerStep = &steps[step % (FINGER_HEIGHT + 1)];
+
+    // the bounds may point into the finger itself, which makes these self-assignments
+    finger->mHasLow = fingerStep->mLow != nullptr;
+    if(finger->mHasLow) {
+        finger->mLow = *fingerStep->mLow;
+    }
+
+    finger->mHasHigh = fingerStep->mHigh != nullptr;
+    if(finger->mHasHigh) {
+        finger->mHigh = *fingerStep->mHigh;
+    }
+
+    finger->mParent = fingerStep->mParent;
+    finger->mLink = fingerStep->mLink;
+    finger->mReshards = reshards;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableTopIndex(uint32_t depth)
+{
+    mTopIndexDepth = depth < MAX_TOP_INDEX_DEPTH ? depth : MAX_TOP_INDEX_DEPTH;
+    BuildTopIndex();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableHotKeyCache(uint32_t numSets)
+{
+    auto cache = (HotKeyCache<K, V, Compare> *) malloc(sizeof(HotKeyCache<K, V, Compare>));
+    cache->InitializeHotKeyCache(numSets, mNumThreads, mCompare);
+    mHotKeyCache = cache;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+HotKeyCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetHotKeyCacheCounters()
+{
+    return mHotKeyCache->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableHashIndex(uint64_t expectedKeys)
+{
+    auto index = (HashIndex<K, V, Compare> *) malloc(sizeof(HashIndex<K, V, Compare>));
+    index->InitializeHashIndex(expectedKeys, mNumThreads, mCompare);
+    mHashIndex = index;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+HashIndexCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetHashIndexCounters()
+{
+    return mHashIndex->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableNegativeFilter(uint64_t expectedKeys)
+{
+    auto filter = (NegativeFilter<K> *) malloc(sizeof(NegativeFilter<K>));
+    filter->InitializeNegativeFilter(expectedKeys, mNumThreads);
+    mNegativeFilter = filter;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CountInsert(OperationRecord<K, V> *opData, bool absent)
+{
+    // like Displaces, the first helper to reach the leaf decides, and only an insert
+    // that adds a record counts its key. the count is taken before the decision is
+    // published, so it precedes every replacement that makes the key visible
+    if(SyncPolicy::Load(&opData->mFilterGeneration) != FILTER_GENERATION_UNDECIDED) {
+        return;
+    }
+
+    uint32_t generation = absent ? mNegativeFilter->Add(opData->mKey) : NO_FILTER_GENERATION;
+    if(!SyncPolicy::CompareAndSwap(&opData->mFilterGeneration, FILTER_GENERATION_UNDECIDED, generation) &&
+       generation != NO_FILTER_GENERATION) {
+        mNegativeFilter->Remove(opData->mKey, &generation);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GrowNegativeFilter(int myid)
+{
+    if(!mNegativeFilter->BeginGrowth(myid)) {
+        return;
+    }
+
+    // a read-only walk over the leaves; a key inserted behind it stays counted
+    // where it is and is moved by the next growth
+    uint32_t capacity = 64, count = 0;
+    auto stack = (DataNode<K, V> **) malloc(sizeof(DataNode<K, V> *) * capacity);
+    stack[count++] = this->pRoot->unpack();
+
+    while(count > 0) {
+        DataNode<K, V> *dNode = stack[--count];
+
+        if(dNode->mBucket != nullptr) {
+            LeafBucket<K, V> *bucket = dNode->mBucket;
+            for(uint32_t i=0; i<bucket->mCount; i++) {
+                mNegativeFilter->Move(bucket->mKeys[i], &bucket->mValues[i]->mFilterGeneration, myid);
+            }
+        }
+        else if(dNode->isLeaf()) {
+            if(!dNode->Sentinel()) {
+                mNegativeFilter->Move(dNode->mKey, &dNode->mValData->mFilterGeneration, myid);
+            }
+        }
+        else {
+            if(count + 2 > capacity) {
+                capacity *= 2;
+                stack = (DataNode<K, V> **) realloc(stack, sizeof(DataNode<K, V> *) * capacity);
+            }
+            stack[count++] = dNode->mRight.unpack();
+            stack[count++] = dNode->mLeft.unpack();
+        }
+    }
+
+    free(stack);
+    mNegativeFilter->EndGrowth();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+FilterCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetNegativeFilterCounters()
+{
+    return mNegativeFilter->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableTransactions(uint64_t numStripes)
+{
+    auto transactions = (TransactionLocks *) malloc(sizeof(TransactionLocks));
+    transactions->InitializeTransactionLocks(numStripes, mNumThreads);
+    mTransactions = transactions;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::BuildTopIndex()
+{
+    // a single rebuilder at a time; everyone else keeps starting from the root
+    if(mTopIndexDepth == 0 || !__sync_bool_compare_and_swap(&mTopIndexRebuilding, 0, 1)) {
+        return false;
+    }
+
+    uint32_t capacity = (uint32_t) 1 << mTopIndexDepth;
+    auto index = (TopIndex<K, V> *) malloc(sizeof(TopIndex<K, V>));
+    index->InitializeTopIndex(capacity);
+
+    auto visited = (DataNode<K, V> **) malloc(sizeof(DataNode<K, V> *) * capacity);
+    uint32_t numVisited = 0;
+
+    DataNode<K, V> *dRoot = this->pRoot->unpack();
+    if(!dRoot->isLeaf()) {
+        CollectTopIndex(index, dRoot, 0, visited, &numVisited);
+    }
+
+    // the copy is consistent only if none of the nodes it was read from got replaced meanwhile
+    bool valid = index->mCount >= 2;
+    for(uint32_t i = 0; valid && i < numVisited; i++) {
+        valid = !visited[i]->Replaced();
+    }
+
+    free(visited);
+
+    if(valid) {
+        // the previous copy is left to lookups that may still be reading it
+        index->mVersion = __sync_add_and_fetch(&mTopIndexVersion, 1);
+        __atomic_store_n(&mTopIndex, index, __ATOMIC_RELEASE);
+    }
+    else {
+        free(index->mLinks);
+        free(index->mParents);
+        free(index->mSentinelSeparators);
+        free(index->mSeparators);
+        free(index);
+    }
+
+    __atomic_store_n(&mTopIndexRebuilding, 0, __ATOMIC_RELEASE);
+    return valid;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CollectTopIndex(TopIndex<K, V> *index, DataNode<K, V> *dNode, uint32_t depth, DataNode<K, V> **visited, uint32_t *numVisited)
+{
+    // in-order walk of the internal nodes above the index depth
+    visited[(*numVisited)++] = dNode;
+
+    DataNode<K, V> *dLeft = dNode->mLeft.unpack();
+    if(depth + 1 == mTopIndexDepth || dLeft->isLeaf()) {
+        index->mParents[index->mCount] = dNode;
+        index->mLinks[index->mCount] = &dNode->mLeft;
+        index->mCount++;
+    }
+    else {
+        CollectTopIndex(index, dLeft, depth + 1, visited, numVisited);
+    }
+
+    new (&index->mSeparators[index->mCount - 1]) K(dNode->mKey);
+    index->mSentinelSeparators[index->mCount - 1] = dNode->Sentinel();
+
+    DataNode<K, V> *dRight = dNode->mRight.unpack();
+    if(depth + 1 == mTopIndexDepth || dRight->isLeaf()) {
+        index->mParents[index->mCount] = dNode;
+        index->mLinks[index->mCount] = &dNode->mRight;
+        index->mCount++;
+    }
+    else {
+        CollectTopIndex(index, dRight, depth + 1, visited, numVisited);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+template <class Q>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnterTopIndex(const Q &key, DataNode<K, V> **dParent, const K **low, const K **high)
+{
+    TopIndex<K, V> *index = __atomic_load_n(&mTopIndex, __ATOMIC_ACQUIRE);
+
+    if(index == nullptr) {
+        return this->pRoot->unpack();
+    }
+
+    // the entry is the first one whose separator the key is ordered before
+    uint32_t lo = 0;
+    uint32_t hi = index->mCount - 1;
+    while(lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if(index->mSentinelSeparators[mid] | mCompare(key, index->mSeparators[mid])) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+
+    DataNode<K, V> *dEntryParent = index->mParents[lo];
+
+    if(dEntryParent->Replaced()) {
+        // rebuild lazily once enough of the copy has gone stale
+        uint32_t stale = __sync_add_and_fetch(&index->mStale, 1);
+        if(stale * TOP_INDEX_STALE_FRACTION >= index->mCount && index == mTopIndex) {
+            BuildTopIndex();
+        }
+
+        return this->pRoot->unpack();
+    }
+
+    *dParent = dEntryParent;
+    *low = lo > 0 ? &index->mSeparators[lo - 1] : nullptr;
+    *high = lo + 1 < index->mCount && !index->mSentinelSeparators[lo] ? &index->mSeparators[lo] : nullptr;
+    return index->mLinks[lo]->unpack();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnableExpiration()
+{
+    auto expiration = (Expiration *) malloc(sizeof(Expiration));
+    expiration->InitializeExpiration(mNumThreads);
+    mExpiration = expiration;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint64_t ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Sweep(int myid)
+{
+    K keys[EXPIRATION_SWEEP_BATCH];
+    ValueRecord<V> *records[EXPIRATION_SWEEP_BATCH];
+    K after;
+    bool resumed = false;
+    uint64_t removed = 0;
+
+    // each descent is read-only and starts again from the root after the key the
+    // last one stopped at, so the removals in between never leave it on a stale path
+    while(true) {
+        if constexpr(!WordValue<V>::value) {
+            mValueArena->Enter(myid);
+        }
+
+        uint32_t count = 0;
+        CollectExpired(this->pRoot->unpack()->mLeft.unpack(), resumed ? &after : nullptr, mExpiration->Now(), keys, records, &count);
+
+        for(uint32_t i=0; i<count; i++) {
+            removed += RemoveExpired(keys[i], records[i], myid);
+        }
+
+        if(count < EXPIRATION_SWEEP_BATCH) {
+            break;
+        }
+
+        after = keys[count - 1];
+        resumed = true;
+    }
+
+    mExpiration->mCounters[myid].mSweptRemovals += removed;
+    mExpiration->mCounters[myid].mSweeps++;
+    return removed;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CollectExpired(DataNode<K, V> *dNode, const K *after, uint32_t now, K *keys, ValueRecord<V> **records, uint32_t *count)
+{
+    if(dNode->isLeaf()) {
+        LeafBucket<K, V> *bucket = dNode->mBucket;
+        if(bucket != nullptr) {
+            for(uint32_t i=0; i<bucket->mCount && *count < EXPIRATION_SWEEP_BATCH; i++) {
+                ValueRecord<V> *valData = bucket->mValues[i];
+                if((after == nullptr || mCompare(*after, bucket->mKeys[i])) &&
+                   Expiration::KillAt(&valData->mExpires, now)) {
+                    keys[*count] = bucket->mKeys[i];
+                    records[(*count)++] = valData;
+                }
+            }
+        }
+        else if(!dNode->Sentinel() && (after == nullptr || mCompare(*after, dNode->mKey)) &&
+                Expiration::KillAt(&dNode->mValData->mExpires, now)) {
+            keys[*count] = dNode->mKey;
+            records[(*count)++] = dNode->mValData;
+        }
+        return;
+    }
+
+    // the left subtree holds the keys before the node's, so it is skipped once the
+    // sweep has passed them; the depth of the recursion is the height of the tree
+    if(after == nullptr || KeyLess(*after, dNode)) {
+        CollectExpired(dNode->mLeft.unpack(), after, now, keys, records, count);
+    }
+    if(*count < EXPIRATION_SWEEP_BATCH) {
+        CollectExpired(dNode->mRight.unpack(), after, now, keys, records, count);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::StartExpirationSweeper(int myid)
+{
+    RegisterThread(myid);
+
+    mExpiration->mSweeperId = myid;
+    __atomic_store_n(&mExpiration->mRunning, 1, __ATOMIC_RELEASE);
+    pthread_create(&mExpiration->mThread, NULL, SweeperMain, (void *) this);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::StopExpirationSweeper()
+{
+    __atomic_store_n(&mExpiration->mRunning, 0, __ATOMIC_RELEASE);
+    pthread_join(mExpiration->mThread, NULL);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SweeperMain(void *tree)
+{
+    auto self = (ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *) tree;
+    Expiration *expiration = self->mExpiration;
+
+    while(__atomic_load_n(&expiration->mRunning, __ATOMIC_ACQUIRE) != 0) {
+        self->Sweep(expiration->mSweeperId);
+
+        // the sweeper holds no values while it sleeps
+        self->Quiesce(expiration->mSweeperId);
+        usleep(EXPIRATION_IDLE_MICROSECONDS);
+    }
+
+    return nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::IsExpired(ValueRecord<V> *valData)
+{
+    return mExpiration != nullptr && mExpiration->Kill(&valData->mExpires);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Unexpired(ValueRecord<V> *valData, int myid)
+{
+    if(valData == nullptr || !IsExpired(valData)) {
+        return valData;
+    }
+
+    mExpiration->mCounters[myid].mExpiredReads++;
+    return nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::RemoveExpired(const K &key, ValueRecord<V> *valData, int myid)
+{
+    // the record is dead, so no write renews it any more; one that inserted over it
+    // since keeps the key
+    uint64_t *stripe = EnterKeyStripe(key, myid);
+    bool removed = RemoveKey(key, valData, nullptr, true, myid);
+    if(stripe != nullptr) {
+        mTransactions->EndWrite(myid);
+    }
+
+    return removed;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Displaces(OperationRecord<K, V> *opData, DataNode<K, V> *dChild)
+{
+    // every helper of the insert reads the same leaf while the insert owns its window,
+    // but the clock moves on between them; the first decision stands. IsExpired
+    // kills the stamp it finds expired, so a decision to take the leaf over stays right
+    DataNode<K, V> *decided = SyncPolicy::Load(&opData->mDisplaced);
+
+    if(decided == nullptr) {
+        // a bucket gives up only the record of the inserted key, a one-key leaf its own
+        ValueRecord<V> *valData = dChild->mBucket != nullptr ? FindRecord(dChild, opData->mKey) : dChild->Sentinel() ? nullptr : dChild->mValData;
+        bool expired = valData != nullptr && IsExpired(valData);
+
+        SyncPolicy::CompareAndSwap(&opData->mDisplaced, nullptr, expired ? dChild : NOT_DISPLACED);
+        decided = SyncPolicy::Load(&opData->mDisplaced);
+    }
+
+    return decided == dChild;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ReleaseDisplaced(OperationRecord<K, V> *opData, int myid)
+{
+    DataNode<K, V> *dLeaf = SyncPolicy::Load(&opData->mDisplaced);
+    if(dLeaf == nullptr || dLeaf == NOT_DISPLACED) {
+        return;
+    }
+
+    // the leaf left the tree with the insert, and its record with it
+    const K &key = dLeaf->mBucket != nullptr ? opData->mKey : dLeaf->mKey;
+    CloseRecord(key, FindRecord(dLeaf, key), nullptr, myid);
+    mExpiration->mCounters[myid].mLazyRemovals++;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ExpirationCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetExpirationCounters()
+{
+    return mExpiration->GetCounters();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::MultiSearch(const K *keys, V **values, size_t count, int myid)
+{
+    // each key on its own, so every lookup is ordered with the transactions on its stripe
+    if(mTransactions != nullptr) {
+        for(size_t i = 0; i < count; i++) {
+            values[i] = Search(keys[i], myid);
+        }
+        return;
+    }
+
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    // like the heterogeneous Search, these traversals are read-only and bounded
+    // by the height of the tree, so they are not published in the search table
+    DataNode<K, V> *dCurrent[MULTI_SEARCH_GROUP];
+
+    size_t base = 0;
+    while(base < count)
+    {
+        size_t groupSize = count - base < MULTI_SEARCH_GROUP ? count - base : MULTI_SEARCH_GROUP;
+        uint64_t reshards = BeginReshardRead(myid);
+        size_t active = groupSize;
+
+        DataNode<K, V> *dRoot = this->pRoot->unpack();
+        for(size_t i = 0; i < groupSize; i++) {
+            dCurrent[i] = dRoot;
+        }
+
+        // advance every traversal by one level per round; the next node of each
+        // is prefetched so its miss overlaps with the work on the other keys
+        while(active > 0)
+        {
+            active = 0;
+
+            for(size_t i = 0; i < groupSize; i++) {
+                DataNode<K, V> *dNode = dCurrent[i];
+
+                if(dNode->isLeaf()) {
+                    continue;
+                }
+
+                if(dNode->mLeft.mPackedPointer && KeyLess(keys[base + i], dNode)) {
+                    dNode = dNode->mLeft.unpack();
+                }
+                else {
+                    dNode = dNode->mRight.unpack();
+                }
+
+                __builtin_prefetch(dNode);
+                dCurrent[i] = dNode;
+                active++;
+            }
+        }
+
+        for(size_t i = 0; i < groupSize; i++) {
+            DataNode<K, V> *dLeaf = dCurrent[i];
+            ValueRecord<V> *valData = nullptr;
+
+            if(dLeaf->mBucket != nullptr) {
+                int32_t index = dLeaf->mBucket->Find(keys[base + i], mCompare);
+                if(index != -1) {
+                    valData = dLeaf->mBucket->mValues[index];
+                }
+            }
+            else if(KeyEquals(keys[base + i], dLeaf)) {
+                valData = dLeaf->mValData;
+            }
+
+            valData = Unexpired(valData, myid);
+            values[base + i] = valData != nullptr ? valData->ReadValue() : nullptr;
+        }
+
+        // a group is looked up again if a Split or Join cut the tree under it
+        if(EndReshardRead(reshards, myid)) {
+            base += MULTI_SEARCH_GROUP;
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::PeekMin(K *key, V *value, int myid)
+{
+    // a transaction may change the smallest key together with others, so the
+    // smallest key is read between changes of any stripe, and between two cuts
+    // of Split or Join, which can move it too
+    while(true) {
+        uint64_t reshards = BeginReshardRead(myid);
+        uint64_t word = mTransactions != nullptr ? mTransactions->BeginReadAll() : 0;
+        bool found = PeekFirst(key, value, myid);
+
+        if((mTransactions == nullptr || mTransactions->EndReadAll(word, myid)) && EndReshardRead(reshards, myid)) {
+            return found;
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::PeekFirst(K *key, V *value, int myid)
+{
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    while(true) {
+        DataNode<K, V> *dLeaf = EdgeLeaf(this->pRoot->unpack()->mLeft.unpack(), false);
+        if(dLeaf == nullptr) {
+            return false;
+        }
+
+        ValueRecord<V> *valData;
+        LeafEdge(dLeaf, false, key, &valData);
+
+        // an expired smallest key is removed on the way, and the next one looked at
+        if(IsExpired(valData)) {
+            if(RemoveExpired(*key, valData, myid)) {
+                mExpiration->mCounters[myid].mLazyRemovals++;
+            }
+            continue;
+        }
+
+        if constexpr(WordValue<V>::value) {
+            if(value != nullptr) {
+                *value = valData->LoadValue();
+            }
+            return true;
+        }
+        else {
+            // a closed record was removed after the descent read it; look again
+            V *current = valData->ReadValue();
+            if(current != nullptr) {
+                if(value != nullptr) {
+                    *value = *current;
+                }
+                return true;
+            }
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::PopMin(K *key, V *value, int myid, uint32_t spray)
+{
+    return Pop(false, key, value, spray, myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::PopMax(K *key, V *value, int myid, uint32_t spray)
+{
+    return Pop(true, key, value, spray, myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Pop(bool right, K *key, V *value, uint32_t spray, int myid)
+{
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    if(spray > MAX_SPRAY_LEVELS) {
+        spray = MAX_SPRAY_LEVELS;
+    }
+
+    while(true) {
+        DataNode<K, V> *dLeaf = spray != 0 ? SprayLeaf(right, spray, myid) : EdgeLeaf(this->pRoot->unpack()->mLeft.unpack(), right);
+        if(dLeaf == nullptr) {
+            return false;
+        }
+
+        K edgeKey;
+        ValueRecord<V> *valData;
+        LeafEdge(dLeaf, right, &edgeKey, &valData);
+
+        // an expired edge key is removed as well, but not returned
+        if(IsExpired(valData)) {
+            if(RemoveExpired(edgeKey, valData, myid)) {
+                mExpiration->mCounters[myid].mLazyRemovals++;
+            }
+            continue;
+        }
+
+        // the key is removed by exactly one of the pops and deletes racing for it
+        uint64_t *stripe = EnterKeyStripe(edgeKey, myid);
+        bool removed = RemoveKey(edgeKey, valData, value, false, myid);
+        if(stripe != nullptr) {
+            mTransactions->EndWrite(myid);
+        }
+
+        if(removed) {
+            *key = edgeKey;
+            mPopCounters[myid].mPops++;
+            return true;
+        }
+
+        mPopCounters[myid].mRetries++;
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EdgeLeaf(DataNode<K, V> *dNode, bool right)
+{
+    if(dNode->isLeaf()) {
+        bool holdsKeys = dNode->mBucket != nullptr ? dNode->mBucket->mCount != 0 : !dNode->Sentinel();
+        return holdsKeys ? dNode : nullptr;
+    }
+
+    // only the sentinel leaves and emptied buckets hold no keys, so the walk rarely
+    // turns back; the depth of the recursion is the height of the tree
+    DataNode<K, V> *dNear = right ? dNode->mRight.unpack() : dNode->mLeft.unpack();
+    DataNode<K, V> *dLeaf = EdgeLeaf(dNear, right);
+    if(dLeaf != nullptr) {
+        return dLeaf;
+    }
+
+    DataNode<K, V> *dFar = right ? dNode->mLeft.unpack() : dNode->mRight.unpack();
+    return EdgeLeaf(dFar, right);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SprayLeaf(bool right, uint32_t spray, int myid)
+{
+    // walk the spine to the edge leaf, keeping its last spray + 1 internal nodes in a ring;
+    // the right subtree of a sentinel holds only the sentinel leaf, so the max spine skips it
+    DataNode<K, V> *spine[MAX_SPRAY_LEVELS + 1];
+    uint32_t depth = 0;
+    DataNode<K, V> *dCurrent = this->pRoot->unpack()->mLeft.unpack();
+
+    while(!dCurrent->isLeaf()) {
+        spine[depth++ % (MAX_SPRAY_LEVELS + 1)] = dCurrent;
+        dCurrent = right && !dCurrent->Sentinel() ? dCurrent->mRight.unpack() : dCurrent->mLeft.unpack();
+    }
+
+    if(depth != 0) {
+        uint32_t up = depth < spray ? depth : spray;
+        dCurrent = spine[(depth - up) % (MAX_SPRAY_LEVELS + 1)];
+
+        uint64_t seed = mSpraySeeds[myid].mSeed;
+        while(!dCurrent->isLeaf()) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            dCurrent = (seed & 1) && !dCurrent->Sentinel() ? dCurrent->mRight.unpack() : dCurrent->mLeft.unpack();
+        }
+        mSpraySeeds[myid].mSeed = seed;
+    }
+
+    // an empty bucket or the sentinel leaf: fall back to the edge itself
+    if(dCurrent->mBucket != nullptr ? dCurrent->mBucket->mCount == 0 : dCurrent->Sentinel()) {
+        return EdgeLeaf(this->pRoot->unpack()->mLeft.unpack(), right);
+    }
+
+    return dCurrent;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::LeafEdge(DataNode<K, V> *dLeaf, bool right, K *key, ValueRecord<V> **valData)
+{
+    // a bucket is immutable once reachable, and its keys are sorted
+    LeafBucket<K, V> *bucket = dLeaf->mBucket;
+    if(bucket != nullptr) {
+        uint32_t index = right ? bucket->mCount - 1 : 0;
+        *key = bucket->mKeys[index];
+        *valData = bucket->mValues[index];
+    }
+    else {
+        *key = dLeaf->mKey;
+        *valData = dLeaf->mValData;
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+PopCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetPopCounters()
+{
+    return mPopCounters.Sum();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Split(const K &key, ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right, int myid)
+{
+    // a hash index could be published with a record the cut just moved
+    if(right == this || mBucketSize != 0 || right->mBucketSize != 0 || mNegativeFilter != nullptr ||
+       right->mNegativeFilter != nullptr || mHashIndex != nullptr || right->mHashIndex != nullptr) {
+        return false;
+    }
+
+    BeginReshard(right, myid);
+
+    // right may have gained keys since the call was made
+    bool split = right->FiniteSubtree() == nullptr;
+    DataNode<K, V> *dKeys = FiniteSubtree();
+
+    if(split && dKeys != nullptr) {
+        DataNode<K, V> *dLow, *dHigh;
+        SplitSubtree(dKeys, key, &dLow, &dHigh);
+
+        if(dHigh != nullptr) {
+            SetFiniteSubtree(dLow);
+            right->SetFiniteSubtree(dHigh);
+            DropCachedPaths();
+            right->DropCachedPaths();
+        }
+    }
+
+    EndReshard(right);
+    return split;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Join(ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right, int myid)
+{
+    if(right == this || mBucketSize != 0 || right->mBucketSize != 0 || mNegativeFilter != nullptr ||
+       right->mNegativeFilter != nullptr || mHashIndex != nullptr || right->mHashIndex != nullptr) {
+        return false;
+    }
+
+    BeginReshard(right, myid);
+
+    DataNode<K, V> *dLow = FiniteSubtree();
+    DataNode<K, V> *dHigh = right->FiniteSubtree();
+    bool joined = true;
+
+    if(dHigh != nullptr && dLow == nullptr) {
+        SetFiniteSubtree(dHigh);
+    }
+    else if(dHigh != nullptr) {
+        // the smallest key of right routes between the two; it must come after every key here
+        K separator, largest;
+        ValueRecord<V> *valData;
+        LeafEdge(EdgeLeaf(dHigh, false), false, &separator, &valData);
+        LeafEdge(EdgeLeaf(dLow, true), true, &largest, &valData);
+        joined = mCompare(largest, separator);
+
+        if(joined) {
+            uint64_t *seed = &mSpraySeeds[myid].mSeed;
+            uint32_t height;
+            SetFiniteSubtree(JoinSubtrees(dLow, dHigh, separator, EstimateHeight(dLow, seed), EstimateHeight(dHigh, seed), &height, seed));
+        }
+    }
+
+    if(joined && dHigh != nullptr) {
+        right->SetFiniteSubtree(nullptr);
+        DropCachedPaths();
+        right->DropCachedPaths();
+    }
+
+    EndReshard(right);
+    return joined;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::JoinSubtrees(DataNode<K, V> *dLow, DataNode<K, V> *dHigh, const K &separator, uint32_t lowHeight, uint32_t highHeight, uint32_t *height, uint64_t *seed)
+{
+    // as in an AVL join: down the spine of the taller subtree, facing the other, to
+    // a subtree no more than one level taller than the other, which the new node
+    // joins; the nodes on the way back up are rebuilt and rotated where one side
+    // came out two levels taller
+    if(lowHeight > highHeight + 1) {
+        DataNode<K, V> *dLeft = dLow->mLeft.unpack();
+        DataNode<K, V> *dRight = dLow->mRight.unpack();
+        uint32_t joinedHeight;
+        DataNode<K, V> *dJoined = JoinSubtrees(dRight, dHigh, separator, EstimateHeight(dRight, seed), highHeight, &joinedHeight, seed);
+
+        SetReplaced(dLow);
+        return BalanceJoined(dLeft, EstimateHeight(dLeft, seed), dLow->mKey, dJoined, joinedHeight, height, seed);
+    }
+
+    if(highHeight > lowHeight + 1) {
+        DataNode<K, V> *dLeft = dHigh->mLeft.unpack();
+        DataNode<K, V> *dRight = dHigh->mRight.unpack();
+        uint32_t joinedHeight;
+        DataNode<K, V> *dJoined = JoinSubtrees(dLow, dLeft, separator, lowHeight, EstimateHeight(dLeft, seed), &joinedHeight, seed);
+
+        SetReplaced(dHigh);
+        return BalanceJoined(dJoined, joinedHeight, dHigh->mKey, dRight, EstimateHeight(dRight, seed), height, seed);
+    }
+
+    *height = (lowHeight > highHeight ? lowHeight : highHeight) + 1;
+    return NewJoinNode(dLow, separator, dHigh);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::BalanceJoined(DataNode<K, V> *dLeft, uint32_t leftHeight, const K &key, DataNode<K, V> *dRight, uint32_t rightHeight, uint32_t *height, uint64_t *seed)
+{
+    bool right = rightHeight > leftHeight + 1;
+    if(!right && leftHeight <= rightHeight + 1) {
+        *height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+        return NewJoinNode(dLeft, key, dRight);
+    }
+
+    // the taller side is the subtree the join came back with; its child on the
+    // outside is lifted, after a rotation of its own if the inner child is taller
+    DataNode<K, V> *dTall = right ? dRight : dLeft;
+    DataNode<K, V> *dInner = right ? dTall->mLeft.unpack() : dTall->mRight.unpack();
+    DataNode<K, V> *dOuter = right ? dTall->mRight.unpack() : dTall->mLeft.unpack();
+    uint32_t shortHeight = right ? leftHeight : rightHeight;
+    uint32_t innerHeight = EstimateHeight(dInner, seed);
+    uint32_t outerHeight = EstimateHeight(dOuter, seed);
+    SetReplaced(dTall);
+
+    DataNode<K, V> *dShort = right ? dLeft : dRight;
+    DataNode<K, V> *dTop, *dNear, *dFar;
+    uint32_t nearHeight, farHeight;
+
+    if(innerHeight > outerHeight && !dInner->isLeaf()) {
+        // the inner child goes to the top, its subtrees to either side
+        DataNode<K, V> *dInnerNear = right ? dInner->mLeft.unpack() : dInner->mRight.unpack();
+        DataNode<K, V> *dInnerFar = right ? dInner->mRight.unpack() : dInner->mLeft.unpack();
+        uint32_t innerNearHeight = EstimateHeight(dInnerNear, seed);
+        uint32_t innerFarHeight = EstimateHeight(dInnerFar, seed);
+        SetReplaced(dInner);
+
+        dTop = dInner;
+        dNear = right ? NewJoinNode(dShort, key, dInnerNear) : NewJoinNode(dInnerNear, key, dShort);
+        dFar = right ? NewJoinNode(dInnerFar, dTall->mKey, dOuter) : NewJoinNode(dOuter, dTall->mKey, dInnerFar);
+        nearHeight = (shortHeight > innerNearHeight ? shortHeight : innerNearHeight) + 1;
+        farHeight = (innerFarHeight > outerHeight ? innerFarHeight : outerHeight) + 1;
+    }
+    else {
+        dTop = dTall;
+        dNear = right ? NewJoinNode(dShort, key, dInner) : NewJoinNode(dInner, key, dShort);
+        dFar = dOuter;
+        nearHeight = (shortHeight > innerHeight ? shortHeight : innerHeight) + 1;
+        farHeight = outerHeight;
+    }
+
+    *height = (nearHeight > farHeight ? nearHeight : farHeight) + 1;
+    return right ? NewJoinNode(dNear, dTop->mKey, dFar) : NewJoinNode(dFar, dTop->mKey, dNear);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::NewJoinNode(DataNode<K, V> *dLeft, const K &key, DataNode<K, V> *dRight)
+{
+    DataNode<K, V> *dJoin = NewDataNode();
+    dJoin->SetColor(RED);
+    dJoin->SetSentinel(false);
+    dJoin->mKey = key;
+    dJoin->mLeft.InitializePointerNode(dLeft, Flag::FREE);
+    dJoin->mRight.InitializePointerNode(dRight, Flag::FREE);
+    return dJoin;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint32_t ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EstimateHeight(DataNode<K, V> *dNode, uint64_t *seed)
+{
+    // the nodes keep no heights, so the deepest of a few descents stands in for
+    // the height: both spines, and random ones
+    uint32_t height = 0;
+
+    for(uint32_t i=0; i<JOIN_HEIGHT_DESCENTS + 2; i++) {
+        DataNode<K, V> *dCurrent = dNode;
+        uint32_t depth = 0;
+
+        while(!dCurrent->isLeaf()) {
+            bool right = i == 1;
+            if(i >= 2) {
+                *seed ^= *seed << 13;
+                *seed ^= *seed >> 7;
+                *seed ^= *seed << 17;
+                right = *seed & 1;
+            }
+            dCurrent = right ? dCurrent->mRight.unpack() : dCurrent->mLeft.unpack();
+            depth++;
+        }
+
+        height = depth > height ? depth : height;
+    }
+
+    return height;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::BeginReshard(ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right, int myid)
+{
+    // in address order, so two calls sharing a tree never wait on each other in a cycle
+    ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *first = this < right ? this : right;
+    ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *second = this < right ? right : this;
+
+    // a single owner applies its operations in place, outside the protocol
+    first->RegisterThread(myid);
+    second->RegisterThread(myid);
+
+    // writes first: one waiting for the root of a tree would hold this call off
+    first->LockReshards();
+    second->LockReshards();
+
+    first->OwnRootAndDrain();
+    second->OwnRootAndDrain();
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EndReshard(ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy> *right)
+{
+    ReleaseRoot();
+    right->ReleaseRoot();
+
+    // the cut, the new top indexes included, is visible before mReshards is even again
+    __atomic_add_fetch(&mReshards, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&right->mReshards, 1, __ATOMIC_RELEASE);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::LockReshards()
+{
+    while(true) {
+        uint64_t reshards = __atomic_load_n(&mReshards, __ATOMIC_ACQUIRE);
+        if((reshards & 1) != 0) {
+            sched_yield();
+        }
+        else if(__atomic_compare_exchange_n(&mReshards, &reshards, reshards + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
 
-    // initialize the operation state
-    opData->mState->setTag(Status::IN_PROGRESS);
+    // a write announces itself before it reads mReshards, and this call made it odd
+    // before reading the announcements, so every write either is seen here or sees
+    // the cut coming and waits
+    for(uint32_t i=0; i<mNumThreads; i++) {
+        while(__atomic_load_n(&mReshardWriters[i].mWriting, __ATOMIC_SEQ_CST) != 0) {
+            sched_yield();
+        }
+    }
+}
 
-    // initialize the search table entry
-    ST[myid] = opData;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::OwnRootAndDrain()
+{
+    // the root is owned like any operation owns it, helping the one there move down
+    DataNode<K, V> *dRoot = this->pRoot->unpack();
+    OperationRecord<K, V> *opData = NewOperationRecord(Type::RESHARD, K(), nullptr);
 
-    // traverse the tree
-    Traverse(opData);
+    while(true) {
+        uint64_t owner = SyncPolicy::Load(&dRoot->mOwner);
+        OperationRecord<K, V> *rootOwner = DataNode<K, V>::OwnerOf(owner);
 
-    if(opData->mState == nullptr) {
-        // read the value stored in the record and return it
-        return opData->mValue;
+        if(rootOwner != nullptr) {
+            HelpWindowOwner(rootOwner, dRoot);
+        }
+        else if(SyncPolicy::CompareAndSwap(&dRoot->mOwner, owner, DataNode<K, V>::NextOwner(owner, opData))) {
+            break;
+        }
     }
-    else {
-        return nullptr;
+
+    // no operation can enter now; the ones inside own a window below the root
+    // and are in the modify table, so running them to completion empties the tree
+    for(uint32_t pid=0; pid<mNumThreads; pid++) {
+        OperationRecord<K, V> *pidOpData = __atomic_load_n(&MT[pid], __ATOMIC_ACQUIRE);
+        if(pidOpData == nullptr) {
+            continue;
+        }
+
+        StateNode<Position<K, V>, Status> sCurrent(SyncPolicy::Load(&pidOpData->mState->mPackedPointer));
+        while(sCurrent.getStatus() == Status::IN_PROGRESS) {
+            ExecuteWindowTransaction(pidOpData, sCurrent.unpack());
+            sCurrent.mPackedPointer = SyncPolicy::Load(&pidOpData->mState->mPackedPointer);
+        }
     }
 }
 
-template <class V>
-void ConcurrentTree<V>::InsertOrUpdate(uint32_t key, V *value, int myid)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ReleaseRoot()
 {
-    ValueRecord<V> *valData = nullptr;
+    DataNode<K, V> *dRoot = this->pRoot->unpack();
+    uint64_t owner = SyncPolicy::Load(&dRoot->mOwner);
+    SyncPolicy::Store(&dRoot->mOwner, DataNode<K, V>::NextOwner(owner, nullptr));
+}
 
-    // phase 1: determine if the key already exists in the tree
-    Search(key, myid);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EnterReshardWriter(int myid)
+{
+    if(mReshardWriters[myid].mWriting != 0) {
+        return false;
+    }
 
-    valData = this->ST[myid]->mState->unpack()->valueRecord;
+    // announced before reading mReshards, the reverse of LockReshards
+    while(true) {
+        __atomic_store_n(&mReshardWriters[myid].mWriting, 1, __ATOMIC_SEQ_CST);
+        if((__atomic_load_n(&mReshards, __ATOMIC_SEQ_CST) & 1) == 0) {
+            return true;
+        }
 
-    if(valData == nullptr) {
-        // phase 2: try to add the key-value pair to the tree using the MTL-framework
-        // select a search operation to help at the end of phase 2 to ensure wait freedom
-        uint32_t pid = Select(); // the process selected to help in round-robin manner
-        OperationRecord<V> *pidOpData = this->ST[pid];
+        __atomic_store_n(&mReshardWriters[myid].mWriting, 0, __ATOMIC_RELEASE);
+        while((__atomic_load_n(&mReshards, __ATOMIC_ACQUIRE) & 1) != 0) {
+            sched_yield();
+        }
+    }
+}
 
-        // create and initialize a new operation record
-        OperationRecord<V> *opData = new OperationRecord<V>(Type::INSERT, key, value);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ExitReshardWriter(int myid)
+{
+    __atomic_store_n(&mReshardWriters[myid].mWriting, 0, __ATOMIC_RELEASE);
+}
 
-        // add the key-value pair to the tree
-        ExecuteOperation(opData, myid);
-        valData = opData->mState->unpack()->valueRecord;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+uint64_t ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::BeginReshardRead(int myid)
+{
+    // a cut waits for this thread's write, so it cannot be under way
+    if(mReshardWriters[myid].mWriting != 0) {
+        return 0;
+    }
 
-        // help the selected search operation complete
-        if(pidOpData != nullptr) {
-            Traverse(pidOpData);
-        }
+    uint64_t reshards;
+    while(((reshards = __atomic_load_n(&mReshards, __ATOMIC_ACQUIRE)) & 1) != 0) {
+        sched_yield();
     }
+    return reshards;
+}
 
-    if(valData != nullptr) {
-        // phase 3: update the value in the record using Chuong et al.'s algorithm
-        // TODO: implement Chuong et al.'s algorithm
-        /*
-            valData->mValue = value;
-        */
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::EndReshardRead(uint64_t reshards, int myid)
+{
+    if(mReshardWriters[myid].mWriting != 0) {
+        return true;
     }
+
+    // the reads of the lookup are ordered before the check
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&mReshards, __ATOMIC_RELAXED) == reshards;
 }
 
-template <class V>
-void ConcurrentTree<V>::Delete(uint32_t key, int myid)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SplitSubtree(DataNode<K, V> *dNode, const K &key, DataNode<K, V> **dLow, DataNode<K, V> **dHigh)
 {
-    // phase 1: determine if the key already exists in the tree
-    if(Search(key, myid)) {
-        // phase 2: try to delete the key from the tree using the MTL-framework
-        // select a search operation to help at the end of phase 2 to ensure wait-freedom
-        uint32_t pid = Select(); // the process selected to help in a round-robin manner
-        OperationRecord<V> *pidOpData = ST[pid];
+    if(dNode->isLeaf()) {
+        bool low = mCompare(dNode->mKey, key);
+        *dLow = low ? dNode : nullptr;
+        *dHigh = low ? nullptr : dNode;
+        return;
+    }
 
-        // create and initialize a new operation record
-        OperationRecord<V> *opData = new OperationRecord<V>(Type::DELETE, key, nullptr);
-        // = (OperationRecord<V> *) malloc(sizeof(OperationRecord<V>));
-        // opData->InitializeOperationRecord(Type::DELETE, key, nullptr);
-        // opData->mType = Type::DELETE;
-        // opData->mKey = key;
-        // opData->mValue = nullptr;
+    // the cut follows the search path of key: the subtree on the other side of the
+    // path goes whole to one half, and the node stays whole if the cut leaves one side empty
+    DataNode<K, V> *dLower, *dUpper;
+    if(KeyLess(key, dNode)) {
+        SplitSubtree(dNode->mLeft.unpack(), key, &dLower, &dUpper);
+        if(dLower == nullptr) {
+            *dLow = nullptr;
+            *dHigh = dNode;
+            return;
+        }
 
-        //remove the key from the tree
-        ExecuteOperation(opData, myid);
+        *dLow = dLower;
+        if(dUpper == nullptr) {
+            *dHigh = dNode->mRight.unpack();
+        }
+        else {
+            *dHigh = CloneDataNode(dNode);
+            (*dHigh)->mLeft.InitializePointerNode(dUpper, Flag::FREE);
+        }
+    }
+    else {
+        SplitSubtree(dNode->mRight.unpack(), key, &dLower, &dUpper);
+        if(dUpper == nullptr) {
+            *dLow = dNode;
+            *dHigh = nullptr;
+            return;
+        }
 
-        if(pidOpData != nullptr) {
-            // help the selected search operation complete
-            Traverse(pidOpData);
+        *dHigh = dUpper;
+        if(dLower == nullptr) {
+            *dLow = dNode->mLeft.unpack();
+        }
+        else {
+            *dLow = CloneDataNode(dNode);
+            (*dLow)->mRight.InitializePointerNode(dLower, Flag::FREE);
         }
     }
+
+    SetReplaced(dNode);
 }
 
-template <class V>
-uint32_t ConcurrentTree<V>::Select()
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::FiniteSubtree()
 {
-    uint32_t fetched_pid = this->mIndex;
-    this->mIndex = (this->mIndex + 1) % this->mNumThreads;
-    return fetched_pid;
+    // an empty tree has only the sentinel leaf there; rotations never move the sentinel
+    DataNode<K, V> *dTop = this->pRoot->unpack()->mLeft.unpack();
+    return dTop->isLeaf() ? nullptr : dTop->mLeft.unpack();
 }
 
-template <class V>
-void ConcurrentTree<V>::Traverse(OperationRecord<V> *opData)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SetFiniteSubtree(DataNode<K, V> *dSubtree)
 {
-    // start from the root of the tree
-    DataNode<V> *dCurrent = this->pRoot->unpack();
+    DataNode<K, V> *dRoot = this->pRoot->unpack();
+    DataNode<K, V> *dOld = dRoot->mLeft.unpack();
+
+    // the same shape an insert into the empty tree builds: a sentinel over the keys and the sentinel leaf
+    DataNode<K, V> *dTop = NewDataNode();
+    if(dSubtree != nullptr) {
+        dTop->mLeft.InitializePointerNode(dSubtree, Flag::FREE);
+        dTop->mRight.InitializePointerNode(NewDataNode(), Flag::FREE);
+    }
 
-    // find a leaf
-    while(dCurrent->mLeft != nullptr || dCurrent->mRight != nullptr)
-    {
-        // abort the traversal if no longer needed
-        if(opData->mState->getTag() == Status::COMPLETED) {
-            return;
-        }
+    SetReplaced(dOld);
 
-        // find the next node to visit
-        if(dCurrent->mLeft && opData->mKey < dCurrent->mKey) {
-            dCurrent = dCurrent->mLeft->mPackedPointer;
-        }
-        else if(dCurrent->mRight) {
-            dCurrent = dCurrent->mRight->mPackedPointer;
-        }
+    PointerNode<DataNode<K, V>, Flag> pTop(nullptr);
+    pTop.InitializePointerNode(dTop, Flag::FREE);
+    SyncPolicy::Store(&dRoot->mLeft.mPackedPointer, pTop.mPackedPointer);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::DropCachedPaths()
+{
+    // fingers are dropped by their owners, which find mReshards changed. a small
+    // tree gets no top index; searches then start from the root
+    if(mTopIndex != nullptr && !BuildTopIndex()) {
+        __atomic_store_n(&mTopIndex, nullptr, __ATOMIC_RELEASE);
+    }
+
+    if(mHotKeyCache != nullptr) {
+        mHotKeyCache->InvalidateAll();
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::Traverse(OperationRecord<K, V> *opData, Finger<K, V> *finger)
+{
+    DataNode<K, V> *dCurrent = FindLeaf(opData->mKey, opData, finger);
+
+    if(dCurrent == nullptr) {
+        return;
     }
 
     // leafy stuff
-    Position<V> *valData;
+    Position<K, V> *valData = NewPosition();
 
-    if(dCurrent->mKey == opData->mKey) {
+    if(dCurrent->mBucket != nullptr) {
+        int32_t index = dCurrent->mBucket->Find(opData->mKey, mCompare);
+        valData->valueRecord = index != -1 ? dCurrent->mBucket->mValues[index] : nullptr;
+    }
+    else if(KeyEquals(opData->mKey, dCurrent)) {
         valData->valueRecord = dCurrent->mValData;
     }
     else {
@@ -133,400 +2318,672 @@ void ConcurrentTree<V>::Traverse(OperationRecord<V> *opData)
     opData->mState->setStatus(Status::COMPLETED);
 }
 
-template <class V>
-void ConcurrentTree<V>::ExecuteOperation(OperationRecord<V> *opData, int myid)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ExecuteOperation(OperationRecord<K, V> *opData, int myid)
 {
     // initialize the operation state
     opData->mState->setStatus(Status::WAITING);
 
     // initialize the modify table entry
+    opData->mPid = myid;
     MT[myid] = opData;
 
     // select a modify operation to help later at the end to ensure wait-freedom
     uint32_t pid = this->Select(); // the process selected to help in round-robin manner;
 
-    OperationRecord<V> *pidOpData = MT[pid];
+    OperationRecord<K, V> *pidOpData = MT[pid];
 
     // inject the operation into the tree
     this->InjectOperation(opData);
 
     // repeatedly execute transactions until the operation completes
-    StateNode<Position<V>, Status> *sCurrent = opData->mState;
-    Position<V> *pCurrent = sCurrent->mPackedPointer;
-    while(sCurrent->getStatus() != Status::COMPLETED)
+    StateNode<Position<K, V>, Status> sCurrent(SyncPolicy::Load(&opData->mState->mPackedPointer));
+    while(sCurrent.getStatus() != Status::COMPLETED)
     {
-        DataNode<V> *dCurrent = pCurrent->windowLocation->mPackedPointer;
+        ExecuteWindowTransaction(opData, sCurrent.unpack());
+        sCurrent.mPackedPointer = SyncPolicy::Load(&opData->mState->mPackedPointer);
+    }
 
-        if(dCurrent->mOpData == opData) {
-            ExecuteWindowTransaction(pCurrent, dCurrent);
-        }
+    mWindowCounters[myid].mCheap += opData->mCheapTransactions;
+    mWindowCounters[myid].mFull += opData->mFullTransactions;
+
+    // in relaxed-balance mode logging the violation is all a writer does
+    if(mBalance != nullptr && SyncPolicy::Load(&opData->mViolation)) {
+        mBalance->Mark(opData->mKey, myid);
+    }
 
-        sCurrent = opData->mState;
+    // the key's record may have been removed or replaced; drop it from the cache
+    // now that the change is visible, so later fills see the new epoch
+    if(mHotKeyCache != nullptr) {
+        mHotKeyCache->Invalidate(opData->mKey, myid);
     }
 
-    if(opData->mPid != -1) {
+    if(ShouldHelp(pidOpData, mNumThreads + pid, myid)) {
         // help inject the selected operation
         InjectOperation(pidOpData);
     }
 }
 
-template <class V>
-void ConcurrentTree<V>::InjectOperation(OperationRecord<V> *opData)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::InjectOperation(OperationRecord<K, V> *opData)
 {
+    // the root data node is never replaced, so injecting the operation means owning it
+    DataNode<K, V> *dRoot = this->pRoot->unpack();
+
     // repeatedly try until the operation is injected into the tree
-    while(opData->mState->getTag() == Status::WAITING)
+    while(true)
     {
-        DataNode<V> *dRoot = this->pRoot->mPackedPointer;
-
-        // execute a window transaction, if needed
-        if(dRoot->mOpData != nullptr) {
-            ExecuteWindowTransaction(this->GetPRootAsPosition(), dRoot);
+        StateNode<Position<K, V>, Status> sCurrent(SyncPolicy::Load(&opData->mState->mPackedPointer));
+        if(sCurrent.getStatus() != Status::WAITING) {
+            return;
         }
 
-        // read the address of the data node again
-        DataNode<V> *dNow = this->pRoot->mPackedPointer;
+        uint64_t owner = SyncPolicy::Load(&dRoot->mOwner);
+        OperationRecord<K, V> *rootOwner = DataNode<K, V>::OwnerOf(owner);
 
-        // if they match, then try to inject the operation into the tree,
-        // othewise restart
-        if(dRoot == dNow)
-        {
-            DataNode<V> *dCopy = dRoot->clone();
-            dCopy->mOpData = opData;
+        if(rootOwner == opData) {
+            // the operation has been injected, but its state has not been updated yet
+            AdvanceState(opData, sCurrent.mPackedPointer, GetWindowAsPosition(dRoot), Status::IN_PROGRESS);
+        }
+        else if(rootOwner != nullptr && rootOwner->mType == Type::RESHARD) {
+            // a Split or Join holds the root while it cuts the tree; it has no
+            // transactions to help with
+            sched_yield();
+        }
+        else if(rootOwner != nullptr) {
+            // help the operation at the root move out of the way
+            HelpWindowOwner(rootOwner, dRoot);
+        }
+        else if(SyncPolicy::Load(&opData->mState->mPackedPointer) == sCurrent.mPackedPointer) {
+            // still waiting after the owner word was read, so a success cannot re-inject
+            // an operation that has already moved on; try to obtain the ownership of the root
+            SyncPolicy::CompareAndSwap(&dRoot->mOwner, owner, DataNode<K, V>::NextOwner(owner, opData));
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::HelpWindowOwner(OperationRecord<K, V> *owner, DataNode<K, V> *dNode)
+{
+    // run the transactions of the operation owning dNode until it has moved off the node
+    while(GetOwner(dNode) == owner)
+    {
+        StateNode<Position<K, V>, Status> sOwner(SyncPolicy::Load(&owner->mState->mPackedPointer));
 
-            auto pRootFree = new PointerNode<DataNode<V>, Flag>(dRoot, Flag::FREE);
-            auto pCopyOwned = new PointerNode<DataNode<V>, Flag>(dCopy, Flag::OWNED);
+        if(sOwner.getStatus() == Status::WAITING) {
+            // only the root is owned before the state says so
+            AdvanceState(owner, sOwner.mPackedPointer, GetWindowAsPosition(dNode), Status::IN_PROGRESS);
+        }
+        else if(sOwner.getStatus() == Status::IN_PROGRESS) {
+            ExecuteWindowTransaction(owner, sOwner.unpack());
+        }
+        else {
+            // a final transaction releases its window before completing the operation
+            break;
+        }
+    }
+}
 
-            // try to obtain the ownership of the root of the tree
-            if(__sync_bool_compare_and_swap(&(this->pRoot->mPackedPointer), pRootFree->mPackedPointer, pCopyOwned->mPackedPointer)) {
-                // the operation has been successfully injected
-                // update the operation state
-                auto pRootAsPosition = new Position<V>();
-                pRootAsPosition->windowLocation = this->pRoot;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ExecuteWindowTransaction(OperationRecord<K, V> *opData, Position<K, V> *pNode)
+{
+    // execute the transaction of the operation's window rooted at pNode
+    DataNode<K, V> *dNode = pNode->window;
 
-                auto pRootWaiting = new StateNode<Position<V>, Status>(pRootAsPosition, Status::WAITING);
-                auto pRootInProgress = new StateNode<Position<V>, Status>(pRootAsPosition, Status::IN_PROGRESS);
+    if(GetOwner(dNode) != opData) {
+        // the transaction has already been executed; the operation state may lag behind
+        CompleteWindowTransaction(opData, pNode);
+        return;
+    }
 
-                __sync_bool_compare_and_swap(&(opData->mState->mPackedPointer), pRootWaiting->mPackedPointer, pRootInProgress->mPackedPointer);
+    PointerNode<DataNode<K, V>, Flag> *pChild = ChildLink(dNode, opData->mKey);
+    DataNode<K, V> *dChild = pChild->unpack();
 
-                free(pRootInProgress);
-                free(pRootWaiting);
-            }
+    // an operation residing at the next node entered the tree earlier; help it move out of the way
+    OperationRecord<K, V> *childOwner = GetOwner(dChild);
+    if(childOwner != nullptr && childOwner != opData) {
+        HelpWindowOwner(childOwner, dChild);
+        return;
+    }
 
-            free(pCopyOwned);
-            free(pRootFree);
+    // a rotation also replaces the child it lifts, so an operation in it moves out
+    // first; none can enter either node afterwards without owning this window
+    if(opData->mType == Type::REBALANCE && dChild == opData->mRotate) {
+        DataNode<K, V> *dLifted = opData->mRotateRight ? dChild->mLeft.unpack() : dChild->mRight.unpack();
+        OperationRecord<K, V> *liftedOwner = dLifted != nullptr ? GetOwner(dLifted) : nullptr;
+        if(liftedOwner != nullptr && liftedOwner != opData) {
+            HelpWindowOwner(liftedOwner, dLifted);
+            return;
         }
     }
-}
 
+    if(ExecuteCheapWindowTransaction(opData, pNode, dChild)) {
+        return;
+    }
 
-template<class V>
-void ConcurrentTree<V>::ExecuteWindowTransaction(Position<V> *pNode, DataNode<V> *dNode)
-{
-    // execute a window transaction for the operation stored in dNode
-    OperationRecord<V> *opData = dNode->mOpData;
-    PointerNode<DataNode<V>, Flag> *pCurrent = pNode->windowLocation; // read the contents of pNode again
-    if (pCurrent->unpack()->mOpData == opData) {
-        if (pCurrent->getFlag() == Flag::OWNED) {
-            if (pNode->windowLocation->unpack() == this->pRoot->unpack()) {
-                // the operation may have just been injected into the tree, but the operation
-                // state may not have been updated yet; update the state
-                auto pRootAsPosition = new Position<V>();
-                pRootAsPosition->windowLocation = this->pRoot;
-
-                auto pRootWaiting = new StateNode<Position<V>, Status>(pRootAsPosition, Status::WAITING);
-                auto pRootInProgress = new StateNode<Position<V>, Status>(pRootAsPosition, Status::IN_PROGRESS);
+    // the operation takes effect in this window: build the replacement for the
+    // child, and find the record that is the outcome of the operation
+    DataNode<K, V> *dLeaf = nullptr;
+    ValueRecord<V> *valData = nullptr;
+    DataNode<K, V> *dReplacement = BuildReplacement(opData, dChild, &dLeaf, &valData);
 
-                __sync_bool_compare_and_swap(&(opData->mState->mPackedPointer), pRootWaiting->mPackedPointer, pRootInProgress->mPackedPointer);
+    // everything above was read while the operation owned the window, unless it
+    // no longer does; in that case another helper has finished the transaction
+    if(GetOwner(dNode) != opData) {
+        if(dReplacement != nullptr) {
+            DiscardReplacement(dReplacement, opData);
+        }
+        CompleteWindowTransaction(opData, pNode);
+        return;
+    }
 
-                free(pRootInProgress);
-                free(pRootWaiting);
+    if(dReplacement != nullptr) {
+        // every helper that got this far read the leaf while the insert owned the window
+        if(opData->mType == Type::INSERT) {
+            SyncPolicy::Store(&opData->mInserted, true);
+            if(mBalance != nullptr && dReplacement->Red() && dNode->Red()) {
+                SyncPolicy::Store(&opData->mViolation, true);
             }
+        }
 
-            if(ExecuteCheapWindowTransaction(pNode, pCurrent->mPackedPointer) == false) {
-
-                // traverse the window using Tarjan’s algorithm, making copies as required
-                
-                DataNode<V> *windowSoFar = pCurrent->unpack()->clone();
-
-                PointerNode<DataNode<V>, Flag> *pNextToAdd;
-                DataNode<V> *dNextToAdd;
+        // a helper that reads the window after the delete took effect no longer finds
+        // the key, so the removed record is noted first for whichever helper publishes
+        if(opData->mType == Type::DELETE && valData != nullptr) {
+            SyncPolicy::CompareAndSwap(&opData->mRemoved, nullptr, valData);
+        }
 
-                bool leftAcquired = false;
-                bool rightAcquired = false;
+        MarkReplaced(dChild, dLeaf, dReplacement);
 
-                while(true)
-                {
-                    bool isLeft = false;
+        // a node never returns to a link it has left, so a stale helper's CAS fails
+        PointerNode<DataNode<K, V>, Flag> pReplacement(nullptr);
+        pReplacement.InitializePointerNode(dReplacement, Flag::FREE);
+        if(!SyncPolicy::CompareAndSwap(&pChild->mPackedPointer, dChild, pReplacement.mPackedPointer)) {
+            DiscardReplacement(dReplacement, opData);
+        }
 
-                    if(!leftAcquired) {
-                        pNextToAdd = pCurrent->unpack()->mLeft; // the address of the pointer node of the next tree node to be copied;
-                        isLeft = true;
-                    }
-                    else if(!rightAcquired) {
-                        pNextToAdd = pCurrent->unpack()->mRight; // the address of the pointer node of the next tree node to be copied;
-                    }
-                    else {
-                        break;
-                    }
+        // the record of an inserted key is whichever helper's copy got installed
+        if(opData->mType == Type::INSERT) {
+            valData = FindRecord(pChild->unpack(), opData->mKey);
+        }
+    }
 
-                    if(pNextToAdd == nullptr) {
-                        if(isLeft) {
-                            leftAcquired = true;
-                        }
-                        else {
-                            rightAcquired = true;
-                        }
+    if(opData->mType == Type::DELETE && valData == nullptr) {
+        valData = SyncPolicy::Load(&opData->mRemoved);
+    }
 
-                        continue;
-                    }
+    // publish the outcome while still owning the window, then release it and complete the operation
+    Position<K, V> *pResult = GetValueAsPosition(valData);
+    if(GetOwner(dNode) == opData && SyncPolicy::CompareAndSwap(&opData->mResult, nullptr, pResult)) {
+        SyncPolicy::FetchAndAdd(&opData->mFullTransactions, 1);
+    }
 
-                    dNextToAdd = pNextToAdd->mPackedPointer;
+    uint64_t owner = SyncPolicy::Load(&dNode->mOwner);
+    if(DataNode<K, V>::OwnerOf(owner) == opData && opData->mResult != nullptr) {
+        SyncPolicy::CompareAndSwap(&dNode->mOwner, owner, DataNode<K, V>::NextOwner(owner, nullptr));
+    }
 
-                    // help the operation located at this node, if any, move out of the way
-                    if (dNextToAdd->mOpData != nullptr) {
-                        ExecuteWindowTransaction(this->GetPointerNodeAsPosition(pNextToAdd), dNextToAdd);
-                    }
+    CompleteWindowTransaction(opData, pNode);
+}
 
-                    // read the address of the data node again as it may have changed
-                    dNextToAdd = pNextToAdd->mPackedPointer;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ExecuteCheapWindowTransaction(OperationRecord<K, V> *opData, Position<K, V> *pNode, DataNode<K, V> *dChild)
+{
+    // the window transactions keep no balance invariant of their own, since
+    // rebalancing is left to REBALANCE operations (relaxed_balance.hpp). so the only
+    // window an operation restructures is the one where it takes effect; above it
+    // the window moves down without copying a node. CheckInvariants checks the shape
+    // this leaves once the tree is quiescent
+    if(IsFinalWindow(opData, dChild)) {
+        return false;
+    }
 
-                    // copy pNextToAdd and dNextToAdd, and add them to windowSoFar;
-                    if(isLeft) {
-                        windowSoFar->mLeft = new PointerNode<DataNode<V>, Flag>(dNextToAdd->clone(), pNextToAdd->getFlag());
-                        leftAcquired = true;
-                    }
-                    else {
-                        windowSoFar->mRight = new PointerNode<DataNode<V>, Flag>(dNextToAdd->clone(), pNextToAdd->getFlag());
-                        rightAcquired = true;
-                    }
-                }
+    SlideWindowDown(opData, pNode, dChild);
+    return true;
+}
 
-                DataNode<V> *dWindowRoot = windowSoFar;
-                // window has been copied; now apply transformations dictated by Tarjan’ algorithm to windowSoFar;
-                if(!(windowSoFar->mLeft == nullptr && windowSoFar->mRight == nullptr)) {
-                    // rotate
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::IsFinalWindow(OperationRecord<K, V> *opData, DataNode<K, V> *dChild)
+{
+    // an operation only changes the tree where its leaf hangs off the window
+    if(dChild->isLeaf()) {
+        return true;
+    }
 
-                    // dWindowRoot = the address of the data node now acting as window root in windowSoFar;
-                }
+    // a rotation changes the link to the node it rotates; if the node has left the
+    // tree, the operation reaches a leaf and changes nothing
+    if(opData->mType == Type::REBALANCE) {
+        return dChild == opData->mRotate;
+    }
 
-                Position<V> *pMoveTo;
-                DataNode<V> *dMoveTo;
+    // a delete unlinks the child together with the leaf below it
+    if(opData->mType == Type::DELETE) {
+        DataNode<K, V> *dGrandchild = ChildLink(dChild, opData->mKey)->unpack();
+        if(dGrandchild->isLeaf() && dGrandchild->mBucket == nullptr && KeyEquals(opData->mKey, dGrandchild)) {
+            return true;
+        }
+    }
 
-                if (windowSoFar->mNext == nullptr/*last/terminal window transaction*/) {
-                    opData->mState->setStatus(COMPLETED);
+    return false;
+}
 
-                    // the address of the record containing the value : if an update operation;
-                    // null : otherwise;
-                    if(opData->mType == Type::UPDATE) {
-                        pMoveTo->valueRecord = opData->mState->unpack()->valueRecord;
-                    }
-                    else {
-                        pMoveTo = nullptr;
-                    }
-                }
-                else {
-                    opData->mState->setStatus(IN_PROGRESS);
-                    pMoveTo = windowSoFar->mNext->mPackedPointer; // the address of the pointer node of the node in windowSoFar to which the operation will now move;
-                    pMoveTo->windowLocation->setFlag(Flag::OWNED);
-                    dMoveTo = pMoveTo->windowLocation->mPackedPointer;
-                    dMoveTo->mOpData = opData;
-                }
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::BuildReplacement(OperationRecord<K, V> *opData, DataNode<K, V> *dChild, DataNode<K, V> **dLeaf, ValueRecord<V> **valData)
+{
+    DataNode<K, V> *dReplacement = nullptr;
 
-                dWindowRoot->mOpData = opData;
-                auto pMoveToAsNextNode = new NextNode<Position<V>, Status>(pMoveTo, dWindowRoot->mOpData->mState->getStatus());
-                dWindowRoot->mNext->mPackedPointer = pMoveTo; // {status, pMoveTo};
+    if(opData->mType == Type::REBALANCE) {
+        if(dChild == opData->mRotate) {
+            dReplacement = NewRotation(dChild, opData->mRotateRight, dLeaf);
+        }
+    }
+    else if(dChild->isLeaf()) {
+        // an insert that finds the key's record expired takes it over
+        bool displace = opData->mType == Type::INSERT && mExpiration != nullptr && Displaces(opData, dChild);
 
-                // replace the tree window with the local copy and release the ownership
-                auto pCurrentOwned = new PointerNode<DataNode<V>, Flag>(pCurrent->unpack(), Flag::OWNED);
-                auto pWindowRootFree = new PointerNode<DataNode<V>, Flag>(dWindowRoot, Flag::FREE);
+        if(opData->mType == Type::INSERT && mNegativeFilter != nullptr) {
+            bool present = dChild->mBucket != nullptr ? dChild->mBucket->Find(opData->mKey, mCompare) != -1 : KeyEquals(opData->mKey, dChild);
+            CountInsert(opData, displace || !present);
+        }
 
-                // TODO: Verify
-                __sync_bool_compare_and_swap(&(pNode->windowLocation->mPackedPointer), pCurrentOwned->mPackedPointer, pWindowRootFree->mPackedPointer);
+        if(dChild->mBucket != nullptr) {
+            int32_t index = dChild->mBucket->Find(opData->mKey, mCompare);
+            if(index != -1 && opData->mExpected != nullptr && dChild->mBucket->mValues[index] != opData->mExpected) {
+                index = -1;
+            }
+            if(index != -1 && !displace) {
+                *valData = dChild->mBucket->mValues[index];
+            }
 
-                free(pWindowRootFree);
-                free(pCurrentOwned);
+            // inserting a missing key or deleting a present one changes the bucket
+            if((opData->mType == Type::INSERT) == (index == -1) || displace) {
+                dReplacement = CloneDataNode(dChild);
+                ApplyToBucket(dReplacement, opData);
             }
         }
+        else if(displace) {
+            // the expired leaf is replaced by the key's, whether it held the key or its
+            // neighbour; both lie in the range that leads to the leaf
+            dReplacement = NewDataNode();
+            dReplacement->SetSentinel(false);
+            dReplacement->mKey = opData->mKey;
+            InitializeInsertedRecord(dReplacement->mValData, opData);
+        }
+        else if(KeyEquals(opData->mKey, dChild)) {
+            // inserted by another operation since this one's search phase
+            *valData = dChild->mValData;
+        }
+        else if(opData->mType == Type::INSERT) {
+            dReplacement = NewInternalWithLeaf(dChild, opData);
+        }
+    }
+    else {
+        // a delete whose leaf hangs off the child: the leaf's sibling takes the child's
+        // place, unless the key has since moved on from the record the delete expects
+        *dLeaf = ChildLink(dChild, opData->mKey)->unpack();
+        if(opData->mExpected != nullptr && (*dLeaf)->mValData != opData->mExpected) {
+            *dLeaf = nullptr;
+            return nullptr;
+        }
 
-        // at this point, no operation should own pNode; may still need to update the
-        // operation state with the new position of the operation window
-        DataNode<V> *dNow = pNode->windowLocation->mPackedPointer;
+        *valData = (*dLeaf)->mValData;
+        DataNode<K, V> *dSibling = *dLeaf == dChild->mLeft.unpack() ? dChild->mRight.unpack() : dChild->mLeft.unpack();
 
-        if (dNow->mOpData == opData) {            
-            auto sNodeInProgress = new StateNode<Position<V>, Status>(pNode, Status::IN_PROGRESS);
-            __sync_bool_compare_and_swap(&(opData->mState->mPackedPointer), sNodeInProgress->mPackedPointer, dNow->mNext->mPackedPointer);
+        // inserts move leaves down (see NewInternalWithLeaf), so a leaf moving back up
+        // is cloned; the original could otherwise return to a link it has left
+        dReplacement = dSibling->isLeaf() ? CloneDataNode(dSibling) : dSibling;
+    }
 
-            free(sNodeInProgress);
-        }
+    return dReplacement;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::MarkReplaced(DataNode<K, V> *dChild, DataNode<K, V> *dLeaf, DataNode<K, V> *dReplacement)
+{
+    // a leaf an insert hangs below its new internal node stays in the tree
+    if(dReplacement->mLeft.unpack() != dChild && dReplacement->mRight.unpack() != dChild) {
+        SetReplaced(dChild);
+    }
+    if(dLeaf != nullptr) {
+        SetReplaced(dLeaf);
     }
 }
 
-template<class V>
-bool ConcurrentTree<V>::ExecuteCheapWindowTransaction(Position<V> *pNode, DataNode<V> *dNode)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SetReplaced(DataNode<K, V> *dNode)
 {
-    OperationRecord<V> *opData = dNode->mOpData;
-    uint32_t pid = opData->mPid;
+    uint64_t owner = SyncPolicy::Load(&dNode->mOwner);
+    while((owner & NODE_REPLACED) == 0 && !SyncPolicy::CompareAndSwap(&dNode->mOwner, owner, owner | NODE_REPLACED)) {
+        owner = SyncPolicy::Load(&dNode->mOwner);
+    }
+}
 
-    // traverse the tree window using Tarjan’s algorithm
-    DataNode<V> *dWindow = this->pRoot->unpack()->clone();
-    while(dWindow->mLeft != nullptr || dWindow->mRight != nullptr)
-    {
-        if(dWindow->mLeft != nullptr) {
-            dWindow = dWindow->mLeft->mPackedPointer;
-        }
-        else {
-            dWindow = dWindow->mRight->mPackedPointer;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::ApplyToBucket(DataNode<K, V> *dLeaf, OperationRecord<K, V> *opData)
+{
+    // dLeaf is the private copy of the window, so its bucket can be swapped for a new one
+    LeafBucket<K, V> *bucket = dLeaf->mBucket;
+    int32_t index = bucket->Find(opData->mKey, mCompare);
+
+    if(opData->mType == Type::DELETE) {
+        if(index != -1) {
+            dLeaf->mBucket = bucket->template CloneWithout<AllocPolicy>(index);
         }
+        return;
     }
 
-    bool traverseLeft = false;
-    bool traverseRight = false;
+    if(opData->mType != Type::INSERT) {
+        return;
+    }
 
-    while(true)
-    {
-        if(dWindow->mLeft != nullptr) {
-            traverseLeft = true;
-        }
-        else if(dWindow->mRight != nullptr) {
-            traverseRight = true;
-        }
-        else {
-            return false;
-        }
+    auto valData = Allocate<ValueRecord<V>>();
+    InitializeInsertedRecord(valData, opData);
 
-        Position<V> *pNextToVisit = dNode->mNext->mPackedPointer; // the address of the pointer node of the next tree node to be visited;
-        DataNode<V> *dNextToVisit = pNextToVisit->windowLocation->mPackedPointer; // pNextToVisit dNode;
+    // a present key reaches here only when its record has expired; the new record takes its slot
+    if(index != -1) {
+        dLeaf->mBucket = bucket->template CloneRange<AllocPolicy>(0, bucket->mCount, bucket->mCapacity);
+        dLeaf->mBucket->mValues[index] = valData;
+        return;
+    }
 
-        if (opData->mState->unpack()->windowLocation->unpack() == pNode->windowLocation->unpack()) {
-            return true; // abort; transaction already executed
-        }
-        // if there is an operation residing at the node, then help it move out of the way
-        if (dNextToVisit->mOpData != nullptr) {
-            if(traverseLeft) {
-                dWindow = dWindow->mLeft->mPackedPointer;
-                traverseLeft = false;
-            }
-            else {
-                dWindow = dWindow->mRight->mPackedPointer;
-                traverseRight = false;
-            }
+    if(bucket->mCount < bucket->mCapacity) {
+        dLeaf->mBucket = bucket->template CloneWithInsert<AllocPolicy>(opData->mKey, valData, mCompare);
+        return;
+    }
+
+    // the bucket is full; split it into two leaves under a new internal node
+    LeafBucket<K, V> *full = bucket->template CloneWithInsert<AllocPolicy>(opData->mKey, valData, mCompare);
+    uint32_t half = full->mCount / 2;
+
+    DataNode<K, V> *dLower = NewDataNode();
+    dLower->SetSentinel(false);
+    new (&dLower->mKey) K(full->mKeys[half - 1]);
+    dLower->mBucket = full->template CloneRange<AllocPolicy>(0, half, bucket->mCapacity);
+
+    // the upper leaf inherits the range up to infinity if the old leaf had it
+    DataNode<K, V> *dUpper = NewDataNode();
+    dUpper->SetSentinel(dLeaf->Sentinel());
+    new (&dUpper->mKey) K(dLeaf->mKey);
+    dUpper->mBucket = full->template CloneRange<AllocPolicy>(half, full->mCount, bucket->mCapacity);
+
+    dLeaf->SetSentinel(false);
+    dLeaf->mKey = full->mKeys[half];
+    dLeaf->SetColor(RED);
+    dLeaf->mBucket = nullptr;
+    dLeaf->mLeft.InitializePointerNode(dLower, Flag::FREE);
+    dLeaf->mRight.InitializePointerNode(dUpper, Flag::FREE);
+
+    // the oversized copy never became reachable
+    full->template Free<AllocPolicy>();
+}
 
-            // there are several cases to consider
-            if (dNextToVisit->mOpData->mPid != pid) {
-                // the operation residing at the node belongs to a different process
-                ExecuteWindowTransaction(pNextToVisit, dNextToVisit);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::SlideWindowDown(OperationRecord<K, V> *opData, Position<K, V> *pMoveFrom, DataNode<K, V> *dMoveTo)
+{
+    DataNode<K, V> *dMoveFrom = pMoveFrom->window;
 
-                // read the address of the data node again as it may have changed
-                dNextToVisit = pNextToVisit->windowLocation->mPackedPointer;
-                if (opData->mState->unpack()->windowLocation != pNode->windowLocation) {
-                    return true; // abort; transaction already executed
-                }
-            }
-            else if (dNextToVisit->mOpData == dNode->mOpData) {
-                // partial window transaction has already been executed; complete it if needed
-                if (opData->mState->unpack()->windowLocation != pNode->windowLocation) {
-                    SlideWindowDown(pNode, dNode, pNextToVisit, dNextToVisit);
-                }
-                return true;
-            }
-            else if (MT[pid] != opData) {
-                return true; // abort; transaction already executed
-            }
+    // acquire the next window location. its owner word is read before checking that
+    // the operation still owns the current window, so a stale helper's CAS fails
+    uint64_t owner = SyncPolicy::Load(&dMoveTo->mOwner);
+    if(DataNode<K, V>::OwnerOf(owner) == nullptr && GetOwner(dMoveFrom) == opData) {
+        SyncPolicy::CompareAndSwap(&dMoveTo->mOwner, owner, DataNode<K, V>::NextOwner(owner, opData));
+    }
+
+    // release the current window location
+    owner = SyncPolicy::Load(&dMoveFrom->mOwner);
+    if(DataNode<K, V>::OwnerOf(owner) == opData && GetOwner(dMoveTo) == opData) {
+        if(SyncPolicy::CompareAndSwap(&dMoveFrom->mOwner, owner, DataNode<K, V>::NextOwner(owner, nullptr))) {
+            SyncPolicy::FetchAndAdd(&opData->mCheapTransactions, 1);
         }
+    }
+
+    // update the operation state
+    CompleteWindowTransaction(opData, pMoveFrom);
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CompleteWindowTransaction(OperationRecord<K, V> *opData, Position<K, V> *pNode)
+{
+    // the window at pNode has been released: either the operation slid down to the
+    // next node, which it owns until its state moves there, or its final transaction
+    // published the outcome. a stale helper's CAS fails since the state has moved on
+    StateNode<Position<K, V>, Status> sExpected(pNode, Status::IN_PROGRESS);
+    DataNode<K, V> *dChild = ChildLink(pNode->window, opData->mKey)->unpack();
+
+    if(GetOwner(dChild) == opData) {
+        AdvanceState(opData, sExpected.mPackedPointer, GetWindowAsPosition(dChild), Status::IN_PROGRESS);
+    }
+    else if(opData->mResult != nullptr) {
+        AdvanceState(opData, sExpected.mPackedPointer, opData->mResult, Status::COMPLETED);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::AdvanceState(OperationRecord<K, V> *opData, Position<K, V> *sExpected, Position<K, V> *pNext, Status status)
+{
+    StateNode<Position<K, V>, Status> sNext(pNext, status);
+    return SyncPolicy::CompareAndSwap(&opData->mState->mPackedPointer, sExpected, sNext.mPackedPointer);
+}
 
-        // visit dNextToVisit;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::NewInternalWithLeaf(DataNode<K, V> *dLeaf, OperationRecord<K, V> *opData)
+{
+    // replacement for dLeaf: an internal node over dLeaf itself and a new leaf for the
+    // key. dLeaf keeps its embedded record, so its value stays in its search line; a
+    // leaf only ever moves back up as a clone, so it never returns to the link it leaves
+    DataNode<K, V> *dNewLeaf = NewDataNode();
+    dNewLeaf->SetSentinel(false);
+    dNewLeaf->mKey = opData->mKey;
+    InitializeInsertedRecord(dNewLeaf->mValData, opData);
+
+    DataNode<K, V> *dOldLeaf = dLeaf;
+
+    DataNode<K, V> *dInternal = NewDataNode();
+    dInternal->SetColor(RED);
+
+    if(KeyLess(opData->mKey, dLeaf)) {
+        dInternal->SetSentinel(dLeaf->Sentinel());
+        dInternal->mKey = dLeaf->mKey;
+        dInternal->mLeft.InitializePointerNode(dNewLeaf, Flag::FREE);
+        dInternal->mRight.InitializePointerNode(dOldLeaf, Flag::FREE);
+    }
+    else {
+        dInternal->SetSentinel(false);
+        dInternal->mKey = opData->mKey;
+        dInternal->mLeft.InitializePointerNode(dOldLeaf, Flag::FREE);
+        dInternal->mRight.InitializePointerNode(dNewLeaf, Flag::FREE);
     }
-    if (dWindow->mNext->unpack()->windowLocation == this->GetPRootAsPosition()->windowLocation) {
 
-        PointerNode<DataNode<V>, Flag> *pMoveTo = new PointerNode<DataNode<V>, Flag>();
-        DataNode<V> *dMoveTo = new DataNode<V>();
+    return dInternal;
+}
 
-        // if not sentinel
-        if (opData->mValue != nullptr) {
-            if(opData->mType == Type::UPDATE) {
-                pMoveTo = this->pRoot;
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::InitializeInsertedRecord(ValueRecord<V> *valData, OperationRecord<K, V> *opData)
+{
+    if constexpr(WordValue<V>::value) {
+        V value;
+        memcpy(&value, opData->mWordValue, sizeof(V));
+        valData->InitializeValueRecord(value);
+    }
+    else {
+        if constexpr(ValueArena<V>::INLINE) {
+            if(opData->mOwnedValue) {
+                valData->InitializeInlineValueRecord(*opData->mValue, 0);
             }
             else {
-                pMoveTo = nullptr;
+                valData->InitializeValueRecord(opData->mValue, 0);
             }
-            
-            dMoveTo = nullptr;
         }
         else {
-            pMoveTo = dWindow->mNext->unpack()->windowLocation; // the address of the pointer node of the node in the tree to which the operation will now move;
-            dMoveTo = pMoveTo->mPackedPointer;
+            valData->InitializeValueRecord(opData->mValue, 0);
+            valData->mOwned = opData->mOwnedValue;
         }
 
-        if(opData->mState->unpack()->windowLocation == pNode->windowLocation) {
-            SlideWindowDown(pNode, dNode, this->GetPointerNodeAsPosition(pMoveTo), dMoveTo);
-        }
-
-        return true;
-    }
-    else {
-        return false;
+        valData->mInserter = opData;
     }
+
+    valData->mFilterGeneration = opData->mFilterGeneration;
+    valData->mExpires = opData->mExpires;
 }
 
-template<class V>
-void ConcurrentTree<V>::SlideWindowDown(Position<V> *pMoveFrom, DataNode<V> *dMoveFrom, Position<V> *pMoveTo, DataNode<V> *dMoveTo)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+void ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::DiscardReplacement(DataNode<K, V> *dReplacement, OperationRecord<K, V> *opData)
 {
-    OperationRecord<V> *opData = dMoveFrom->mOpData;
+    // an arena copy is shared by every helper's record and stays with the operation
+    if constexpr(!WordValue<V>::value && ValueArena<V>::INLINE) {
+        if(opData->mType != Type::INSERT || !opData->mOwnedValue) {
+            return;
+        }
 
-    // copy the data node of the current window location
-    DataNode<V> *dCopyMoveFrom = dMoveFrom->clone();
-    dCopyMoveFrom->mOpData = opData;
+        ValueRecord<V> *valData = FindRecord(dReplacement, opData->mKey);
+        if(valData != nullptr && valData->mInserter == opData) {
+            valData->InlineValue()->~V();
+        }
+    }
+}
 
-    if(dMoveTo != nullptr) {
-        dCopyMoveFrom->mNext = new NextNode<Position<V>, Status>(pMoveTo, Status::IN_PROGRESS);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+ValueRecord<V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::FindRecord(DataNode<K, V> *dNode, const K &key)
+{
+    while(!dNode->isLeaf()) {
+        dNode = ChildLink(dNode, key)->unpack();
     }
-    else {
-        dCopyMoveFrom->mNext = new NextNode<Position<V>, Status>(pMoveTo, Status::COMPLETED);
+
+    if(dNode->mBucket != nullptr) {
+        int32_t index = dNode->mBucket->Find(key, mCompare);
+        return index != -1 ? dNode->mBucket->mValues[index] : nullptr;
     }
 
-    // copy the data node of the next window location, if needed
-    if(dMoveTo != nullptr) {
-        if(dMoveTo->mOpData != opData) {
-            DataNode<V> *dCopyMoveTo = dMoveTo->clone();
-            dCopyMoveTo->mOpData = opData;
+    return KeyEquals(key, dNode) ? dNode->mValData : nullptr;
+}
 
-            // acquire the ownership of the next window location
-            auto pMoveToFree = new PointerNode<DataNode<V>, Flag>(dMoveTo, Flag::FREE); // {FREE, dMoveTo}
-            auto dCopyMoveToOwned = new PointerNode<DataNode<V>, Flag>(dCopyMoveTo, Flag::OWNED); // {OWNED, dCopyMoveTo}
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+WindowCounters ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetWindowCounters()
+{
+    return mWindowCounters.Sum();
+}
 
-            __sync_bool_compare_and_swap(&(pMoveTo->windowLocation->mPackedPointer), pMoveToFree->mPackedPointer, dCopyMoveToOwned->mPackedPointer);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+bool ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CheckInvariants(uint64_t *keys, uint32_t *height)
+{
+    // a node with the bounds [low, high) its keys must lie in; a null bound is unbounded
+    struct Frame
+    {
+        DataNode<K, V> *mNode;
+        const K *mLow;
+        const K *mHigh;
+        uint32_t mDepth;
+    };
+
+    uint32_t capacity = 64, count = 0, maxDepth = 0;
+    auto stack = (Frame *) malloc(sizeof(Frame) * capacity);
+    bool valid = true;
+
+    *keys = 0;
+    stack[count++] = {this->pRoot->unpack(), nullptr, nullptr, 0};
+
+    while(valid && count > 0) {
+        Frame frame = stack[--count];
+        DataNode<K, V> *dNode = frame.mNode;
+        maxDepth = frame.mDepth > maxDepth ? frame.mDepth : maxDepth;
+
+        // every window was released and every replaced node unlinked
+        if(dNode->Replaced() || DataNode<K, V>::OwnerOf(dNode->mOwner) != nullptr) {
+            valid = false;
+        }
+        else if(dNode->mBucket != nullptr) {
+            LeafBucket<K, V> *bucket = dNode->mBucket;
+            valid = bucket->mCount <= bucket->mCapacity;
+
+            for(uint32_t i=0; valid && i<bucket->mCount; i++) {
+                const K &key = bucket->mKeys[i];
+                valid = (i == 0 || mCompare(bucket->mKeys[i - 1], key)) &&
+                        (frame.mLow == nullptr || !mCompare(key, *frame.mLow)) &&
+                        (frame.mHigh == nullptr || mCompare(key, *frame.mHigh));
+            }
+            *keys += bucket->mCount;
+        }
+        else if(dNode->isLeaf()) {
+            if(!dNode->Sentinel()) {
+                valid = (frame.mLow == nullptr || !mCompare(dNode->mKey, *frame.mLow)) &&
+                        (frame.mHigh == nullptr || mCompare(dNode->mKey, *frame.mHigh));
+                (*keys)++;
+            }
+        }
+        else if(dNode->mLeft.unpack() == nullptr || dNode->mRight.unpack() == nullptr) {
+            valid = false;
+        }
+        else {
+            if(count + 2 > capacity) {
+                capacity *= 2;
+                stack = (Frame *) realloc(stack, sizeof(Frame) * capacity);
+            }
 
-            free(dCopyMoveToOwned);
-            free(pMoveToFree);
+            // keys ordered before the routing key go left; a sentinel routes everything left
+            const K *key = dNode->Sentinel() ? frame.mHigh : &dNode->mKey;
+            stack[count++] = {dNode->mRight.unpack(), key, frame.mHigh, frame.mDepth + 1};
+            stack[count++] = {dNode->mLeft.unpack(), frame.mLow, key, frame.mDepth + 1};
         }
     }
 
-    // release the ownership of the current window location and update the operation state
-    auto pMoveFromOwned = new PointerNode<DataNode<V>, Flag>(dMoveFrom, Flag::OWNED); // {OWNED, dMoveFrom}
+    free(stack);
+    if(height != nullptr) {
+        *height = maxDepth;
+    }
+    return valid;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+Position<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetWindowAsPosition(DataNode<K, V> *dNode)
+{
+    Position<K, V> *pNodePosition = NewPosition();
+    pNodePosition->window = dNode;
+    return pNodePosition;
+}
+
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+Position<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetValueAsPosition(ValueRecord<V> *valData)
+{
+    Position<K, V> *pValuePosition = NewPosition();
+    pValuePosition->valueRecord = valData;
+    return pValuePosition;
+}
 
-    __sync_bool_compare_and_swap(&(pMoveFrom->windowLocation->mPackedPointer), pMoveFromOwned->mPackedPointer, dCopyMoveFrom->mNext->unpack()->windowLocation->mPackedPointer);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::NewDataNode()
+{
+    DataNode<K, V> *dNode = Allocate<DataNode<K, V>>();
+    dNode->InitializeDataNode();
+    return dNode;
+}
 
-    free(pMoveFromOwned);
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+DataNode<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::CloneDataNode(DataNode<K, V> *dNode)
+{
+    return dNode->clone(Allocate<DataNode<K, V>>());
+}
 
-    auto pMoveFromInProgress = new StateNode<Position<V>, Status>(pMoveFrom, Status::IN_PROGRESS); // {IN PROGRESS, pMoveFrom}
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+OperationRecord<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::NewOperationRecord(Type type, const K &key, V *value)
+{
+    // the state starts out pointing at an empty position, as before
+    auto state = Allocate<StateNode<Position<K, V>, Status>>();
+    state->InitializeStateNode(NewPosition(), Status::WAITING);
 
-    __sync_bool_compare_and_swap(&(opData->mState->mPackedPointer), pMoveFromInProgress->mPackedPointer, dCopyMoveFrom->mNext->mPackedPointer);
-    
-    free(pMoveFromInProgress);
+    auto opData = Allocate<OperationRecord<K, V>>();
+    new (opData) OperationRecord<K, V>(type, key, value, state);
+    return opData;
 }
 
-template <class V>
-Position<V> *ConcurrentTree<V>::GetPRootAsPosition()
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+Position<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::NewPosition()
 {
-    Position<V> *pRootPosition = new Position<V>();
-    pRootPosition->windowLocation = pRoot;
-    return pRootPosition;
+    Position<K, V> *position = Allocate<Position<K, V>>();
+    position->window = nullptr;
+    return position;
 }
 
-template <class V>
-Position<V> *ConcurrentTree<V>::GetPointerNodeAsPosition(PointerNode<DataNode<V>, Flag> *pointerNode)
+template <class K, class V, class Compare, class AllocPolicy, class SyncPolicy>
+OperationRecord<K, V> *ConcurrentTree<K, V, Compare, AllocPolicy, SyncPolicy>::GetOwner(DataNode<K, V> *dNode)
 {
-    Position<V> *pNodePosition = new Position<V>();
-    pNodePosition->windowLocation = pointerNode;
-    return pNodePosition;
-}
\ No newline at end of file
+    return DataNode<K, V>::OwnerOf(SyncPolicy::Load(&dNode->mOwner));
+}
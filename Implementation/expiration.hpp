@@ -0,0 +1,174 @@
+#ifndef _EXPIRATION_HPP_
+#define _EXPIRATION_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// length of a clock tick; a ttl is given in ticks
+#define EXPIRATION_TICK_NANOSECONDS 1000000
+// expired keys the sweeper collects in one descent before removing them
+#define EXPIRATION_SWEEP_BATCH 64
+// how long the background sweeper sleeps between passes
+#define EXPIRATION_IDLE_MICROSECONDS 100000
+
+// a record's stamp is the tick from which it reads as absent. stamps are 32 bits so
+// that a word record still fits the search line of its leaf, and are compared by
+// their signed distance, so the clock may wrap. it starts at EXPIRATION_FIRST_TICK
+// and skips the reserved stamps when it wraps, so none of them is ever a live time
+#define NO_EXPIRATION 0
+// the stamp of a record whose key was removed, set when the hash index unlinks it
+#define EXPIRATION_UNLINKED 1
+// the stamp an expired record is moved to by the first thread that acts on its expiry
+#define EXPIRATION_DEAD 2
+#define EXPIRATION_FIRST_TICK 3
+// longest ttl, so a stamp stays less than half the clock's range ahead of now
+#define EXPIRATION_MAX_TTL (INT32_MAX - EXPIRATION_FIRST_TICK)
+
+struct ExpirationCounters
+{
+    // lookups that found their key's record expired
+    uint64_t mExpiredReads;
+    // expired keys removed by inserts and pops that came across them
+    uint64_t mLazyRemovals;
+    // expired keys removed by Sweep, and the passes it made
+    uint64_t mSweptRemovals;
+    uint64_t mSweeps;
+};
+
+// clock and sweeper of per-key expiration. a record stamped with a tick reads as
+// absent from that tick on; it leaves the tree when an insert lands on it or
+// beside it, when a pop reaches it, or when a sweep passes over it. a thread that
+// finds a stamp expired moves it to EXPIRATION_DEAD before it reads the record as
+// absent or removes it, and Renew only moves stamps that are not dead, so a renew
+// either lands before that and keeps the record, or fails and inserts over it.
+// ticks count from the call of EnableExpiration and wrap after 2^32, about 49
+// days at one millisecond. an expired stamp compares as expired for 2^31 ticks;
+// a sweep in that time kills it, after which it stays dead across any wrap
+class Expiration
+{
+public:
+    uint64_t mEpoch;
+    ThreadCounters<ExpirationCounters> mCounters;
+    pthread_t mThread;
+    uint32_t mRunning;
+    int mSweeperId;
+
+    void InitializeExpiration(uint32_t numThreads)
+    {
+        mEpoch = Nanoseconds();
+        mCounters.InitializeThreadCounters(numThreads);
+        mRunning = 0;
+        mSweeperId = -1;
+    }
+
+    static uint64_t Nanoseconds()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+    }
+
+    // a tick that wrapped onto a reserved stamp is moved past them
+    static uint32_t Live(uint32_t tick)
+    {
+        return tick < EXPIRATION_FIRST_TICK ? EXPIRATION_FIRST_TICK : tick;
+    }
+
+    uint32_t Now()
+    {
+        return Live((uint32_t) ((Nanoseconds() - mEpoch) / EXPIRATION_TICK_NANOSECONDS) + EXPIRATION_FIRST_TICK);
+    }
+
+    // the stamp of a record written now to live for ttl ticks, at most EXPIRATION_MAX_TTL
+    uint32_t Stamp(uint32_t ttl)
+    {
+        return Live(Now() + (ttl < EXPIRATION_MAX_TTL ? ttl : EXPIRATION_MAX_TTL));
+    }
+
+    static bool ExpiredAt(uint32_t expires, uint32_t now)
+    {
+        return expires != NO_EXPIRATION && (Dead(expires) || (int32_t) (now - expires) >= 0);
+    }
+
+    // the clock is only read for records that carry a live stamp
+    bool Expired(uint32_t expires)
+    {
+        return expires != NO_EXPIRATION && (Dead(expires) || ExpiredAt(expires, Now()));
+    }
+
+    static bool Dead(uint32_t expires)
+    {
+        return expires == EXPIRATION_DEAD || expires == EXPIRATION_UNLINKED;
+    }
+
+    // whether the record of stamp has expired, moving the stamp to EXPIRATION_DEAD
+    // if it has and nobody did yet; a renew that got in first keeps the record
+    bool Kill(uint32_t *stamp)
+    {
+        uint32_t current = __atomic_load_n(stamp, __ATOMIC_ACQUIRE);
+
+        while(!Dead(current)) {
+            if(!Expired(current)) {
+                return false;
+            }
+            if(__atomic_compare_exchange_n(stamp, &current, EXPIRATION_DEAD, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    // Kill against a clock read once by the caller, for a sweep over many records
+    static bool KillAt(uint32_t *stamp, uint32_t now)
+    {
+        uint32_t current = __atomic_load_n(stamp, __ATOMIC_ACQUIRE);
+
+        while(!Dead(current)) {
+            if(!ExpiredAt(current, now)) {
+                return false;
+            }
+            if(__atomic_compare_exchange_n(stamp, &current, EXPIRATION_DEAD, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    // moves a live record's stamp to expires; false if the record has expired, in
+    // which case the writer inserts over it instead of reviving it. a stamp found
+    // expired is killed first, so no reader saw the record absent before a renew
+    bool Renew(uint32_t *stamp, uint32_t expires)
+    {
+        uint32_t current = __atomic_load_n(stamp, __ATOMIC_ACQUIRE);
+
+        while(!Dead(current)) {
+            uint32_t next = Expired(current) ? EXPIRATION_DEAD : expires;
+            if(next == current) {
+                return true;
+            }
+            if(__atomic_compare_exchange_n(stamp, &current, next, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return next != EXPIRATION_DEAD;
+            }
+        }
+
+        return false;
+    }
+
+    ExpirationCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
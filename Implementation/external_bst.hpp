@@ -0,0 +1,156 @@
+#ifndef _EXTERNAL_BST_HPP_
+#define _EXTERNAL_BST_HPP_
+
+#include "concurrent.hpp"
+
+// edge marks in the low bits of a child word: a flagged edge leads to a leaf that
+// is being deleted, a tagged edge to the sibling of one. a marked edge never
+// changes again; the delete (or a thread helping it) swings the edge above both
+#define BST_FLAG ((uintptr_t) 1)
+#define BST_TAG ((uintptr_t) 2)
+#define BST_MARKS (BST_FLAG | BST_TAG)
+
+// the three sentinel keys above every key, in order
+#define BST_INFINITY_0 1
+#define BST_INFINITY_1 2
+#define BST_INFINITY_2 3
+
+template <class K, class V>
+class BSTNode
+{
+public:
+    // 0 for a node holding a key, otherwise one of the BST_INFINITY levels
+    uint32_t mSentinel;
+    K mKey;
+    // child words with their marks, both null in a leaf
+    uintptr_t mLeft;
+    uintptr_t mRight;
+    // the value record of a leaf, with the same semantics as in ConcurrentTree
+    ValueRecord<V> mRecord;
+
+    void InitializeBSTNode(uint32_t sentinel)
+    {
+        mSentinel = sentinel;
+        new (&mKey) K();
+        mLeft = 0;
+        mRight = 0;
+    }
+
+    bool isLeaf()
+    {
+        return mLeft == 0;
+    }
+
+    static BSTNode<K, V> *Address(uintptr_t word)
+    {
+        return (BSTNode<K, V> *) (word & ~BST_MARKS);
+    }
+};
+
+// the nodes a seek ends at: the leaf, its parent, and the last edge above them
+// that was not tagged, from ancestor to successor, which a delete swings
+template <class K, class V>
+struct SeekRecord
+{
+    BSTNode<K, V> *mAncestor;
+    BSTNode<K, V> *mSuccessor;
+    BSTNode<K, V> *mParent;
+    BSTNode<K, V> *mLeaf;
+};
+
+struct BSTCounters
+{
+    // injections whose CAS lost to a concurrent change and started over
+    uint64_t mRetries;
+    // deletes of other threads this thread finished before retrying its own operation
+    uint64_t mHelps;
+};
+
+// lock-free unbalanced external BST after Natarajan and Mittal: keys live in the
+// leaves, an insert swings one edge to a new internal node and a delete marks two
+// edges and swings the one above them, so no window is owned or copied. it offers
+// the Search/InsertOrUpdate/Delete interface of ConcurrentTree, with leaves holding
+// the same value records, values copied into the same ValueArena and nodes taken
+// from the same AllocPolicy. it does not rebalance, so it suits random keys
+template <class K, class V, class Compare = std::less<K>, class AllocPolicy = MallocAlloc>
+class LockFreeBST
+{
+public:
+    // the sentinel internal node of key infinity 2; every key lives in the left
+    // subtree of its left child, the internal node of key infinity 1
+    BSTNode<K, V> *mRoot;
+    Compare mCompare;
+    ValueArena<V> *mValueArena;
+    ThreadCounters<BSTCounters> mCounters;
+
+    LockFreeBST(int numThreads, const Compare &compare = Compare())
+    {
+        mCompare = compare;
+
+        mValueArena = (ValueArena<V> *) malloc(sizeof(ValueArena<V>));
+        mValueArena->InitializeValueArena(numThreads);
+
+        mCounters.InitializeThreadCounters(numThreads);
+
+        // the sentinels keep every leaf of a key at least two levels below the root,
+        // so a delete always has an ancestor and a successor to swing
+        BSTNode<K, V> *dInner = NewNode(BST_INFINITY_1);
+        dInner->mLeft = (uintptr_t) NewNode(BST_INFINITY_0);
+        dInner->mRight = (uintptr_t) NewNode(BST_INFINITY_1);
+
+        mRoot = NewNode(BST_INFINITY_2);
+        mRoot->mLeft = (uintptr_t) dInner;
+        mRoot->mRight = (uintptr_t) NewNode(BST_INFINITY_2);
+    }
+
+    V* Search(const K &key, int myid);
+    // the record holding the key's value, or nullptr if the key is absent
+    ValueRecord<V> *SearchRecord(const K &key, int myid);
+    void InsertOrUpdate(const K &key, V *value, int myid);
+    // stores a copy of value owned by the tree. a pointer to it returned by Search
+    // stays valid until the calling thread's next operation or Quiesce
+    void InsertOrUpdate(const K &key, const V &value, int myid);
+    void Delete(const K &key, int myid);
+    void Quiesce(int myid);
+
+    // adds a leaf holding value unless the key is present, and returns the record now
+    // holding the key; inserted tells whether it is the new leaf's
+    ValueRecord<V> *InsertKey(const K &key, V *value, bool ownedValue, bool *inserted, int myid);
+    // removes the key and returns its record, nullptr if another delete removed it first
+    ValueRecord<V> *DeleteKey(const K &key, int myid);
+    void Seek(const K &key, SeekRecord<K, V> *record);
+    // swings the edge above a flagged leaf and its sibling; false if it changed first
+    bool Cleanup(const K &key, SeekRecord<K, V> *record);
+    void RetireValue(ValueRecord<V> *valData, V *replaced, int myid);
+
+    // is key ordered before the node's key; sentinels are above everything
+    bool KeyLess(const K &key, BSTNode<K, V> *dNode)
+    {
+        return dNode->mSentinel != 0 || mCompare(key, dNode->mKey);
+    }
+
+    bool KeyEquals(const K &key, BSTNode<K, V> *dNode)
+    {
+        return dNode->mSentinel == 0 && !mCompare(key, dNode->mKey) && !mCompare(dNode->mKey, key);
+    }
+
+    // the child word of dNode on the path to key
+    uintptr_t *ChildWord(BSTNode<K, V> *dNode, const K &key)
+    {
+        return KeyLess(key, dNode) ? &dNode->mLeft : &dNode->mRight;
+    }
+
+    BSTNode<K, V> *NewNode(uint32_t sentinel)
+    {
+        BSTNode<K, V> *dNode = (BSTNode<K, V> *) AllocPolicy::Allocate(sizeof(BSTNode<K, V>), alignof(BSTNode<K, V>));
+        dNode->InitializeBSTNode(sentinel);
+        return dNode;
+    }
+
+    BSTCounters GetBSTCounters();
+};
+
+#include "external_bst.tcc"
+#include "thread_counters.hpp"
+
+#endif
@@ -0,0 +1,318 @@
+template <class K, class V, class Compare, class AllocPolicy>
+V *LockFreeBST<K, V, Compare, AllocPolicy>::Search(const K &key, int myid)
+{
+    ValueRecord<V> *valData = SearchRecord(key, myid);
+    return valData != nullptr ? valData->ReadValue() : nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+ValueRecord<V> *LockFreeBST<K, V, Compare, AllocPolicy>::SearchRecord(const K &key, int myid)
+{
+    // every operation starts here; values the thread got from earlier ones may now be reclaimed
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    // a search only reads: a leaf it reaches was in the tree at some point of the walk
+    BSTNode<K, V> *dNode = BSTNode<K, V>::Address(__atomic_load_n(&mRoot->mLeft, __ATOMIC_ACQUIRE));
+    while(!dNode->isLeaf()) {
+        dNode = BSTNode<K, V>::Address(__atomic_load_n(ChildWord(dNode, key), __ATOMIC_ACQUIRE));
+    }
+
+    return KeyEquals(key, dNode) ? &dNode->mRecord : nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeBST<K, V, Compare, AllocPolicy>::InsertOrUpdate(const K &key, V *value, int myid)
+{
+    bool inserted = false;
+
+    // phase 1: determine if the key already exists in the tree
+    ValueRecord<V> *valData = SearchRecord(key, myid);
+
+    if(valData == nullptr) {
+        // phase 2: add a leaf for the key, or find the one a concurrent insert added
+        valData = InsertKey(key, value, false, &inserted, myid);
+    }
+
+    if(inserted) {
+        return;
+    }
+
+    // phase 3: update the value in the record, as ConcurrentTree does
+    if constexpr(WordValue<V>::value) {
+        V current = valData->LoadValue();
+        while(memcmp(&current, value, sizeof(V)) != 0 && !valData->CompareExchange(&current, *value));
+    }
+    else {
+        uint32_t gate;
+        V *current, *replaced;
+        while((current = valData->ReadValue(&gate)) != value && current != nullptr) {
+            if(valData->WriteValue(value, gate, false, &replaced)) {
+                RetireValue(valData, replaced, myid);
+                break;
+            }
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeBST<K, V, Compare, AllocPolicy>::InsertOrUpdate(const K &key, const V &value, int myid)
+{
+    if constexpr(WordValue<V>::value) {
+        InsertOrUpdate(key, const_cast<V *>(&value), myid);
+    }
+    else {
+        // phase 1: determine if the key already exists in the tree
+        ValueRecord<V> *valData = SearchRecord(key, myid);
+        V *copy = nullptr;
+
+        if(valData == nullptr) {
+            // phase 2: no other thread builds this leaf, so a small value is copied
+            // straight into its record and a large one into an arena slot
+            if constexpr(!ValueArena<V>::INLINE) {
+                copy = mValueArena->Copy(value, myid);
+            }
+
+            bool inserted;
+            valData = InsertKey(key, ValueArena<V>::INLINE ? const_cast<V *>(&value) : copy, true, &inserted, myid);
+            if(inserted) {
+                return;
+            }
+        }
+
+        // phase 3: the key was present; a copy that was never published is reused
+        if(copy == nullptr) {
+            copy = mValueArena->Copy(value, myid);
+        }
+
+        uint32_t gate;
+        V *replaced;
+        while(valData->ReadValue(&gate) != nullptr) {
+            if(valData->WriteValue(copy, gate, true, &replaced)) {
+                RetireValue(valData, replaced, myid);
+                return;
+            }
+        }
+
+        // the key was deleted before the copy was published
+        mValueArena->Release(copy, myid);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+ValueRecord<V> *LockFreeBST<K, V, Compare, AllocPolicy>::InsertKey(const K &key, V *value, bool ownedValue, bool *inserted, int myid)
+{
+    BSTNode<K, V> *dNewLeaf = NewNode(0);
+    dNewLeaf->mKey = key;
+
+    ValueRecord<V> *valData = &dNewLeaf->mRecord;
+    if constexpr(WordValue<V>::value) {
+        valData->InitializeValueRecord(*value);
+    }
+    else {
+        if constexpr(ValueArena<V>::INLINE) {
+            if(ownedValue) {
+                valData->InitializeInlineValueRecord(*value, 0);
+            }
+            else {
+                valData->InitializeValueRecord(value, 0);
+            }
+        }
+        else {
+            valData->InitializeValueRecord(value, 0);
+            valData->mOwned = ownedValue;
+        }
+    }
+
+    // the internal node is reused across attempts, only its children change
+    BSTNode<K, V> *dInternal = NewNode(0);
+    SeekRecord<K, V> record;
+
+    while(true) {
+        Seek(key, &record);
+        BSTNode<K, V> *dLeaf = record.mLeaf;
+
+        if(KeyEquals(key, dLeaf)) {
+            // the new leaf was never published; an inline copy is destroyed here, an
+            // arena copy stays with the caller
+            if constexpr(!WordValue<V>::value) {
+                if(ValueArena<V>::INLINE && ownedValue) {
+                    valData->InlineValue()->~V();
+                }
+            }
+
+            *inserted = false;
+            return &dLeaf->mRecord;
+        }
+
+        // the internal node routes by the larger of the two keys, with the smaller leaf on its left
+        if(KeyLess(key, dLeaf)) {
+            dInternal->mSentinel = dLeaf->mSentinel;
+            dInternal->mKey = dLeaf->mKey;
+            dInternal->mLeft = (uintptr_t) dNewLeaf;
+            dInternal->mRight = (uintptr_t) dLeaf;
+        }
+        else {
+            dInternal->mSentinel = 0;
+            dInternal->mKey = key;
+            dInternal->mLeft = (uintptr_t) dLeaf;
+            dInternal->mRight = (uintptr_t) dNewLeaf;
+        }
+
+        uintptr_t *childWord = ChildWord(record.mParent, key);
+        if(__sync_bool_compare_and_swap(childWord, (uintptr_t) dLeaf, (uintptr_t) dInternal)) {
+            *inserted = true;
+            return valData;
+        }
+
+        // the edge was marked by a delete of the leaf or its sibling, which is helped out of the way
+        mCounters[myid].mRetries++;
+        uintptr_t word = __atomic_load_n(childWord, __ATOMIC_ACQUIRE);
+        if(BSTNode<K, V>::Address(word) == dLeaf && (word & BST_MARKS) != 0) {
+            mCounters[myid].mHelps++;
+            Cleanup(key, &record);
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeBST<K, V, Compare, AllocPolicy>::Delete(const K &key, int myid)
+{
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    ValueRecord<V> *removed = DeleteKey(key, myid);
+
+    // close the removed record, so a racing update cannot install a value in it
+    // after its last value has been retired. words are never retired
+    if constexpr(!WordValue<V>::value) {
+        if(removed != nullptr) {
+            uint32_t gate;
+            V *replaced = nullptr;
+            while(removed->ReadValue(&gate) != nullptr && !removed->WriteValue(nullptr, gate, false, &replaced));
+            RetireValue(removed, replaced, myid);
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+ValueRecord<V> *LockFreeBST<K, V, Compare, AllocPolicy>::DeleteKey(const K &key, int myid)
+{
+    SeekRecord<K, V> record;
+    BSTNode<K, V> *dLeaf;
+
+    // injection: flagging the edge to the leaf is the point the key is removed at
+    while(true) {
+        Seek(key, &record);
+        if(!KeyEquals(key, record.mLeaf)) {
+            return nullptr;
+        }
+
+        uintptr_t *childWord = ChildWord(record.mParent, key);
+        if(__sync_bool_compare_and_swap(childWord, (uintptr_t) record.mLeaf, (uintptr_t) record.mLeaf | BST_FLAG)) {
+            dLeaf = record.mLeaf;
+            break;
+        }
+
+        mCounters[myid].mRetries++;
+        uintptr_t word = __atomic_load_n(childWord, __ATOMIC_ACQUIRE);
+        if(BSTNode<K, V>::Address(word) == record.mLeaf && (word & BST_MARKS) != 0) {
+            mCounters[myid].mHelps++;
+            Cleanup(key, &record);
+        }
+    }
+
+    // cleanup: the leaf is unlinked by this thread or by one that ran into its flag
+    while(!Cleanup(key, &record)) {
+        Seek(key, &record);
+        if(record.mLeaf != dLeaf) {
+            break;
+        }
+    }
+
+    return &dLeaf->mRecord;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeBST<K, V, Compare, AllocPolicy>::Seek(const K &key, SeekRecord<K, V> *record)
+{
+    BSTNode<K, V> *dInner = BSTNode<K, V>::Address(mRoot->mLeft);
+
+    record->mAncestor = mRoot;
+    record->mSuccessor = dInner;
+    record->mParent = dInner;
+
+    uintptr_t parentWord = __atomic_load_n(&dInner->mLeft, __ATOMIC_ACQUIRE);
+    record->mLeaf = BSTNode<K, V>::Address(parentWord);
+
+    uintptr_t currentWord = __atomic_load_n(ChildWord(record->mLeaf, key), __ATOMIC_ACQUIRE);
+    BSTNode<K, V> *dCurrent = BSTNode<K, V>::Address(currentWord);
+
+    while(dCurrent != nullptr) {
+        // the edge into the leaf is the last untagged one so far
+        if((parentWord & BST_TAG) == 0) {
+            record->mAncestor = record->mParent;
+            record->mSuccessor = record->mLeaf;
+        }
+
+        record->mParent = record->mLeaf;
+        record->mLeaf = dCurrent;
+        parentWord = currentWord;
+
+        // both child words of a leaf are null, which ends the walk
+        currentWord = __atomic_load_n(ChildWord(dCurrent, key), __ATOMIC_ACQUIRE);
+        dCurrent = BSTNode<K, V>::Address(currentWord);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+bool LockFreeBST<K, V, Compare, AllocPolicy>::Cleanup(const K &key, SeekRecord<K, V> *record)
+{
+    BSTNode<K, V> *dParent = record->mParent;
+    uintptr_t *successorWord = ChildWord(record->mAncestor, key);
+    uintptr_t *childWord, *siblingWord;
+
+    if(KeyLess(key, dParent)) {
+        childWord = &dParent->mLeft;
+        siblingWord = &dParent->mRight;
+    }
+    else {
+        childWord = &dParent->mRight;
+        siblingWord = &dParent->mLeft;
+    }
+
+    // if the edge on the key's side is not flagged, the leaf being deleted is the
+    // other child, and the key's side is the one that stays
+    if((__atomic_load_n(childWord, __ATOMIC_ACQUIRE) & BST_FLAG) == 0) {
+        siblingWord = childWord;
+    }
+
+    // the tag freezes the surviving edge, then the edge above the parent is swung to
+    // its target, keeping a flag for the delete it belongs to
+    uintptr_t sibling = __atomic_fetch_or(siblingWord, BST_TAG, __ATOMIC_SEQ_CST);
+    uintptr_t replacement = (sibling & ~BST_MARKS) | (sibling & BST_FLAG);
+
+    return __sync_bool_compare_and_swap(successorWord, (uintptr_t) record->mSuccessor, replacement);
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeBST<K, V, Compare, AllocPolicy>::Quiesce(int myid)
+{
+    mValueArena->Quiesce(myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeBST<K, V, Compare, AllocPolicy>::RetireValue(ValueRecord<V> *valData, V *replaced, int myid)
+{
+    if(replaced != nullptr) {
+        mValueArena->Retire(replaced, replaced == valData->InlineValue(), myid);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+BSTCounters LockFreeBST<K, V, Compare, AllocPolicy>::GetBSTCounters()
+{
+    return mCounters.Sum();
+}
@@ -0,0 +1,233 @@
+#ifndef _HASH_INDEX_HPP_
+#define _HASH_INDEX_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "key_hash.hpp"
+#include "word_value.hpp"
+#include "expiration.hpp"
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// smallest table, and the share of claimed slots (in quarters) at which a table
+// is replaced by one twice as large
+#define HASH_INDEX_MIN_SLOTS 1024
+#define HASH_INDEX_LOAD_QUARTERS 3
+// slots a lookup or publish probes before it gives up on the table
+#define HASH_INDEX_MAX_PROBES 32
+
+// a slot's hash word is 0 while empty and HASH_SLOT_CLAIMED while its key is
+// being written; a stored hash always has HASH_SLOT_TAG set, so it is neither
+#define HASH_SLOT_CLAIMED ((uint64_t) 1)
+#define HASH_SLOT_TAG ((uint64_t) 2)
+
+// a key and the record last published for it. the key is written once, before
+// the hash word is set; only the record changes afterwards
+template <class K, class V>
+struct HashSlot
+{
+    uint64_t mHash;
+    K mKey;
+    ValueRecord<V> *mRecord;
+};
+
+template <class K, class V>
+struct HashTable
+{
+    uint64_t mMask;
+    uint64_t mClaimed;
+    // the table this one replaced; a lookup that misses here moves an entry over from it
+    HashTable<K, V> *mPrevious;
+    HashSlot<K, V> mSlots[1];
+};
+
+struct HashIndexCounters
+{
+    uint64_t mHits;
+    // lookups that fell back to the tree
+    uint64_t mMisses;
+    uint64_t mPublishes;
+    uint64_t mResizes;
+};
+
+// lock-free open-addressing index from key to the value record of its leaf, in
+// front of ConcurrentTree::SearchRecord. the tree stays the authority: an insert
+// publishes the record it added, a delete marks the record it removed as unlinked,
+// and a lookup only answers with a record that is not unlinked, so a stale or
+// missing entry costs a traversal and never a wrong answer. a full table is
+// replaced by a larger empty one whose entries move over as they are looked up.
+// keys are copied without locks, so they must be trivially copyable
+template <class K, class V, class Compare>
+class HashIndex
+{
+public:
+    HashTable<K, V> *mTable;
+    ThreadCounters<HashIndexCounters> mCounters;
+    Compare mCompare;
+
+    static_assert(std::is_trivially_copyable<K>::value, "hash index needs trivially copyable keys");
+
+    void InitializeHashIndex(uint64_t expectedKeys, uint32_t numThreads, const Compare &compare)
+    {
+        uint64_t slots = HASH_INDEX_MIN_SLOTS;
+        while(slots * HASH_INDEX_LOAD_QUARTERS / 4 < expectedKeys) {
+            slots <<= 1;
+        }
+
+        mTable = NewTable(slots, nullptr);
+        mCounters.InitializeThreadCounters(numThreads);
+        mCompare = compare;
+    }
+
+    static HashTable<K, V> *NewTable(uint64_t slots, HashTable<K, V> *previous)
+    {
+        size_t bytes = sizeof(HashTable<K, V>) + (slots - 1) * sizeof(HashSlot<K, V>);
+        HashTable<K, V> *table = (HashTable<K, V> *) aligned_alloc(CACHE_LINE_SIZE, (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE);
+        memset((void *) table, 0, bytes);
+        table->mMask = slots - 1;
+        table->mPrevious = previous;
+        return table;
+    }
+
+    static uint64_t Tag(uint64_t hash)
+    {
+        return hash | HASH_SLOT_TAG;
+    }
+
+    // the live record of key in table, nullptr if it has none there
+    ValueRecord<V> *Find(HashTable<K, V> *table, const K &key, uint64_t hash)
+    {
+        for(uint64_t probe = 0; probe < HASH_INDEX_MAX_PROBES; probe++) {
+            HashSlot<K, V> *slot = &table->mSlots[((hash >> 32) + probe) & table->mMask];
+            uint64_t slotHash = __atomic_load_n(&slot->mHash, __ATOMIC_ACQUIRE);
+
+            if(slotHash == 0) {
+                return nullptr;
+            }
+
+            if(slotHash == Tag(hash) && !mCompare(slot->mKey, key) && !mCompare(key, slot->mKey)) {
+                ValueRecord<V> *valData = __atomic_load_n(&slot->mRecord, __ATOMIC_ACQUIRE);
+                return valData != nullptr && __atomic_load_n(&valData->mExpires, __ATOMIC_ACQUIRE) != EXPIRATION_UNLINKED ? valData : nullptr;
+            }
+        }
+
+        return nullptr;
+    }
+
+    ValueRecord<V> *Lookup(const K &key, int myid)
+    {
+        uint64_t hash = hash_key(key);
+        HashTable<K, V> *table = __atomic_load_n(&mTable, __ATOMIC_ACQUIRE);
+        ValueRecord<V> *valData = Find(table, key, hash);
+
+        // an entry the table has not taken over yet is moved from the one it replaced
+        if(valData == nullptr && table->mPrevious != nullptr) {
+            valData = Find(table->mPrevious, key, hash);
+            if(valData != nullptr) {
+                Publish(key, valData, myid);
+            }
+        }
+
+        if(valData != nullptr) {
+            mCounters[myid].mHits++;
+        }
+        else {
+            mCounters[myid].mMisses++;
+        }
+
+        return valData;
+    }
+
+    // records that key is held by valData, found in or just added to the tree
+    void Publish(const K &key, ValueRecord<V> *valData, int myid)
+    {
+        uint64_t hash = hash_key(key);
+        HashTable<K, V> *table = __atomic_load_n(&mTable, __ATOMIC_ACQUIRE);
+
+        for(uint64_t probe = 0; probe < HASH_INDEX_MAX_PROBES; probe++) {
+            HashSlot<K, V> *slot = &table->mSlots[((hash >> 32) + probe) & table->mMask];
+            uint64_t slotHash = __atomic_load_n(&slot->mHash, __ATOMIC_ACQUIRE);
+
+            if(slotHash == 0) {
+                if(!__sync_bool_compare_and_swap(&slot->mHash, 0, HASH_SLOT_CLAIMED)) {
+                    // another publish claimed the slot, possibly for this key
+                    slotHash = __atomic_load_n(&slot->mHash, __ATOMIC_ACQUIRE);
+                }
+                else {
+                    memcpy((void *) &slot->mKey, (const void *) &key, sizeof(K));
+                    __atomic_store_n(&slot->mRecord, valData, __ATOMIC_RELAXED);
+                    __atomic_store_n(&slot->mHash, Tag(hash), __ATOMIC_RELEASE);
+                    mCounters[myid].mPublishes++;
+
+                    uint64_t claimed = __sync_add_and_fetch(&table->mClaimed, 1);
+                    if(claimed * 4 > (table->mMask + 1) * HASH_INDEX_LOAD_QUARTERS) {
+                        Grow(table, myid);
+                    }
+                    return;
+                }
+            }
+
+            // a slot that is still being claimed may be for the same key; publishing
+            // further on then leaves a second entry behind the first, which only costs a slot
+            if(slotHash == Tag(hash) && !mCompare(slot->mKey, key) && !mCompare(key, slot->mKey)) {
+                if(__atomic_load_n(&slot->mRecord, __ATOMIC_RELAXED) != valData) {
+                    __atomic_store_n(&slot->mRecord, valData, __ATOMIC_RELEASE);
+                    mCounters[myid].mPublishes++;
+                }
+                return;
+            }
+        }
+
+        // a probe sequence this long means the table is too crowded
+        Grow(table, myid);
+    }
+
+    // called by the delete that removed valData from the tree, before it returns. the
+    // mark is the record's expiration stamp, which also makes it read as expired
+    void Unlink(ValueRecord<V> *valData)
+    {
+        __atomic_store_n(&valData->mExpires, EXPIRATION_UNLINKED, __ATOMIC_RELEASE);
+    }
+
+    // forgets every entry; only while no other thread uses the index
+    void Clear()
+    {
+        HashTable<K, V> *table = mTable;
+        mTable = NewTable(table->mMask + 1, nullptr);
+
+        while(table != nullptr) {
+            HashTable<K, V> *previous = table->mPrevious;
+            free(table);
+            table = previous;
+        }
+    }
+
+    // replaces a full table; of the threads that find it full, one installs the successor
+    void Grow(HashTable<K, V> *table, int myid)
+    {
+        if(__atomic_load_n(&mTable, __ATOMIC_ACQUIRE) != table) {
+            return;
+        }
+
+        HashTable<K, V> *larger = NewTable((table->mMask + 1) * 2, table);
+        if(__sync_bool_compare_and_swap(&mTable, table, larger)) {
+            mCounters[myid].mResizes++;
+        }
+        else {
+            free(larger);
+        }
+    }
+
+    // sums the per-thread counters; the result is approximate while threads run
+    HashIndexCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _HELPING_POLICY_HPP_
+#define _HELPING_POLICY_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// when an operation helps the search (ST) or modify (MT) table slot picked by Select().
+// every mode except HELP_ALWAYS gives up some of the wait-freedom bound for fewer
+// helping traversals, but each keeps it bounded:
+//   HELP_ALWAYS     help any announced operation, even a completed one (the original behaviour)
+//   HELP_EVERY_KTH  help an announced operation at every k-th opportunity only
+//   HELP_PENDING    help only operations that have not completed; idle slots are only read
+//   HELP_AGED       help a pending operation once the helper has seen it pending for k opportunities
+enum HelpingMode {HELP_ALWAYS, HELP_EVERY_KTH, HELP_PENDING, HELP_AGED};
+
+struct HelpingCounters
+{
+    // helping opportunities, i.e. slots picked by Select()
+    uint64_t mChecks;
+    uint64_t mSearchHelps;
+    uint64_t mModifyHelps;
+    uint64_t mSkipped;
+};
+
+// HELP_AGED: the record a thread last saw in each slot (the search table, then
+// the modify table) and the opportunity at which it first saw it there
+struct AgedSlots
+{
+    const void **mSeen;
+    uint64_t *mSeenAt;
+};
+
+class HelpingPolicy
+{
+public:
+    HelpingMode mMode;
+    // k for HELP_EVERY_KTH and HELP_AGED
+    uint64_t mParameter;
+    ThreadCounters<HelpingCounters> mCounters;
+    AgedSlots *mAged;
+    uint32_t mNumThreads;
+
+    void InitializeHelpingPolicy(uint32_t numThreads)
+    {
+        mMode = HELP_ALWAYS;
+        mParameter = 1;
+        mNumThreads = numThreads;
+
+        mCounters.InitializeThreadCounters(numThreads);
+        mAged = (AgedSlots *) malloc(sizeof(AgedSlots) * numThreads);
+        for(uint32_t i=0; i<numThreads; i++) {
+            mAged[i].mSeen = (const void **) calloc(2 * numThreads, sizeof(const void *));
+            mAged[i].mSeenAt = (uint64_t *) calloc(2 * numThreads, sizeof(uint64_t));
+        }
+    }
+
+    // slot is the table index, offset by the number of threads for the modify table;
+    // pending is whether the record is announced and not yet completed
+    bool ShouldHelp(int myid, uint32_t slot, const void *record, bool pending)
+    {
+        HelpingCounters *counters = &mCounters[myid];
+        AgedSlots *aged = &mAged[myid];
+        uint64_t check = ++counters->mChecks;
+        bool help;
+
+        switch(mMode) {
+        case HELP_EVERY_KTH:
+            help = record != nullptr && check % mParameter == 0;
+            break;
+        case HELP_PENDING:
+            help = pending;
+            break;
+        case HELP_AGED:
+            if(!pending) {
+                help = false;
+            }
+            else if(aged->mSeen[slot] != record) {
+                aged->mSeen[slot] = record;
+                aged->mSeenAt[slot] = check;
+                help = mParameter == 0;
+            }
+            else {
+                help = check - aged->mSeenAt[slot] >= mParameter;
+            }
+            break;
+        default:
+            help = record != nullptr;
+            break;
+        }
+
+        if(!help) {
+            counters->mSkipped++;
+        }
+        else if(slot < mNumThreads) {
+            counters->mSearchHelps++;
+        }
+        else {
+            counters->mModifyHelps++;
+        }
+
+        return help;
+    }
+
+    // sums the per-thread counters; the result is approximate while threads run
+    HelpingCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef _HOT_KEY_CACHE_HPP_
+#define _HOT_KEY_CACHE_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include "key_hash.hpp"
+#include "word_value.hpp"
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define HOT_KEY_CACHE_WAYS 4
+
+// one set of the cache. readers validate with mSequence like a seqlock and
+// never write; a fill try-locks the set by making mSequence odd. a way is
+// valid only while its fill epoch matches mEpoch, so invalidation is a single
+// atomic increment that drops every way of the set
+template <class K, class V>
+struct alignas(CACHE_LINE_SIZE) HotKeySet
+{
+    uint32_t mSequence;
+    uint32_t mEpoch;
+    uint32_t mVictim;
+    uint32_t mFillEpoch[HOT_KEY_CACHE_WAYS];
+    K mKeys[HOT_KEY_CACHE_WAYS];
+    ValueRecord<V> *mValues[HOT_KEY_CACHE_WAYS];
+};
+
+struct HotKeyCounters
+{
+    uint64_t mHits;
+    uint64_t mMisses;
+    uint64_t mFills;
+    uint64_t mInvalidations;
+};
+
+// fixed-size set-associative cache from key to value record in front of
+// ConcurrentTree::Search. keys are copied without locks, so they must be
+// trivially copyable
+template <class K, class V, class Compare>
+class HotKeyCache
+{
+public:
+    HotKeySet<K, V> *mSets;
+    uint32_t mSetMask;
+    ThreadCounters<HotKeyCounters> mCounters;
+    Compare mCompare;
+
+    static_assert(std::is_trivially_copyable<K>::value, "hot key cache needs trivially copyable keys");
+
+    void InitializeHotKeyCache(uint32_t numSets, uint32_t numThreads, const Compare &compare)
+    {
+        // round the number of sets up to a power of two
+        uint32_t sets = 1;
+        while(sets < numSets) {
+            sets <<= 1;
+        }
+
+        mSets = (HotKeySet<K, V> *) aligned_alloc(CACHE_LINE_SIZE, sizeof(HotKeySet<K, V>) * sets);
+        memset((void *) mSets, 0, sizeof(HotKeySet<K, V>) * sets);
+        for(uint32_t i=0; i<sets; i++) {
+            // fill epochs start behind the set epoch so every way begins invalid
+            mSets[i].mEpoch = 1;
+        }
+        mSetMask = sets - 1;
+
+        mCounters.InitializeThreadCounters(numThreads);
+        mCompare = compare;
+    }
+
+    HotKeySet<K, V> *SetOf(const K &key)
+    {
+        return &mSets[(hash_key(key) >> 32) & mSetMask];
+    }
+
+    // the epoch a later Fill must still see for its value to be cached
+    uint32_t Epoch(const K &key)
+    {
+        return __atomic_load_n(&SetOf(key)->mEpoch, __ATOMIC_ACQUIRE);
+    }
+
+    ValueRecord<V> *Lookup(const K &key, int myid)
+    {
+        HotKeySet<K, V> *set = SetOf(key);
+        uint32_t sequence = __atomic_load_n(&set->mSequence, __ATOMIC_ACQUIRE);
+
+        if((sequence & 1) == 0) {
+            uint32_t epoch = __atomic_load_n(&set->mEpoch, __ATOMIC_ACQUIRE);
+            ValueRecord<V> *valData = nullptr;
+
+            for(int way=0; way<HOT_KEY_CACHE_WAYS; way++) {
+                if(set->mFillEpoch[way] == epoch && !mCompare(set->mKeys[way], key) && !mCompare(key, set->mKeys[way])) {
+                    valData = set->mValues[way];
+                    break;
+                }
+            }
+
+            // the reads above are only meaningful if no fill overlapped them
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(valData != nullptr && __atomic_load_n(&set->mSequence, __ATOMIC_RELAXED) == sequence) {
+                mCounters[myid].mHits++;
+                return valData;
+            }
+        }
+
+        mCounters[myid].mMisses++;
+        return nullptr;
+    }
+
+    // caches a record found by a traversal that started after Epoch returned epoch;
+    // gives up instead of waiting when another thread is filling the set
+    void Fill(const K &key, ValueRecord<V> *valData, uint32_t epoch, int myid)
+    {
+        HotKeySet<K, V> *set = SetOf(key);
+        uint32_t sequence = __atomic_load_n(&set->mSequence, __ATOMIC_RELAXED);
+
+        if((sequence & 1) != 0 || !__sync_bool_compare_and_swap(&set->mSequence, sequence, sequence + 1)) {
+            return;
+        }
+
+        // an invalidation since the traversal started means the record may be stale
+        if(__atomic_load_n(&set->mEpoch, __ATOMIC_ACQUIRE) == epoch) {
+            uint32_t way = set->mVictim;
+            set->mVictim = (way + 1) % HOT_KEY_CACHE_WAYS;
+
+            memcpy((void *) &set->mKeys[way], (const void *) &key, sizeof(K));
+            set->mValues[way] = valData;
+            set->mFillEpoch[way] = epoch;
+            mCounters[myid].mFills++;
+        }
+
+        __atomic_store_n(&set->mSequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+
+    void Invalidate(const K &key, int myid)
+    {
+        __sync_fetch_and_add(&SetOf(key)->mEpoch, 1);
+        mCounters[myid].mInvalidations++;
+    }
+
+    // invalidates every set at once
+    void InvalidateAll()
+    {
+        for(uint32_t i=0; i<=mSetMask; i++) {
+            __sync_fetch_and_add(&mSets[i].mEpoch, 1);
+        }
+    }
+
+    // sums the per-thread counters; the result is approximate while threads run
+    HotKeyCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _KEY_HASH_HPP_
+#define _KEY_HASH_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+// 64-bit hash of a trivially copyable key, shared by the caches and filters
+// that sit beside the tree
+template <class K>
+uint64_t hash_key(const K &key)
+{
+    uint64_t hash;
+
+    if constexpr (std::is_integral<K>::value) {
+        hash = (uint64_t) key;
+    }
+    else {
+        // FNV-1a over the key bytes
+        const unsigned char *bytes = (const unsigned char *) &key;
+        hash = 14695981039346656037ull;
+        for(size_t i=0; i<sizeof(K); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    // fibonacci hashing spreads sequential integer keys over the high bits
+    return hash * 11400714819323198485ull;
+}
+
+#endif
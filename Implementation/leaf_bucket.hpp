@@ -0,0 +1,229 @@
+#ifndef _LEAF_BUCKET_HPP_
+#define _LEAF_BUCKET_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include "word_value.hpp"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define MIN_LEAF_BUCKET_SIZE 8
+#define MAX_LEAF_BUCKET_SIZE 32
+
+// sorted key array stored in an external leaf when the tree runs with leaf
+// buckets. a bucket is immutable once it is reachable from the tree; inserts
+// and deletes build a new bucket that is installed by the window transaction
+template <class K, class V>
+class LeafBucket
+{
+public:
+    uint32_t mCount;
+    uint32_t mCapacity;
+    K *mKeys;
+    ValueRecord<V> **mValues;
+
+    // header, keys and values live in one block; the keys start on their own
+    // cache line so the vector loads never split a line
+    static size_t Bytes(uint32_t capacity)
+    {
+        size_t bytes = CACHE_LINE_SIZE + KeyBytes(capacity) + sizeof(ValueRecord<V> *) * capacity;
+        return (bytes + CACHE_LINE_SIZE - 1) & ~((size_t) CACHE_LINE_SIZE - 1);
+    }
+
+    // the block comes from the tree's allocation policy
+    template <class AllocPolicy>
+    static LeafBucket<K, V> *Allocate(uint32_t capacity)
+    {
+        char *block = (char *) AllocPolicy::Allocate(Bytes(capacity), CACHE_LINE_SIZE);
+        LeafBucket<K, V> *bucket = (LeafBucket<K, V> *) block;
+        bucket->mCount = 0;
+        bucket->mCapacity = capacity;
+        bucket->mKeys = (K *) (block + CACHE_LINE_SIZE);
+        bucket->mValues = (ValueRecord<V> **) (block + CACHE_LINE_SIZE + KeyBytes(capacity));
+        return bucket;
+    }
+
+    // only for a bucket no other thread has seen, such as the oversized copy of a split
+    template <class AllocPolicy>
+    void Free()
+    {
+        AllocPolicy::Free(this, Bytes(mCapacity), CACHE_LINE_SIZE);
+    }
+
+    // index of the key, or -1 if it is not in the bucket
+    template <class Q, class Compare>
+    int32_t Find(const Q &key, const Compare &compare) const
+    {
+        if constexpr (std::is_same<Q, K>::value && std::is_integral<K>::value &&
+                      (std::is_same<Compare, std::less<K>>::value || std::is_same<Compare, std::less<>>::value)) {
+            return FindVectorized(key);
+        }
+        else {
+            for(uint32_t i=0; i<mCount; i++) {
+                if(!compare(mKeys[i], key) && !compare(key, mKeys[i])) {
+                    return i;
+                }
+            }
+
+            return -1;
+        }
+    }
+
+    // index of the first key that is not ordered before key
+    template <class Compare>
+    uint32_t LowerBound(const K &key, const Compare &compare) const
+    {
+        uint32_t lo = 0;
+        uint32_t hi = mCount;
+
+        while(lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+
+            if(compare(mKeys[mid], key)) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+
+        return lo;
+    }
+
+    // copy of this bucket with the key inserted; a full bucket yields an
+    // oversized copy that the caller splits with CloneRange
+    template <class AllocPolicy, class Compare>
+    LeafBucket<K, V> *CloneWithInsert(const K &key, ValueRecord<V> *valData, const Compare &compare) const
+    {
+        uint32_t position = LowerBound(key, compare);
+        LeafBucket<K, V> *copy = Allocate<AllocPolicy>(mCount < mCapacity ? mCapacity : mCount + 1);
+
+        for(uint32_t i=0; i<position; i++) {
+            new (&copy->mKeys[i]) K(mKeys[i]);
+            copy->mValues[i] = mValues[i];
+        }
+
+        new (&copy->mKeys[position]) K(key);
+        copy->mValues[position] = valData;
+
+        for(uint32_t i=position; i<mCount; i++) {
+            new (&copy->mKeys[i + 1]) K(mKeys[i]);
+            copy->mValues[i + 1] = mValues[i];
+        }
+
+        copy->mCount = mCount + 1;
+        return copy;
+    }
+
+    // copy of this bucket without the key at index
+    template <class AllocPolicy>
+    LeafBucket<K, V> *CloneWithout(uint32_t index) const
+    {
+        LeafBucket<K, V> *copy = Allocate<AllocPolicy>(mCapacity);
+        uint32_t j = 0;
+
+        for(uint32_t i=0; i<mCount; i++) {
+            if(i != index) {
+                new (&copy->mKeys[j]) K(mKeys[i]);
+                copy->mValues[j] = mValues[i];
+                j++;
+            }
+        }
+
+        copy->mCount = j;
+        return copy;
+    }
+
+    // copy of the keys in [from, to) into a bucket of the given capacity
+    template <class AllocPolicy>
+    LeafBucket<K, V> *CloneRange(uint32_t from, uint32_t to, uint32_t capacity) const
+    {
+        LeafBucket<K, V> *copy = Allocate<AllocPolicy>(capacity);
+
+        for(uint32_t i=from; i<to; i++) {
+            new (&copy->mKeys[i - from]) K(mKeys[i]);
+            copy->mValues[i - from] = mValues[i];
+        }
+
+        copy->mCount = to - from;
+        return copy;
+    }
+
+private:
+    static size_t KeyBytes(uint32_t capacity)
+    {
+        return (sizeof(K) * capacity + CACHE_LINE_SIZE - 1) & ~((size_t) CACHE_LINE_SIZE - 1);
+    }
+
+    // equality search over the whole bucket; with at most 32 keys a full
+    // compare is cheaper than a binary search's unpredictable branches
+    int32_t FindVectorized(const K &key) const
+    {
+        uint32_t i = 0;
+
+#if defined(__AVX2__)
+        if constexpr (sizeof(K) == 8) {
+            __m256i probe = _mm256_set1_epi64x((long long) key);
+            for(; i + 4 <= mCount; i += 4) {
+                __m256i keys = _mm256_load_si256((const __m256i *) &mKeys[i]);
+                int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys, probe)));
+                if(mask != 0) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        }
+        else if constexpr (sizeof(K) == 4) {
+            __m256i probe = _mm256_set1_epi32((int) key);
+            for(; i + 8 <= mCount; i += 8) {
+                __m256i keys = _mm256_load_si256((const __m256i *) &mKeys[i]);
+                int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(keys, probe)));
+                if(mask != 0) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        }
+#elif defined(__SSE4_1__)
+        if constexpr (sizeof(K) == 8) {
+            __m128i probe = _mm_set1_epi64x((long long) key);
+            for(; i + 2 <= mCount; i += 2) {
+                __m128i keys = _mm_load_si128((const __m128i *) &mKeys[i]);
+                int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(keys, probe)));
+                if(mask != 0) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        }
+        else if constexpr (sizeof(K) == 4) {
+            __m128i probe = _mm_set1_epi32((int) key);
+            for(; i + 4 <= mCount; i += 4) {
+                __m128i keys = _mm_load_si128((const __m128i *) &mKeys[i]);
+                int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(keys, probe)));
+                if(mask != 0) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        }
+#endif
+
+        // tail, or the whole bucket when no vector extension is enabled
+        for(; i < mCount; i++) {
+            if(mKeys[i] == key) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+};
+
+#endif
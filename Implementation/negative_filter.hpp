@@ -0,0 +1,303 @@
+#ifndef _NEGATIVE_FILTER_HPP_
+#define _NEGATIVE_FILTER_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "key_hash.hpp"
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// counters per expected key and probes per key; with 10 counters and 4 probes
+// a generation filled to capacity answers "maybe" for ~1.2% of absent keys
+#define NEGATIVE_FILTER_COUNTERS_PER_KEY 10
+#define NEGATIVE_FILTER_HASHES 4
+// slots for generations; growing moves every key into the newest one, so
+// normally only one or two hold keys
+#define MAX_FILTER_GENERATIONS 8
+#define NO_FILTER_GENERATION UINT32_MAX
+// the generation of an insert that has not yet found out whether its key is absent
+#define FILTER_GENERATION_UNDECIDED (UINT32_MAX - 1)
+// population bit of a drained generation whose slot is being reused
+#define RETIRED_POPULATION ((uint64_t) 1 << 63)
+
+// one counting Bloom filter. counters saturate at 255 and are never
+// decremented once saturated, which can only cost false positives
+class FilterGeneration
+{
+public:
+    uint8_t *mCounters;
+    uint64_t mMask;
+    uint64_t mCapacity;
+    // keys counted in this generation and not yet removed, or RETIRED_POPULATION
+    uint64_t mPopulation;
+
+    void InitializeFilterGeneration(uint64_t capacity)
+    {
+        uint64_t size = 64;
+        while(size < capacity * NEGATIVE_FILTER_COUNTERS_PER_KEY) {
+            size <<= 1;
+        }
+
+        mCounters = (uint8_t *) calloc(size, sizeof(uint8_t));
+        mMask = size - 1;
+        mCapacity = capacity;
+        mPopulation = 0;
+    }
+
+    // false if the generation was retired; the population is raised before the
+    // counters, so a generation is never retired under a key being counted
+    bool Add(uint64_t hash)
+    {
+        if((__sync_fetch_and_add(&mPopulation, 1) & RETIRED_POPULATION) != 0) {
+            __sync_fetch_and_sub(&mPopulation, 1);
+            return false;
+        }
+
+        uint64_t step = (hash >> 32) | 1;
+
+        for(int i=0; i<NEGATIVE_FILTER_HASHES; i++) {
+            uint8_t *counter = &mCounters[(hash + i * step) & mMask];
+            uint8_t count = __atomic_load_n(counter, __ATOMIC_RELAXED);
+
+            while(count != UINT8_MAX && !__atomic_compare_exchange_n(counter, &count, count + 1, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        }
+
+        return true;
+    }
+
+    void Remove(uint64_t hash)
+    {
+        uint64_t step = (hash >> 32) | 1;
+
+        for(int i=0; i<NEGATIVE_FILTER_HASHES; i++) {
+            uint8_t *counter = &mCounters[(hash + i * step) & mMask];
+            uint8_t count = __atomic_load_n(counter, __ATOMIC_RELAXED);
+
+            while(count != UINT8_MAX && count != 0 && !__atomic_compare_exchange_n(counter, &count, count - 1, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        }
+
+        __sync_fetch_and_sub(&mPopulation, 1);
+    }
+
+    // keys counted here, none once retired
+    uint64_t Population()
+    {
+        uint64_t population = __atomic_load_n(&mPopulation, __ATOMIC_ACQUIRE);
+        return (population & RETIRED_POPULATION) != 0 ? 0 : population;
+    }
+
+    // succeeds only on a drained generation, which then refuses every Add
+    bool Retire()
+    {
+        return __sync_bool_compare_and_swap(&mPopulation, 0, RETIRED_POPULATION);
+    }
+
+    bool MayContain(uint64_t hash)
+    {
+        uint64_t step = (hash >> 32) | 1;
+
+        for(int i=0; i<NEGATIVE_FILTER_HASHES; i++) {
+            if(__atomic_load_n(&mCounters[(hash + i * step) & mMask], __ATOMIC_ACQUIRE) == 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+struct FilterCounters
+{
+    // lookups the filter answered as absent, and ones it let through to the tree
+    uint64_t mRejected;
+    uint64_t mPassed;
+    // lookups let through that the tree found absent
+    uint64_t mFalsePositives;
+    // generations opened, and keys moved into them from older ones
+    uint64_t mGrowths;
+    uint64_t mMoved;
+};
+
+// filter of the keys in the tree that answers "definitely absent" without a
+// traversal. a counting Bloom filter cannot be resized without its keys, so it
+// grows by generations: keys are counted in the newest generation, and the value
+// record remembers which one counted its key, so the delete removes it from the
+// same one. when the newest fills up, a generation sized for twice the keys
+// counted so far takes its place and the tree moves every key still counted in
+// an older one over to it. a drained generation is skipped, and its slot is
+// reused by a later growth
+template <class K>
+class NegativeFilter
+{
+public:
+    FilterGeneration *mGenerations[MAX_FILTER_GENERATIONS];
+    uint32_t mNewest;
+    uint32_t mGrowing;
+    ThreadCounters<FilterCounters> mCounters;
+
+    static_assert(std::is_trivially_copyable<K>::value, "negative filter hashes the key bytes");
+
+    void InitializeNegativeFilter(uint64_t expectedKeys, uint32_t numThreads)
+    {
+        memset((void *) mGenerations, 0, sizeof(mGenerations));
+        mGenerations[0] = (FilterGeneration *) malloc(sizeof(FilterGeneration));
+        mGenerations[0]->InitializeFilterGeneration(expectedKeys);
+        mNewest = 0;
+        mGrowing = 0;
+
+        mCounters.InitializeThreadCounters(numThreads);
+    }
+
+    // counts the key and returns the generation it was counted in; must happen
+    // before the key becomes visible in the tree. the newest generation is never
+    // retired, so only an Add that raced with a growth retries
+    uint32_t Add(const K &key)
+    {
+        uint64_t hash = hash_key(key);
+
+        while(true) {
+            uint32_t newest = __atomic_load_n(&mNewest, __ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&mGenerations[newest], __ATOMIC_ACQUIRE)->Add(hash)) {
+                return newest;
+            }
+        }
+    }
+
+    // uncounts a key after it has left the tree. generation is the word of its
+    // record; whoever moves it to NO_FILTER_GENERATION does the uncount, so a
+    // key a growth is moving is removed from whichever generation holds it
+    void Remove(const K &key, uint32_t *generation)
+    {
+        uint32_t current = __atomic_load_n(generation, __ATOMIC_ACQUIRE);
+
+        while(current != NO_FILTER_GENERATION) {
+            if(__atomic_compare_exchange_n(generation, &current, NO_FILTER_GENERATION, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                mGenerations[current]->Remove(hash_key(key));
+                return;
+            }
+        }
+    }
+
+    // false only if the key is definitely not in the tree
+    bool MayContain(const K &key)
+    {
+        uint64_t hash = hash_key(key);
+
+        for(uint32_t i=0; i<MAX_FILTER_GENERATIONS; i++) {
+            FilterGeneration *generation = __atomic_load_n(&mGenerations[i], __ATOMIC_ACQUIRE);
+
+            // a key is counted before it becomes visible, so an empty generation holds none of them
+            if(generation != nullptr && generation->Population() != 0 && generation->MayContain(hash)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // whether the newest generation holds more keys than it was sized for
+    bool Overflowing()
+    {
+        FilterGeneration *newest = mGenerations[__atomic_load_n(&mNewest, __ATOMIC_ACQUIRE)];
+        return newest->Population() > newest->mCapacity;
+    }
+
+    // opens a generation sized for twice the keys counted now in a free slot. false
+    // if another thread is growing the filter or the newest generation has room
+    // again; otherwise the caller moves the keys of the older generations into the
+    // new one with Move and then calls EndGrowth. with every slot holding keys the
+    // older generations are still moved, into the current newest, so the next
+    // growth finds their slots free
+    bool BeginGrowth(int myid)
+    {
+        if(!__sync_bool_compare_and_swap(&mGrowing, 0, 1)) {
+            return false;
+        }
+
+        if(!Overflowing()) {
+            __atomic_store_n(&mGrowing, 0, __ATOMIC_RELEASE);
+            return false;
+        }
+
+        uint32_t newest = mNewest;
+        uint32_t slot = MAX_FILTER_GENERATIONS;
+        uint64_t keys = 0;
+
+        for(uint32_t i=0; i<MAX_FILTER_GENERATIONS; i++) {
+            if(mGenerations[i] == nullptr || (mGenerations[i]->Population() == 0 && i != newest && mGenerations[i]->Retire())) {
+                slot = slot == MAX_FILTER_GENERATIONS ? i : slot;
+                continue;
+            }
+
+            keys += mGenerations[i]->Population();
+        }
+
+        if(slot != MAX_FILTER_GENERATIONS) {
+            auto generation = (FilterGeneration *) malloc(sizeof(FilterGeneration));
+            generation->InitializeFilterGeneration(keys * 2);
+            __atomic_store_n(&mGenerations[slot], generation, __ATOMIC_RELEASE);
+            __atomic_store_n(&mNewest, slot, __ATOMIC_RELEASE);
+            mCounters[myid].mGrowths++;
+        }
+
+        return true;
+    }
+
+    // moves a key still counted in an older generation into the newest one. it is
+    // counted in both for a moment, never in neither; if a delete claimed the
+    // record meanwhile, the new count is taken back
+    void Move(const K &key, uint32_t *generation, int myid)
+    {
+        uint32_t from = __atomic_load_n(generation, __ATOMIC_ACQUIRE);
+        uint32_t to = mNewest;
+
+        if(from == NO_FILTER_GENERATION || from == FILTER_GENERATION_UNDECIDED || from == to) {
+            return;
+        }
+
+        uint64_t hash = hash_key(key);
+        mGenerations[to]->Add(hash);
+
+        if(__atomic_compare_exchange_n(generation, &from, to, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            mGenerations[from]->Remove(hash);
+            mCounters[myid].mMoved++;
+        }
+        else {
+            mGenerations[to]->Remove(hash);
+        }
+    }
+
+    void EndGrowth()
+    {
+        __atomic_store_n(&mGrowing, 0, __ATOMIC_RELEASE);
+    }
+
+    // generations holding keys, and the keys counted in all of them
+    uint32_t Generations(uint64_t *keys)
+    {
+        uint32_t count = 0;
+        *keys = 0;
+
+        for(uint32_t i=0; i<MAX_FILTER_GENERATIONS; i++) {
+            FilterGeneration *generation = __atomic_load_n(&mGenerations[i], __ATOMIC_ACQUIRE);
+            uint64_t population = generation != nullptr ? generation->Population() : 0;
+            count += population != 0;
+            *keys += population;
+        }
+
+        return count;
+    }
+
+    // sums the per-thread counters; the result is approximate while threads run
+    FilterCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef _RELAXED_BALANCE_HPP_
+#define _RELAXED_BALANCE_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <pthread.h>
+#include <unistd.h>
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// keys each thread can have waiting for a repair; a violation marked while its
+// thread's log is full is dropped, and stays until a repair of a path through it
+#define BALANCE_LOG_KEYS 1024
+// recolourings and rotations one repair of a path may try before moving on
+#define BALANCE_MAX_STEPS 256
+// how long the background rebalancer sleeps when no violation has been marked
+#define BALANCE_IDLE_MICROSECONDS 1000
+
+struct BalanceCounters
+{
+    // inserts that hung a red node below a red one, and the ones whose log was full
+    uint64_t mViolations;
+    uint64_t mDropped;
+    // paths repaired, and the recolourings and rotations applied by this thread as the rebalancer
+    uint64_t mRepairs;
+    uint64_t mRecolorings;
+    uint64_t mRotations;
+};
+
+// keys of the inserts a thread marked, written at mHead by the thread alone and
+// taken at mTail by the one repair running
+template <class K>
+struct alignas(CACHE_LINE_SIZE) ViolationLog
+{
+    K *mKeys;
+    uint64_t mHead;
+    uint64_t mTail;
+};
+
+// state of the relaxed-balance mode in the style of chromatic trees: writers do no
+// restructuring and only log the key of an insert that left a red node under a red
+// parent, and the violations on the logged keys' paths are repaired later by a
+// background rebalancer or by any thread calling Rebalance. keys are copied
+// between threads without locks, so they must be trivially copyable
+template <class K>
+class RelaxedBalance
+{
+public:
+    ViolationLog<K> *mLogs;
+    ThreadCounters<BalanceCounters> mCounters;
+    uint32_t mNumThreads;
+    // serializes repairs, so concurrent repairs do not rotate the same nodes
+    uint32_t mRepairing;
+    pthread_t mThread;
+    uint32_t mRunning;
+    int mRebalancerId;
+
+    static_assert(std::is_trivially_copyable<K>::value, "relaxed balance needs trivially copyable keys");
+
+    void InitializeRelaxedBalance(uint32_t numThreads)
+    {
+        mNumThreads = numThreads;
+        mLogs = (ViolationLog<K> *) aligned_alloc(CACHE_LINE_SIZE, sizeof(ViolationLog<K>) * numThreads);
+        for(uint32_t i=0; i<numThreads; i++) {
+            mLogs[i].mKeys = (K *) malloc(sizeof(K) * BALANCE_LOG_KEYS);
+            mLogs[i].mHead = 0;
+            mLogs[i].mTail = 0;
+        }
+        mCounters.InitializeThreadCounters(numThreads);
+        mRepairing = 0;
+        mRunning = 0;
+        mRebalancerId = -1;
+    }
+
+    // called by a writer whose insert marked a violation; only the writer's own lines are written
+    void Mark(const K &key, int myid)
+    {
+        ViolationLog<K> *log = &mLogs[myid];
+        uint64_t head = log->mHead;
+        mCounters[myid].mViolations++;
+
+        if(head - __atomic_load_n(&log->mTail, __ATOMIC_ACQUIRE) == BALANCE_LOG_KEYS) {
+            mCounters[myid].mDropped++;
+            return;
+        }
+
+        log->mKeys[head % BALANCE_LOG_KEYS] = key;
+        __atomic_store_n(&log->mHead, head + 1, __ATOMIC_RELEASE);
+    }
+
+    // keys waiting in thread pid's log
+    uint64_t Pending(uint32_t pid)
+    {
+        return __atomic_load_n(&mLogs[pid].mHead, __ATOMIC_ACQUIRE) - mLogs[pid].mTail;
+    }
+
+    bool Pending()
+    {
+        for(uint32_t i=0; i<mNumThreads; i++) {
+            if(__atomic_load_n(&mLogs[i].mHead, __ATOMIC_RELAXED) != __atomic_load_n(&mLogs[i].mTail, __ATOMIC_RELAXED)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the oldest key of thread pid's log, which Pending found there; only the running repair takes keys
+    K Take(uint32_t pid)
+    {
+        ViolationLog<K> *log = &mLogs[pid];
+        K key = log->mKeys[log->mTail % BALANCE_LOG_KEYS];
+        __atomic_store_n(&log->mTail, log->mTail + 1, __ATOMIC_RELEASE);
+        return key;
+    }
+
+    BalanceCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
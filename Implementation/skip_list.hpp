@@ -0,0 +1,142 @@
+#ifndef _SKIP_LIST_HPP_
+#define _SKIP_LIST_HPP_
+
+#include "concurrent.hpp"
+
+// tallest tower a node can get; enough for 2^SKIP_LIST_MAX_HEIGHT keys at p = 1/2
+#define SKIP_LIST_MAX_HEIGHT 24
+// set in a next word of a node that is being deleted: the link is frozen and the
+// node is snipped out of that level by whichever thread passes it
+#define SKIP_LIST_MARK ((uintptr_t) 1)
+
+template <class K, class V>
+class SkipNode
+{
+public:
+    K mKey;
+    uint32_t mHeight;
+    // the value record of the key, with the same semantics as in ConcurrentTree
+    ValueRecord<V> mRecord;
+    // successors on levels 0 to mHeight - 1 with their marks; the array is
+    // allocated with the node to the height of its tower
+    uintptr_t mNext[1];
+
+    static size_t Size(uint32_t height)
+    {
+        return sizeof(SkipNode<K, V>) + (height - 1) * sizeof(uintptr_t);
+    }
+
+    void InitializeSkipNode(uint32_t height)
+    {
+        new (&mKey) K();
+        mHeight = height;
+        memset(mNext, 0, height * sizeof(uintptr_t));
+    }
+
+    static SkipNode<K, V> *Address(uintptr_t word)
+    {
+        return (SkipNode<K, V> *) (word & ~SKIP_LIST_MARK);
+    }
+};
+
+// per-thread state, padded so threads do not share lines
+struct alignas(CACHE_LINE_SIZE) SkipListThread
+{
+    // xorshift state of the thread's tower heights
+    uint64_t mSeed;
+    // links whose CAS lost to a concurrent change and were attempted again
+    uint64_t mRetries;
+    // marked nodes this thread snipped out of a level
+    uint64_t mSnips;
+};
+
+// lock-free skip list after Fraser and Herlihy-Shavit: a node is in the set once
+// it is linked on level 0 and leaves it when its level-0 link is marked; the
+// upper levels only speed up searches. it offers the Search/InsertOrUpdate/Delete
+// interface of ConcurrentTree with the same value records, values copied into the
+// same ValueArena and nodes taken from the same AllocPolicy, and walks a key
+// range in order along level 0
+template <class K, class V, class Compare = std::less<K>, class AllocPolicy = MallocAlloc>
+class LockFreeSkipList
+{
+public:
+    // a full-height tower ordered before every key; a null successor ends a level
+    SkipNode<K, V> *mHead;
+    uint32_t mNumThreads;
+    Compare mCompare;
+    ValueArena<V> *mValueArena;
+    SkipListThread *mThreads;
+
+    LockFreeSkipList(int numThreads, const Compare &compare = Compare())
+    {
+        mCompare = compare;
+        mNumThreads = numThreads;
+
+        mValueArena = (ValueArena<V> *) malloc(sizeof(ValueArena<V>));
+        mValueArena->InitializeValueArena(numThreads);
+
+        mThreads = (SkipListThread *) aligned_alloc(CACHE_LINE_SIZE, sizeof(SkipListThread) * numThreads);
+        memset((void *) mThreads, 0, sizeof(SkipListThread) * numThreads);
+        for(int i=0; i<numThreads; i++) {
+            mThreads[i].mSeed = 0x9e3779b97f4a7c15 * (i + 1);
+        }
+
+        mHead = NewNode(SKIP_LIST_MAX_HEIGHT);
+    }
+
+    V* Search(const K &key, int myid);
+    // the record holding the key's value, or nullptr if the key is absent
+    ValueRecord<V> *SearchRecord(const K &key, int myid);
+    void InsertOrUpdate(const K &key, V *value, int myid);
+    // stores a copy of value owned by the list. a pointer to it returned by Search
+    // stays valid until the calling thread's next operation or Quiesce
+    void InsertOrUpdate(const K &key, const V &value, int myid);
+    void Delete(const K &key, int myid);
+    void Quiesce(int myid);
+
+    // calls visit(key, value) for the keys in [low, high) in ascending order, until
+    // it returns false. the walk is weakly consistent: a key present for all of it
+    // is visited once, one inserted or deleted during it may or may not be. the
+    // values stay valid until the calling thread's next operation or Quiesce
+    template <class Visit>
+    void ForEachInRange(const K &low, const K &high, Visit visit, int myid);
+    // copies up to max keys of [low, high) and their values, in ascending order; returns how many
+    size_t RangeSearch(const K &low, const K &high, K *keys, V **values, size_t max, int myid);
+
+    // adds a node holding value unless the key is present, and returns the record now
+    // holding the key; inserted tells whether it is the new node's
+    ValueRecord<V> *InsertKey(const K &key, V *value, bool ownedValue, bool *inserted, int myid);
+    // removes the key and returns its record, nullptr if another delete removed it first
+    ValueRecord<V> *DeleteKey(const K &key, int myid);
+    // fills the last node before key and the first from key on, on every level,
+    // snipping marked nodes on the way; whether the level-0 successor holds key
+    bool Find(const K &key, SkipNode<K, V> **preds, SkipNode<K, V> **succs, int myid);
+    // the first unmarked node holding a key from key on, without writing anything
+    SkipNode<K, V> *LowerBound(const K &key);
+    uint32_t RandomHeight(int myid);
+    void RetireValue(ValueRecord<V> *valData, V *replaced, int myid);
+
+    // is the node's key ordered before key; the end of a level (null) is after everything
+    bool NodeLess(SkipNode<K, V> *dNode, const K &key)
+    {
+        return dNode != nullptr && mCompare(dNode->mKey, key);
+    }
+
+    bool KeyEquals(const K &key, SkipNode<K, V> *dNode)
+    {
+        return dNode != nullptr && !mCompare(key, dNode->mKey) && !mCompare(dNode->mKey, key);
+    }
+
+    SkipNode<K, V> *NewNode(uint32_t height)
+    {
+        SkipNode<K, V> *dNode = (SkipNode<K, V> *) AllocPolicy::Allocate(SkipNode<K, V>::Size(height), alignof(SkipNode<K, V>));
+        dNode->InitializeSkipNode(height);
+        return dNode;
+    }
+
+    SkipListThread GetSkipListCounters();
+};
+
+#include "skip_list.tcc"
+
+#endif
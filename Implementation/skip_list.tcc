@@ -0,0 +1,379 @@
+template <class K, class V, class Compare, class AllocPolicy>
+V *LockFreeSkipList<K, V, Compare, AllocPolicy>::Search(const K &key, int myid)
+{
+    ValueRecord<V> *valData = SearchRecord(key, myid);
+    return valData != nullptr ? valData->ReadValue() : nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+ValueRecord<V> *LockFreeSkipList<K, V, Compare, AllocPolicy>::SearchRecord(const K &key, int myid)
+{
+    // every operation starts here; values the thread got from earlier ones may now be reclaimed
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    SkipNode<K, V> *dNode = LowerBound(key);
+    return KeyEquals(key, dNode) ? &dNode->mRecord : nullptr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeSkipList<K, V, Compare, AllocPolicy>::InsertOrUpdate(const K &key, V *value, int myid)
+{
+    bool inserted = false;
+
+    // phase 1: determine if the key already exists in the list
+    ValueRecord<V> *valData = SearchRecord(key, myid);
+
+    if(valData == nullptr) {
+        // phase 2: add a node for the key, or find the one a concurrent insert added
+        valData = InsertKey(key, value, false, &inserted, myid);
+    }
+
+    if(inserted) {
+        return;
+    }
+
+    // phase 3: update the value in the record, as ConcurrentTree does
+    if constexpr(WordValue<V>::value) {
+        V current = valData->LoadValue();
+        while(memcmp(&current, value, sizeof(V)) != 0 && !valData->CompareExchange(&current, *value));
+    }
+    else {
+        uint32_t gate;
+        V *current, *replaced;
+        while((current = valData->ReadValue(&gate)) != value && current != nullptr) {
+            if(valData->WriteValue(value, gate, false, &replaced)) {
+                RetireValue(valData, replaced, myid);
+                break;
+            }
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeSkipList<K, V, Compare, AllocPolicy>::InsertOrUpdate(const K &key, const V &value, int myid)
+{
+    if constexpr(WordValue<V>::value) {
+        InsertOrUpdate(key, const_cast<V *>(&value), myid);
+    }
+    else {
+        // phase 1: determine if the key already exists in the list
+        ValueRecord<V> *valData = SearchRecord(key, myid);
+        V *copy = nullptr;
+
+        if(valData == nullptr) {
+            // phase 2: no other thread builds this node, so a small value is copied
+            // straight into its record and a large one into an arena slot
+            if constexpr(!ValueArena<V>::INLINE) {
+                copy = mValueArena->Copy(value, myid);
+            }
+
+            bool inserted;
+            valData = InsertKey(key, ValueArena<V>::INLINE ? const_cast<V *>(&value) : copy, true, &inserted, myid);
+            if(inserted) {
+                return;
+            }
+        }
+
+        // phase 3: the key was present; a copy that was never published is reused
+        if(copy == nullptr) {
+            copy = mValueArena->Copy(value, myid);
+        }
+
+        uint32_t gate;
+        V *replaced;
+        while(valData->ReadValue(&gate) != nullptr) {
+            if(valData->WriteValue(copy, gate, true, &replaced)) {
+                RetireValue(valData, replaced, myid);
+                return;
+            }
+        }
+
+        // the key was deleted before the copy was published
+        mValueArena->Release(copy, myid);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+ValueRecord<V> *LockFreeSkipList<K, V, Compare, AllocPolicy>::InsertKey(const K &key, V *value, bool ownedValue, bool *inserted, int myid)
+{
+    uint32_t height = RandomHeight(myid);
+    SkipNode<K, V> *dNode = NewNode(height);
+    dNode->mKey = key;
+
+    ValueRecord<V> *valData = &dNode->mRecord;
+    if constexpr(WordValue<V>::value) {
+        valData->InitializeValueRecord(*value);
+    }
+    else {
+        if constexpr(ValueArena<V>::INLINE) {
+            if(ownedValue) {
+                valData->InitializeInlineValueRecord(*value, 0);
+            }
+            else {
+                valData->InitializeValueRecord(value, 0);
+            }
+        }
+        else {
+            valData->InitializeValueRecord(value, 0);
+            valData->mOwned = ownedValue;
+        }
+    }
+
+    SkipNode<K, V> *preds[SKIP_LIST_MAX_HEIGHT];
+    SkipNode<K, V> *succs[SKIP_LIST_MAX_HEIGHT];
+
+    // linking the node on level 0 is the point the key is added at
+    while(true) {
+        if(Find(key, preds, succs, myid)) {
+            // the new node was never published; an inline copy is destroyed here, an
+            // arena copy stays with the caller
+            if constexpr(!WordValue<V>::value) {
+                if(ValueArena<V>::INLINE && ownedValue) {
+                    valData->InlineValue()->~V();
+                }
+            }
+
+            *inserted = false;
+            return &succs[0]->mRecord;
+        }
+
+        for(uint32_t level = 0; level < height; level++) {
+            dNode->mNext[level] = (uintptr_t) succs[level];
+        }
+
+        if(__sync_bool_compare_and_swap(&preds[0]->mNext[0], (uintptr_t) succs[0], (uintptr_t) dNode)) {
+            break;
+        }
+
+        mThreads[myid].mRetries++;
+    }
+
+    *inserted = true;
+
+    // the rest of the tower, bottom up. a delete that marks a level first stops the
+    // build there; a level it marks after the node was linked is snipped by Find
+    for(uint32_t level = 1; level < height; level++) {
+        while(true) {
+            uintptr_t next = __atomic_load_n(&dNode->mNext[level], __ATOMIC_ACQUIRE);
+            if((next & SKIP_LIST_MARK) != 0) {
+                return valData;
+            }
+
+            // only a delete changes the word meanwhile, by marking it
+            if(SkipNode<K, V>::Address(next) != succs[level] &&
+               !__sync_bool_compare_and_swap(&dNode->mNext[level], next, (uintptr_t) succs[level])) {
+                return valData;
+            }
+
+            if(__sync_bool_compare_and_swap(&preds[level]->mNext[level], (uintptr_t) succs[level], (uintptr_t) dNode)) {
+                break;
+            }
+
+            mThreads[myid].mRetries++;
+            Find(key, preds, succs, myid);
+            if(succs[0] != dNode) {
+                return valData;
+            }
+        }
+    }
+
+    return valData;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeSkipList<K, V, Compare, AllocPolicy>::Delete(const K &key, int myid)
+{
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    ValueRecord<V> *removed = DeleteKey(key, myid);
+
+    // close the removed record, so a racing update cannot install a value in it
+    // after its last value has been retired. words are never retired
+    if constexpr(!WordValue<V>::value) {
+        if(removed != nullptr) {
+            uint32_t gate;
+            V *replaced = nullptr;
+            while(removed->ReadValue(&gate) != nullptr && !removed->WriteValue(nullptr, gate, false, &replaced));
+            RetireValue(removed, replaced, myid);
+        }
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+ValueRecord<V> *LockFreeSkipList<K, V, Compare, AllocPolicy>::DeleteKey(const K &key, int myid)
+{
+    SkipNode<K, V> *preds[SKIP_LIST_MAX_HEIGHT];
+    SkipNode<K, V> *succs[SKIP_LIST_MAX_HEIGHT];
+
+    if(!Find(key, preds, succs, myid)) {
+        return nullptr;
+    }
+
+    // the upper levels are marked top down, so no search is led to the node from
+    // above once it has left level 0
+    SkipNode<K, V> *dNode = succs[0];
+    for(uint32_t level = dNode->mHeight - 1; level > 0; level--) {
+        __atomic_fetch_or(&dNode->mNext[level], SKIP_LIST_MARK, __ATOMIC_SEQ_CST);
+    }
+
+    // marking level 0 is the point the key is removed at; of the deletes that found
+    // the node, the one that marks it owns the record
+    if((__atomic_fetch_or(&dNode->mNext[0], SKIP_LIST_MARK, __ATOMIC_SEQ_CST) & SKIP_LIST_MARK) != 0) {
+        return nullptr;
+    }
+
+    // snips the node out of every level
+    Find(key, preds, succs, myid);
+    return &dNode->mRecord;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+bool LockFreeSkipList<K, V, Compare, AllocPolicy>::Find(const K &key, SkipNode<K, V> **preds, SkipNode<K, V> **succs, int myid)
+{
+retry:
+    SkipNode<K, V> *dPred = mHead;
+
+    for(int level = SKIP_LIST_MAX_HEIGHT - 1; level >= 0; level--) {
+        SkipNode<K, V> *dCurr = SkipNode<K, V>::Address(__atomic_load_n(&dPred->mNext[level], __ATOMIC_ACQUIRE));
+
+        while(dCurr != nullptr) {
+            uintptr_t succ = __atomic_load_n(&dCurr->mNext[level], __ATOMIC_ACQUIRE);
+
+            if((succ & SKIP_LIST_MARK) != 0) {
+                // a marked predecessor has frozen its link; the walk starts over
+                if(!__sync_bool_compare_and_swap(&dPred->mNext[level], (uintptr_t) dCurr, succ & ~SKIP_LIST_MARK)) {
+                    goto retry;
+                }
+
+                mThreads[myid].mSnips++;
+                dCurr = SkipNode<K, V>::Address(succ);
+                continue;
+            }
+
+            if(!NodeLess(dCurr, key)) {
+                break;
+            }
+
+            dPred = dCurr;
+            dCurr = SkipNode<K, V>::Address(succ);
+        }
+
+        preds[level] = dPred;
+        succs[level] = dCurr;
+    }
+
+    return KeyEquals(key, succs[0]);
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+SkipNode<K, V> *LockFreeSkipList<K, V, Compare, AllocPolicy>::LowerBound(const K &key)
+{
+    // like Find, but marked nodes are stepped over instead of snipped
+    SkipNode<K, V> *dPred = mHead;
+    SkipNode<K, V> *dCurr = nullptr;
+
+    for(int level = SKIP_LIST_MAX_HEIGHT - 1; level >= 0; level--) {
+        dCurr = SkipNode<K, V>::Address(__atomic_load_n(&dPred->mNext[level], __ATOMIC_ACQUIRE));
+
+        while(dCurr != nullptr) {
+            uintptr_t succ = __atomic_load_n(&dCurr->mNext[level], __ATOMIC_ACQUIRE);
+
+            if((succ & SKIP_LIST_MARK) == 0) {
+                if(!NodeLess(dCurr, key)) {
+                    break;
+                }
+                dPred = dCurr;
+            }
+
+            dCurr = SkipNode<K, V>::Address(succ);
+        }
+    }
+
+    return dCurr;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+template <class Visit>
+void LockFreeSkipList<K, V, Compare, AllocPolicy>::ForEachInRange(const K &low, const K &high, Visit visit, int myid)
+{
+    if constexpr(!WordValue<V>::value) {
+        mValueArena->Enter(myid);
+    }
+
+    SkipNode<K, V> *dNode = LowerBound(low);
+
+    while(NodeLess(dNode, high)) {
+        uintptr_t next = __atomic_load_n(&dNode->mNext[0], __ATOMIC_ACQUIRE);
+
+        // a record closed by a delete holds no value
+        if((next & SKIP_LIST_MARK) == 0) {
+            V *value = dNode->mRecord.ReadValue();
+            if(value != nullptr && !visit(dNode->mKey, value)) {
+                return;
+            }
+        }
+
+        dNode = SkipNode<K, V>::Address(next);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+size_t LockFreeSkipList<K, V, Compare, AllocPolicy>::RangeSearch(const K &low, const K &high, K *keys, V **values, size_t max, int myid)
+{
+    size_t count = 0;
+
+    if(max != 0) {
+        ForEachInRange(low, high, [&](const K &key, V *value) {
+            keys[count] = key;
+            values[count] = value;
+            return ++count < max;
+        }, myid);
+    }
+
+    return count;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+uint32_t LockFreeSkipList<K, V, Compare, AllocPolicy>::RandomHeight(int myid)
+{
+    // xorshift64; the trailing zeros of a random word are geometric with p = 1/2
+    uint64_t x = mThreads[myid].mSeed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    mThreads[myid].mSeed = x;
+
+    return __builtin_ctzll(x | ((uint64_t) 1 << (SKIP_LIST_MAX_HEIGHT - 1))) + 1;
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeSkipList<K, V, Compare, AllocPolicy>::Quiesce(int myid)
+{
+    mValueArena->Quiesce(myid);
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+void LockFreeSkipList<K, V, Compare, AllocPolicy>::RetireValue(ValueRecord<V> *valData, V *replaced, int myid)
+{
+    if(replaced != nullptr) {
+        mValueArena->Retire(replaced, replaced == valData->InlineValue(), myid);
+    }
+}
+
+template <class K, class V, class Compare, class AllocPolicy>
+SkipListThread LockFreeSkipList<K, V, Compare, AllocPolicy>::GetSkipListCounters()
+{
+    SkipListThread total;
+    memset((void *) &total, 0, sizeof(total));
+
+    for(uint32_t i=0; i<mNumThreads; i++) {
+        total.mRetries += mThreads[i].mRetries;
+        total.mSnips += mThreads[i].mSnips;
+    }
+
+    return total;
+}
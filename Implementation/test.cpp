@@ -18,24 +18,29 @@
 #define DELETE_WEIGHT 5
 #define SEARCH_WEIGHT 90
 
+#define KEY_LENGTH 7
+
+// 7 random lowercase characters plus the terminator, compared bytewise
+typedef FixedKey<KEY_LENGTH + 1> Key;
+
 pthread_mutex_t outputStream;
 
 template <class V>
 struct ArgsStruct
 {
-    ConcurrentTree<V> *mTree;
+    ConcurrentTree<Key, V> *mTree;
     int mPid;
     uint32_t mSearchWeight;
     uint32_t mInsertWeight;
     uint32_t mDeleteWeight;
 
-    ArgsStruct(ConcurrentTree<V> *tree, int pid)
+    ArgsStruct(ConcurrentTree<Key, V> *tree, int pid)
     {
         mTree = tree;
         mPid = pid;
     }
 
-    ArgsStruct(ConcurrentTree<V> *tree, int pid, int sw, int iw, int dw)
+    ArgsStruct(ConcurrentTree<Key, V> *tree, int pid, int sw, int iw, int dw)
     {
         mTree = tree;
         mPid = pid;
@@ -51,19 +56,18 @@ void *inserter(void* args)
     ArgsStruct<V> *myArgs = (ArgsStruct<V>*) args;
 
     for(int i=0; i<INSERTIONS_PER_THREAD; i++) {
-        char buffer[8];
-        uint32_t hash = 0;
+        char buffer[KEY_LENGTH + 1];
 
-        for(int i=0; i<7; i++) {
+        for(int i=0; i<KEY_LENGTH; i++) {
             buffer[i] = rand() % ('z' - 'a') + 'a';
-            hash = (31 * hash) + (uint32_t) buffer[i];
         }
         
-        buffer[7] = '\0';
+        buffer[KEY_LENGTH] = '\0';
+        Key key (buffer);
         std::string str (buffer);
-        std::string *str_ptr = (std::string *) malloc(str.size());
 
-        myArgs->mTree->InsertOrUpdate(hash, str_ptr, myArgs->mPid);
+        // the tree keeps its own copy of the value
+        myArgs->mTree->InsertOrUpdate(key, str, myArgs->mPid);
     }
 
     return nullptr;
@@ -75,15 +79,16 @@ void *deleter(void* args)
     ArgsStruct<V> *myArgs = (ArgsStruct<V>*) args;
 
     for(int i=0; i<DELETIONS_PER_THREAD; i++) {
-        char buffer;
-        uint32_t hash = 0;
+        char buffer[KEY_LENGTH + 1];
 
-        for(int i=0; i<7; i++) {
-            buffer = rand() % ('z' - 'a') + 'a';
-            hash = (31 * hash) + (uint32_t) buffer;
+        for(int i=0; i<KEY_LENGTH; i++) {
+            buffer[i] = rand() % ('z' - 'a') + 'a';
         }
 
-        myArgs->mTree->Delete(hash, myArgs->mPid);
+        buffer[KEY_LENGTH] = '\0';
+        Key key (buffer);
+
+        myArgs->mTree->Delete(key, myArgs->mPid);
     }
 
     return nullptr;
@@ -95,15 +100,16 @@ void *searcher(void* args)
     ArgsStruct<V> *myArgs = (ArgsStruct<V>*) args;
 
     for(int i=0; i<SEARCHES_PER_THREAD; i++) {
-        char buffer;
-        uint32_t hash = 0;
+        char buffer[KEY_LENGTH + 1];
 
-        for(int i=0; i<7; i++) {
-            buffer = rand() % ('z' - 'a') + 'a';
-            hash = (31 * hash) + (uint32_t) buffer;
+        for(int i=0; i<KEY_LENGTH; i++) {
+            buffer[i] = rand() % ('z' - 'a') + 'a';
         }
 
-        myArgs->mTree->Search(hash, myArgs->mPid);
+        buffer[KEY_LENGTH] = '\0';
+        Key key (buffer);
+
+        myArgs->mTree->Search(key, myArgs->mPid);
     }
 
     return nullptr;
@@ -127,43 +133,43 @@ void *dynamic_worker(void *args)
 
         if(roll < sw) {
             // SEARCH
-            char buffer;
-            uint32_t hash = 0;
+            char buffer[KEY_LENGTH + 1];
 
-            for(int i=0; i<7; i++) {
-                buffer = rand() % ('z' - 'a') + 'a';
-                hash = (31 * hash) + (uint32_t) buffer;
+            for(int i=0; i<KEY_LENGTH; i++) {
+                buffer[i] = rand() % ('z' - 'a') + 'a';
             }
 
-            myArgs->mTree->Search(hash, myArgs->mPid);
+            buffer[KEY_LENGTH] = '\0';
+            Key key (buffer);
+
+            myArgs->mTree->Search(key, myArgs->mPid);
         }
         else if(roll < iw) {
             // INSERT or UPDATE
-            char buffer[8];
-            uint32_t hash = 0;
+            char buffer[KEY_LENGTH + 1];
 
-            for(int i=0; i<7; i++) {
+            for(int i=0; i<KEY_LENGTH; i++) {
                 buffer[i] = rand() % ('z' - 'a') + 'a';
-                hash = (31 * hash) + (uint32_t) buffer[i];
             }
             
-            buffer[7] = '\0';
+            buffer[KEY_LENGTH] = '\0';
+            Key key (buffer);
             std::string str (buffer);
-            std::string *str_ptr = (std::string *) malloc(str.size());
 
-            myArgs->mTree->InsertOrUpdate(hash, str_ptr, myArgs->mPid);
+            myArgs->mTree->InsertOrUpdate(key, str, myArgs->mPid);
         }
         else if(roll < dw) {
             // DELETE
-            char buffer;
-            uint32_t hash = 0;
+            char buffer[KEY_LENGTH + 1];
 
-            for(int i=0; i<7; i++) {
-                buffer = rand() % ('z' - 'a') + 'a';
-                hash = (31 * hash) + (uint32_t) buffer;
+            for(int i=0; i<KEY_LENGTH; i++) {
+                buffer[i] = rand() % ('z' - 'a') + 'a';
             }
 
-            myArgs->mTree->Delete(hash, myArgs->mPid);
+            buffer[KEY_LENGTH] = '\0';
+            Key key (buffer);
+
+            myArgs->mTree->Delete(key, myArgs->mPid);
         }
         else {
             // 0 weight for each operation. no operation can be chosen.
@@ -171,6 +177,7 @@ void *dynamic_worker(void *args)
         }
     }
 
+    myArgs->mTree->Quiesce(myArgs->mPid);
     return nullptr;
 }
 
@@ -179,11 +186,11 @@ int main(void)
     srand(time(NULL));
 
     pthread_t* threads;
-    threads = (pthread_t*)malloc(NUM_THREADS * sizeof(pthread_t));
+    threads = (pthread_t*)malloc(NUM_DYNAMIC_THREADS * sizeof(pthread_t));
 
     pthread_mutex_init(&outputStream, NULL);
 
-    ConcurrentTree<std::string> *tree = new ConcurrentTree<std::string>(NUM_THREADS);
+    ConcurrentTree<Key, std::string> *tree = new ConcurrentTree<Key, std::string>(NUM_DYNAMIC_THREADS);
 
     uint32_t sw = SEARCH_WEIGHT;
     uint32_t iw = INSERT_WEIGHT;
@@ -195,7 +202,7 @@ int main(void)
         pthread_create(&threads[i], NULL, dynamic_worker<std::string>, (void *) new ArgsStruct<std::string>(tree, i, sw, iw, dw));
     }
 
-    for(int i = 0; i < NUM_THREADS; i++)
+    for(int i = 0; i < NUM_DYNAMIC_THREADS; i++)
     {
         pthread_join(threads[i], NULL);
     }
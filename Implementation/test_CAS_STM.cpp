@@ -0,0 +1,7 @@
+#include "bench_policies.h"
+
+// nodes and operation records from the STM's allocator, shared words accessed in transactions
+int main(void)
+{
+    return run_policy_benchmark<TMAlloc, TMSync>("TM_ALLOC + STM");
+}
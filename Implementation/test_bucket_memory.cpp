@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// memory per key with one-key leaves and with leaf buckets. the trees are built
+// through InsertOrUpdate on an allocation policy that counts its bytes, then
+// walked to sum what is still reachable: data nodes, buckets and the value
+// records a bucket points to. the bytes allocated include every copy a window
+// transaction made, since nothing the protocol published is freed
+
+#define MEMORY_TREE_KEYS 250000
+
+uint64_t allocated_bytes;
+
+// MallocAlloc with a running count of its bytes
+struct CountingAlloc
+{
+    static void *Allocate(size_t bytes, size_t alignment)
+    {
+        __atomic_fetch_add(&allocated_bytes, bytes, __ATOMIC_RELAXED);
+        return MallocAlloc::Allocate(bytes, alignment);
+    }
+
+    static void Free(void *memory, size_t bytes, size_t alignment)
+    {
+        __atomic_fetch_sub(&allocated_bytes, bytes, __ATOMIC_RELAXED);
+        MallocAlloc::Free(memory, bytes, alignment);
+    }
+};
+
+typedef ConcurrentTree<uint64_t, uint64_t, std::less<uint64_t>, CountingAlloc> Tree;
+typedef DataNode<uint64_t, uint64_t> Node;
+
+// bytes reachable from the node; keys counts the keys found on the way
+uint64_t reachable_bytes(Node *dNode, uint64_t *keys)
+{
+    if(dNode == nullptr) {
+        return 0;
+    }
+
+    uint64_t bytes = sizeof(Node);
+
+    if(dNode->isLeaf()) {
+        if(dNode->mBucket != nullptr) {
+            bytes += LeafBucket<uint64_t, uint64_t>::Bytes(dNode->mBucket->mCapacity);
+            bytes += dNode->mBucket->mCount * sizeof(ValueRecord<uint64_t>);
+            *keys += dNode->mBucket->mCount;
+        }
+        else if(!dNode->Sentinel()) {
+            *keys += 1;
+        }
+        return bytes;
+    }
+
+    return bytes + reachable_bytes(dNode->mLeft.unpack(), keys) + reachable_bytes(dNode->mRight.unpack(), keys);
+}
+
+void run(uint32_t bucketSize, const std::vector<uint64_t> &order)
+{
+    __atomic_store_n(&allocated_bytes, 0, __ATOMIC_RELAXED);
+    Tree *tree = new Tree(1, std::less<uint64_t>(), bucketSize);
+
+    uint64 time_start = GetTimeMs64();
+    for(uint64_t key : order) {
+        tree->InsertOrUpdate(key, key, 0);
+    }
+    uint64 elapsed = GetTimeMs64() - time_start;
+
+    uint64_t found = 0;
+    for(uint64_t key : order) {
+        uint64_t *value = tree->Search(key, 0);
+        found += value != nullptr && *value == key;
+    }
+
+    uint64_t keys = 0;
+    uint64_t reachable = reachable_bytes(tree->pRoot->unpack(), &keys);
+
+    if(found != order.size() || keys != order.size()) {
+        std::cout << "bucket size " << bucketSize << ": " << found << " keys found and " << keys
+                  << " reachable of " << order.size() << std::endl;
+        exit(1);
+    }
+
+    std::cout << "bucket size " << bucketSize << ": " << (double) reachable / keys << " bytes per key reachable, "
+              << (double) __atomic_load_n(&allocated_bytes, __ATOMIC_RELAXED) / keys << " allocated while building, "
+              << elapsed * 1000000.0 / keys << " ns per insert" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t numKeys = argc > 1 ? strtoull(argv[1], nullptr, 10) : MEMORY_TREE_KEYS;
+    std::vector<uint64_t> order(numKeys);
+    unsigned seed = 1;
+
+    for(uint64_t i=0; i<numKeys; i++) {
+        order[i] = i;
+    }
+    for(uint64_t i=numKeys - 1; i>0; i--) {
+        std::swap(order[i], order[rand_r(&seed) % (i + 1)]);
+    }
+
+    std::cout << "sizeof(DataNode) = " << sizeof(Node) << ", " << numKeys << " keys inserted in random order" << std::endl;
+
+    run(0, order);
+    run(MIN_LEAF_BUCKET_SIZE, order);
+    run(16, order);
+    run(MAX_LEAF_BUCKET_SIZE, order);
+}
@@ -0,0 +1,58 @@
+#include "tree_engine.hpp"
+#include "bench_policies.h"
+
+// runs the workload of bench_policies.h on each engine, the window-transaction
+// ConcurrentTree, the lock-free external BST and the lock-free skip list, for a
+// few search/insert/delete mixes, so the engine can be picked per deployment
+// (see tree_engine.hpp). the skip list's range scans are timed on their own,
+// since it is the only engine that offers them
+
+#define SCAN_KEYS 100000
+#define SCAN_LENGTH 100
+#define SCANS 20000
+
+typedef ConcurrentTree<PolicyKey, std::string> WindowTree;
+typedef LockFreeBST<PolicyKey, std::string> ExternalBST;
+typedef LockFreeSkipList<PolicyKey, std::string> SkipList;
+
+void run_scans()
+{
+    SkipList *list = new SkipList(1);
+    char buffer[POLICY_KEY_LENGTH + 1];
+    unsigned int seed = time(NULL);
+
+    for(int i=0; i<SCAN_KEYS; i++) {
+        random_key(buffer, &seed);
+        list->InsertOrUpdate(PolicyKey(buffer), std::string(buffer), 0);
+    }
+
+    PolicyKey keys[SCAN_LENGTH];
+    std::string *values[SCAN_LENGTH];
+    PolicyKey high ("zzzzzzz");
+    uint64_t visited = 0;
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<SCANS; i++) {
+        random_key(buffer, &seed);
+        visited += list->RangeSearch(PolicyKey(buffer), high, keys, values, SCAN_LENGTH, 0);
+    }
+
+    uint64 time_elapsed = GetTimeMs64() - time_start;
+
+    std::cout << "LockFreeSkipList scans of " << SCAN_LENGTH << " keys: " << time_elapsed * 1000000.0 / SCANS
+              << " ns per scan, " << visited << " keys visited" << std::endl;
+}
+
+int main(void)
+{
+    const uint32_t mixes[][3] = {{90, 5, 5}, {50, 25, 25}, {0, 50, 50}};
+
+    for(const uint32_t *mix : mixes) {
+        run_engine_benchmark<WindowTree>("ConcurrentTree", mix[0], mix[1], mix[2]);
+        run_engine_benchmark<ExternalBST>("LockFreeBST", mix[0], mix[1], mix[2]);
+        run_engine_benchmark<SkipList>("LockFreeSkipList", mix[0], mix[1], mix[2]);
+    }
+
+    run_scans();
+}
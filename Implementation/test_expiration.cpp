@@ -0,0 +1,310 @@
+#include <iostream>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <sched.h>
+#include <unistd.h>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// a session store: every thread touches random sessions, which renews them, and
+// looks sessions up. once with a cleaner thread that keeps the deadlines in a
+// locked map and Deletes the sessions whose deadline passed, once with the ttl
+// writes of EnableExpiration and its background sweeper. writes whose ttl has
+// passed before they land must leave their keys absent, and keys must expire
+// on time across a wrap of the clock. then threads renew keys
+// just as they expire while another sweeps without pause: a write that renewed
+// the key must be read back, whether or not the sweep got to the key first
+
+#define SESSION_THREADS 4
+#define SESSION_KEYS 200000
+#define SESSION_OPS_PER_THREAD 200000
+// milliseconds a session lives after its last touch
+#define SESSION_TTL 50
+#define CLEANER_IDLE_MICROSECONDS 1000
+#define RENEW_THREADS 3
+#define RENEW_KEYS 64
+#define RENEW_ROUNDS 3000
+// ticks the clock runs before it wraps, as check_clock_wrap sets it
+#define WRAP_LEAD 100
+// keys written with a ttl of zero, half of them over a live record
+#define STALE_KEYS 1000
+// ticks a renewed key lives, far longer than the check that reads it back
+#define RENEW_TTL 100000
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct Deadlines
+{
+    std::mutex mLock;
+    std::map<uint64_t, uint64> mBySession;
+};
+
+struct SessionArgs
+{
+    Tree *mTree;
+    Deadlines *mDeadlines;
+    int mPid;
+};
+
+uint32_t cleaner_running;
+
+void *session_worker(void *args)
+{
+    SessionArgs *myArgs = (SessionArgs *) args;
+    Tree *tree = myArgs->mTree;
+    unsigned seed = myArgs->mPid + 1;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(int i=0; i<SESSION_OPS_PER_THREAD; i++) {
+        uint64_t session = (((uint64_t) rand_r(&seed) << 31) | rand_r(&seed)) % SESSION_KEYS;
+
+        if(i % 2 == 0) {
+            tree->Search(session, myArgs->mPid);
+        }
+        else if(myArgs->mDeadlines == nullptr) {
+            tree->InsertOrUpdate(session, session, SESSION_TTL, myArgs->mPid);
+        }
+        else {
+            tree->InsertOrUpdate(session, session, myArgs->mPid);
+            std::lock_guard<std::mutex> guard(myArgs->mDeadlines->mLock);
+            myArgs->mDeadlines->mBySession[session] = GetTimeMs64() + SESSION_TTL;
+        }
+    }
+
+    return nullptr;
+}
+
+// deletes the sessions whose deadline passed, one by one
+void *cleaner(void *args)
+{
+    SessionArgs *myArgs = (SessionArgs *) args;
+    Deadlines *deadlines = myArgs->mDeadlines;
+
+    myArgs->mTree->RegisterThread(myArgs->mPid);
+    while(__atomic_load_n(&cleaner_running, __ATOMIC_ACQUIRE) != 0) {
+        uint64 now = GetTimeMs64();
+        std::lock_guard<std::mutex> guard(deadlines->mLock);
+
+        for(auto it = deadlines->mBySession.begin(); it != deadlines->mBySession.end(); ) {
+            if(it->second <= now) {
+                myArgs->mTree->Delete(it->first, myArgs->mPid);
+                it = deadlines->mBySession.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        usleep(CLEANER_IDLE_MICROSECONDS);
+    }
+
+    return nullptr;
+}
+
+// live keys; expired ones still in the tree are removed by the pops but not counted
+uint64_t count_keys(Tree *tree)
+{
+    uint64_t key, value, count = 0;
+    while(tree->PopMin(&key, &value, 0)) {
+        count++;
+    }
+    return count;
+}
+
+void run(bool expiration)
+{
+    Tree *tree = new Tree(SESSION_THREADS + 1);
+    Deadlines *deadlines = expiration ? nullptr : new Deadlines();
+    pthread_t threads[SESSION_THREADS], cleanerThread;
+    SessionArgs args[SESSION_THREADS + 1];
+
+    if(expiration) {
+        tree->EnableExpiration();
+        tree->StartExpirationSweeper(SESSION_THREADS);
+    }
+    else {
+        args[SESSION_THREADS] = {tree, deadlines, SESSION_THREADS};
+        __atomic_store_n(&cleaner_running, 1, __ATOMIC_RELEASE);
+        pthread_create(&cleanerThread, NULL, cleaner, (void *) &args[SESSION_THREADS]);
+    }
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<SESSION_THREADS; i++) {
+        args[i] = {tree, deadlines, i};
+        pthread_create(&threads[i], NULL, session_worker, (void *) &args[i]);
+    }
+
+    for(int i=0; i<SESSION_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64 elapsed = GetTimeMs64() - time_start;
+
+    // the sessions touched last are still alive; give the cleanup two ttls to catch up
+    usleep(SESSION_TTL * 2000);
+    if(expiration) {
+        tree->StopExpirationSweeper();
+    }
+    else {
+        __atomic_store_n(&cleaner_running, 0, __ATOMIC_RELEASE);
+        pthread_join(cleanerThread, NULL);
+    }
+
+    uint64_t ops = (uint64_t) SESSION_THREADS * SESSION_OPS_PER_THREAD;
+    std::cout << (expiration ? "ttl writes, lazy removal and sweeper" : "cleaner thread deleting expired keys") << ": "
+              << ops * 1000.0 / (elapsed != 0 ? elapsed : 1) << " ops per second";
+
+    if(expiration) {
+        ExpirationCounters counters = tree->GetExpirationCounters();
+        std::cout << ", " << counters.mLazyRemovals << " removed by traffic, " << counters.mSweptRemovals
+                  << " by " << counters.mSweeps << " sweeps";
+    }
+
+    std::cout << ", " << count_keys(tree) << " keys left" << std::endl;
+}
+
+// a write whose ttl has passed by the time it lands leaves the key absent and
+// returns, whether the key was absent or held a live record
+void check_stale_writes()
+{
+    Tree *tree = new Tree(1);
+    tree->EnableExpiration();
+    uint64_t errors = 0;
+
+    for(uint64_t key=0; key<STALE_KEYS; key++) {
+        if(key % 2 == 0) {
+            tree->InsertOrUpdate(key, key, SESSION_TTL, 0);
+        }
+        tree->InsertOrUpdate(key, key + 1, 0, 0);
+        errors += tree->Search(key, 0) != nullptr;
+    }
+
+    std::cout << "writes with a ttl already passed: " << errors << " keys left present" << std::endl;
+
+    if(errors != 0) {
+        exit(1);
+    }
+}
+
+// the clock is set WRAP_LEAD ticks short of wrapping. a key written to expire
+// before the wrap must be gone after it and one written to expire after it must
+// live until then, and the clock must never read as a reserved stamp meanwhile
+void check_clock_wrap()
+{
+    Tree *tree = new Tree(1);
+    tree->EnableExpiration();
+    Expiration *expiration = tree->mExpiration;
+    expiration->mEpoch = Expiration::Nanoseconds() -
+                         ((uint64_t) UINT32_MAX + 1 - EXPIRATION_FIRST_TICK - WRAP_LEAD) * EXPIRATION_TICK_NANOSECONDS;
+
+    tree->InsertOrUpdate(0, 0, WRAP_LEAD / 2, 0);
+    tree->InsertOrUpdate(1, 1, WRAP_LEAD * 2, 0);
+    uint64_t errors = tree->Search(1, 0) == nullptr;
+
+    // read the clock across the wrap, then look half a lead past it
+    uint64 until = GetTimeMs64() + WRAP_LEAD * 3 / 2;
+    while(GetTimeMs64() < until) {
+        errors += expiration->Now() < EXPIRATION_FIRST_TICK;
+    }
+    errors += tree->Search(0, 0) != nullptr || tree->Search(1, 0) == nullptr;
+
+    usleep(WRAP_LEAD * 1500);
+    errors += tree->Search(1, 0) != nullptr;
+
+    std::cout << "clock wrap: " << errors << " wrong results" << std::endl;
+
+    if(errors != 0) {
+        exit(1);
+    }
+}
+
+struct RenewArgs
+{
+    Tree *mTree;
+    int mPid;
+    uint64_t mErrors;
+    bool *mDone;
+};
+
+// writes each of its keys with a ttl of one tick, waits until about when it
+// expires and renews it with a long one
+void *renew_worker(void *args)
+{
+    RenewArgs *myArgs = (RenewArgs *) args;
+    Tree *tree = myArgs->mTree;
+    unsigned seed = myArgs->mPid + 1;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(uint64_t round=1; round<=RENEW_ROUNDS; round++) {
+        uint64_t key = (uint64_t) rand_r(&seed) % RENEW_KEYS * RENEW_THREADS + myArgs->mPid;
+        uint32_t expires = tree->mExpiration->Now() + 1;
+
+        tree->InsertOrUpdate(key, round, 1, myArgs->mPid);
+        while((int32_t) (tree->mExpiration->Now() - expires) < 0 && rand_r(&seed) % 8 != 0) {
+            sched_yield();
+        }
+
+        tree->InsertOrUpdate(key, round + 1, RENEW_TTL, myArgs->mPid);
+        uint64_t *value = tree->Search(key, myArgs->mPid);
+        if(value == nullptr || *value != round + 1) {
+            myArgs->mErrors++;
+        }
+    }
+
+    return nullptr;
+}
+
+void *renew_sweeper(void *args)
+{
+    RenewArgs *myArgs = (RenewArgs *) args;
+
+    myArgs->mTree->RegisterThread(myArgs->mPid);
+    while(!__atomic_load_n(myArgs->mDone, __ATOMIC_ACQUIRE)) {
+        myArgs->mTree->Sweep(myArgs->mPid);
+        sched_yield();
+    }
+
+    return nullptr;
+}
+
+void run_renewals()
+{
+    Tree *tree = new Tree(RENEW_THREADS + 1);
+    tree->EnableExpiration();
+
+    bool done = false;
+    pthread_t threads[RENEW_THREADS + 1];
+    RenewArgs args[RENEW_THREADS + 1];
+    uint64_t errors = 0;
+
+    for(int i=0; i<=RENEW_THREADS; i++) {
+        args[i] = {tree, i, 0, &done};
+        pthread_create(&threads[i], NULL, i == RENEW_THREADS ? renew_sweeper : renew_worker, (void *) &args[i]);
+    }
+    for(int i=0; i<RENEW_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].mErrors;
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    pthread_join(threads[RENEW_THREADS], NULL);
+
+    ExpirationCounters counters = tree->GetExpirationCounters();
+    std::cout << "renewals racing a sweep: " << (uint64_t) RENEW_THREADS * RENEW_ROUNDS << " renewals, "
+              << counters.mSweptRemovals << " keys swept, " << errors << " renewed keys lost" << std::endl;
+
+    if(errors != 0) {
+        exit(1);
+    }
+}
+
+int main(void)
+{
+    run(false);
+    run(true);
+    check_stale_writes();
+    check_clock_wrap();
+    run_renewals();
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+#include "bench_tree.h"
+
+// lookups through Search on a balanced tree with and without the per-thread
+// fingers of EnableFingers: a pass in ascending key order, where nearly every
+// lookup can start from the finger, and one in random order, where few can.
+// then keys are deleted and re-inserted near the keys being looked up, which
+// replaces the nodes fingers point into, while every lookup is checked against
+// a model
+
+#define TREE_KEYS 1000000
+#define LOOKUPS   1000000
+#define CHURN_OPS 200000
+// the churn looks up and changes keys within this distance of a moving cursor
+#define CHURN_WINDOW 64
+
+double time_lookups(Tree *tree, const uint64_t *probes, uint64_t *found)
+{
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<LOOKUPS; i++) {
+        *found += tree->Search(probes[i], 0) != nullptr;
+    }
+
+    return (GetTimeMs64() - time_start) * 1000000.0 / LOOKUPS;
+}
+
+void run(uint64_t numKeys, bool fingers)
+{
+    Tree *tree = build_tree(numKeys, 0);
+    if(fingers) {
+        tree->EnableFingers();
+    }
+
+    uint64_t *ascending = (uint64_t *) malloc(LOOKUPS * sizeof(uint64_t));
+    uint64_t *random = (uint64_t *) malloc(LOOKUPS * sizeof(uint64_t));
+    for(int i=0; i<LOOKUPS; i++) {
+        ascending[i] = (uint64_t) i * numKeys / LOOKUPS;
+        random[i] = (((uint64_t) rand() << 31) | rand()) % numKeys;
+    }
+
+    uint64_t found = 0;
+    FingerCounters before = {0, 0};
+
+    std::cout << numKeys << " keys, " << (fingers ? "fingers" : "from the root") << std::endl;
+
+    double ns = time_lookups(tree, ascending, &found);
+    std::cout << "  ns per ascending lookup: " << ns;
+    if(fingers) {
+        FingerCounters after = tree->GetFingerCounters();
+        std::cout << ", " << 100.0 * (after.mHits - before.mHits) / (after.mHits + after.mMisses - before.mHits - before.mMisses)
+                  << "% started from the finger";
+        before = after;
+    }
+    std::cout << std::endl;
+
+    ns = time_lookups(tree, random, &found);
+    std::cout << "  ns per random lookup:    " << ns;
+    if(fingers) {
+        FingerCounters after = tree->GetFingerCounters();
+        std::cout << ", " << 100.0 * (after.mHits - before.mHits) / (after.mHits + after.mMisses - before.mHits - before.mMisses)
+                  << "% started from the finger";
+    }
+    std::cout << std::endl;
+
+    if(found != 2 * LOOKUPS) {
+        std::cout << "  " << found << "/" << 2 * LOOKUPS << " found" << std::endl;
+        exit(1);
+    }
+
+    // the cursor moves up through the keys; changes and lookups stay close to it,
+    // so the nodes replaced are the ones the finger leads into
+    std::vector<bool> present(numKeys, true);
+    unsigned seed = 1;
+
+    for(int i=0; i<CHURN_OPS; i++) {
+        uint64_t cursor = (uint64_t) i * (numKeys - CHURN_WINDOW) / CHURN_OPS;
+        uint64_t key = cursor + rand_r(&seed) % CHURN_WINDOW;
+        uint64_t probe = cursor + rand_r(&seed) % CHURN_WINDOW;
+
+        if(present[key]) {
+            tree->Delete(key, 0);
+        }
+        else {
+            tree->InsertOrUpdate(key, bench_value, 0);
+        }
+        present[key] = !present[key];
+
+        if((tree->Search(key, 0) != nullptr) != present[key] || (tree->Search(probe, 0) != nullptr) != present[probe]) {
+            std::cout << "  lookup disagrees with the model after " << i << " changes" << std::endl;
+            exit(1);
+        }
+    }
+
+    std::cout << "  " << CHURN_OPS << " nearby deletes and inserts checked against a model";
+    if(fingers) {
+        FingerCounters counters = tree->GetFingerCounters();
+        std::cout << ", finger hits " << counters.mHits << ", misses " << counters.mMisses;
+    }
+    std::cout << std::endl;
+
+    free(ascending);
+    free(random);
+}
+
+int main(int argc, char **argv)
+{
+    srand(time(NULL));
+
+    // the key count can be overridden on the command line, e.g. ./test_fingers 4000000
+    uint64_t numKeys = argc > 1 ? strtoull(argv[1], nullptr, 10) : TREE_KEYS;
+
+    run(numKeys, false);
+    run(numKeys, true);
+}
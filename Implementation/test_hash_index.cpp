@@ -0,0 +1,85 @@
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+#include "bench_tree.h"
+
+// point lookups through Search on a balanced tree, once with the traversal only
+// and once with the hash index of EnableHashIndex (hash_index.hpp) in front of it.
+// the index is filled by a warm-up pass, since a key is published the first time
+// a traversal finds it
+
+#define TREE_KEYS 4000000
+#define LOOKUPS   1000000
+
+void run(uint64_t numKeys, bool hashIndex)
+{
+    Tree *tree = build_tree(numKeys, 0);
+    if(hashIndex) {
+        tree->EnableHashIndex(numKeys);
+    }
+
+    uint64_t *probes = (uint64_t *) malloc(LOOKUPS * sizeof(uint64_t));
+    for(int i=0; i<LOOKUPS; i++) {
+        probes[i] = (((uint64_t) rand() << 31) | rand()) % numKeys;
+    }
+
+    for(uint64_t key=0; key<numKeys; key++) {
+        tree->Search(key, 0);
+    }
+
+    int counter = open_cache_miss_counter();
+    uint64_t found = 0;
+
+    if(counter != -1) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<LOOKUPS; i++) {
+        found += tree->Search(probes[i], 0) != nullptr;
+    }
+
+    uint64 time_end = GetTimeMs64();
+
+    long long misses = -1;
+    if(counter != -1) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(counter, &misses, sizeof(misses)) != sizeof(misses)) {
+            misses = -1;
+        }
+        close(counter);
+    }
+
+    std::cout << numKeys << " keys, " << (hashIndex ? "hash index" : "tree only") << ", " << found << "/" << LOOKUPS << " found" << std::endl;
+    std::cout << "  ns per lookup:          " << (time_end - time_start) * 1000000.0 / LOOKUPS << std::endl;
+
+    if(misses != -1) {
+        std::cout << "  cache misses per lookup: " << (double) misses / LOOKUPS << std::endl;
+    }
+    else {
+        std::cout << "  cache misses per lookup: unavailable (perf_event_open failed)" << std::endl;
+    }
+
+    if(hashIndex) {
+        HashIndexCounters counters = tree->GetHashIndexCounters();
+        std::cout << "  index hits " << counters.mHits << ", misses " << counters.mMisses
+                  << ", resizes " << counters.mResizes << std::endl;
+    }
+
+    free(probes);
+}
+
+int main(int argc, char **argv)
+{
+    srand(time(NULL));
+
+    // the key count can be overridden on the command line, e.g. ./test_hash_index 1000000
+    uint64_t numKeys = argc > 1 ? strtoull(argv[1], nullptr, 10) : TREE_KEYS;
+
+    run(numKeys, false);
+    run(numKeys, true);
+}
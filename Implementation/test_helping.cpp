@@ -0,0 +1,120 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// a mixed workload under each mode of SetHelpingPolicy (helping_policy.hpp).
+// every thread inserts and deletes only keys it owns and keeps a model of them,
+// so it can check its own reads and the final tree, while its lookups range over
+// all keys. reports throughput and how often each mode helped or skipped
+
+#define HELPING_THREADS 4
+#define HELPING_KEYS 100000
+#define HELPING_OPS_PER_THREAD 50000
+// k of HELP_EVERY_KTH and HELP_AGED
+#define HELPING_PARAMETER 4
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct HelpingArgs
+{
+    Tree *mTree;
+    int mPid;
+    // which of the keys this thread owns are present
+    std::vector<bool> *mPresent;
+    uint64_t mErrors;
+};
+
+void *helping_worker(void *args)
+{
+    HelpingArgs *myArgs = (HelpingArgs *) args;
+    Tree *tree = myArgs->mTree;
+    std::vector<bool> &present = *myArgs->mPresent;
+    unsigned seed = myArgs->mPid + 1;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(int i=0; i<HELPING_OPS_PER_THREAD; i++) {
+        uint64_t key = (((uint64_t) rand_r(&seed) << 31) | rand_r(&seed)) % HELPING_KEYS;
+        uint32_t op = rand_r(&seed) % 4;
+
+        if(op < 2) {
+            // a key another thread owns only has to carry its own value if present
+            uint64_t *value = tree->Search(key, myArgs->mPid);
+            bool mine = key % HELPING_THREADS == (uint64_t) myArgs->mPid;
+            if(value != nullptr ? *value != key : mine && present[key / HELPING_THREADS]) {
+                myArgs->mErrors++;
+            }
+            continue;
+        }
+
+        // the owned key nearest to the random one
+        key = key - key % HELPING_THREADS + myArgs->mPid;
+        if(key >= HELPING_KEYS) {
+            continue;
+        }
+
+        if(op == 2) {
+            tree->InsertOrUpdate(key, key, myArgs->mPid);
+            present[key / HELPING_THREADS] = true;
+        }
+        else {
+            tree->Delete(key, myArgs->mPid);
+            present[key / HELPING_THREADS] = false;
+        }
+    }
+
+    return nullptr;
+}
+
+void run(HelpingMode mode, const char *name)
+{
+    Tree *tree = new Tree(HELPING_THREADS);
+    tree->SetHelpingPolicy(mode, HELPING_PARAMETER);
+
+    pthread_t threads[HELPING_THREADS];
+    HelpingArgs args[HELPING_THREADS];
+    std::vector<bool> present[HELPING_THREADS];
+    uint64_t errors = 0;
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<HELPING_THREADS; i++) {
+        present[i].assign(HELPING_KEYS / HELPING_THREADS + 1, false);
+        args[i] = {tree, i, &present[i], 0};
+        pthread_create(&threads[i], NULL, helping_worker, (void *) &args[i]);
+    }
+    for(int i=0; i<HELPING_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].mErrors;
+    }
+
+    uint64 elapsed = GetTimeMs64() - time_start;
+
+    // the tree ends up holding exactly the keys the models say are present
+    for(uint64_t key=0; key<HELPING_KEYS; key++) {
+        bool expected = present[key % HELPING_THREADS][key / HELPING_THREADS];
+        errors += (tree->Search(key, 0) != nullptr) != expected;
+    }
+
+    HelpingCounters counters = tree->GetHelpingCounters();
+    uint64_t ops = (uint64_t) HELPING_THREADS * HELPING_OPS_PER_THREAD;
+
+    std::cout << name << ": " << ops * 1000.0 / (elapsed != 0 ? elapsed : 1) << " ops per second, "
+              << counters.mChecks << " chances to help, " << counters.mSearchHelps << " searches and "
+              << counters.mModifyHelps << " modifications helped, " << counters.mSkipped << " skipped, "
+              << errors << " wrong results" << std::endl;
+
+    if(errors != 0) {
+        exit(1);
+    }
+}
+
+int main(void)
+{
+    run(HELP_ALWAYS, "HELP_ALWAYS");
+    run(HELP_EVERY_KTH, "HELP_EVERY_KTH");
+    run(HELP_PENDING, "HELP_PENDING");
+    run(HELP_AGED, "HELP_AGED");
+}
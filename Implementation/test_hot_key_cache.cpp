@@ -0,0 +1,156 @@
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// skewed lookups through Search, once with the traversal only and once with the
+// hot-key cache of EnableHotKeyCache (hot_key_cache.hpp) in front of it. then
+// threads delete and re-insert the hot keys they own while all of them read: a
+// value read must belong to its key, and a thread must see its own writes at
+// once, which a cache entry left over from before a delete would break
+
+#define CACHE_THREADS 4
+#define CACHE_TREE_KEYS 100000
+// the hot keys are 0 .. HOT_KEYS-1 and take HOT_PERCENT of the lookups
+#define HOT_KEYS 1000
+#define HOT_PERCENT 90
+#define CACHE_SETS 1024
+#define LOOKUPS 1000000
+#define CHURN_OPS_PER_THREAD 100000
+// one churn operation in this many writes a hot key
+#define CHURN_WRITE_EVERY 8
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct CacheArgs
+{
+    Tree *mTree;
+    int mPid;
+    uint64_t mErrors;
+};
+
+uint64_t skewed_key(unsigned *seed)
+{
+    uint64_t random = ((uint64_t) rand_r(seed) << 31) | rand_r(seed);
+    return (uint64_t) rand_r(seed) % 100 < HOT_PERCENT ? random % HOT_KEYS : random % CACHE_TREE_KEYS;
+}
+
+// the values of a key are the key plus multiples of CACHE_TREE_KEYS
+void *churn_worker(void *args)
+{
+    CacheArgs *myArgs = (CacheArgs *) args;
+    Tree *tree = myArgs->mTree;
+    unsigned seed = myArgs->mPid + 1;
+    uint64_t version = 0;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(int i=0; i<CHURN_OPS_PER_THREAD; i++) {
+        if(i % CHURN_WRITE_EVERY == 0) {
+            // a hot key this thread owns
+            uint64_t key = ((uint64_t) rand_r(&seed) % (HOT_KEYS / CACHE_THREADS)) * CACHE_THREADS + myArgs->mPid;
+            uint64_t value = key + (++version) * CACHE_TREE_KEYS;
+
+            tree->Delete(key, myArgs->mPid);
+            if(tree->Search(key, myArgs->mPid) != nullptr) {
+                myArgs->mErrors++;
+            }
+
+            tree->InsertOrUpdate(key, value, myArgs->mPid);
+            uint64_t *found = tree->Search(key, myArgs->mPid);
+            if(found == nullptr || *found != value) {
+                myArgs->mErrors++;
+            }
+        }
+        else {
+            // another owner's key may be between its delete and its insert
+            uint64_t key = skewed_key(&seed);
+            uint64_t *found = tree->Search(key, myArgs->mPid);
+            if(found != nullptr ? *found % CACHE_TREE_KEYS != key : key >= HOT_KEYS) {
+                myArgs->mErrors++;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void run(bool cache)
+{
+    Tree *tree = new Tree(CACHE_THREADS);
+    unsigned seed = 1;
+
+    // random insertion order, since the tree is not rebalanced by default
+    uint64_t *order = (uint64_t *) malloc(CACHE_TREE_KEYS * sizeof(uint64_t));
+    for(uint64_t i=0; i<CACHE_TREE_KEYS; i++) {
+        order[i] = i;
+    }
+    for(uint64_t i=CACHE_TREE_KEYS - 1; i>0; i--) {
+        std::swap(order[i], order[rand_r(&seed) % (i + 1)]);
+    }
+    for(uint64_t i=0; i<CACHE_TREE_KEYS; i++) {
+        tree->InsertOrUpdate(order[i], order[i], 0);
+    }
+
+    if(cache) {
+        tree->EnableHotKeyCache(CACHE_SETS);
+    }
+
+    uint64_t found = 0;
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<LOOKUPS; i++) {
+        uint64_t key = skewed_key(&seed);
+        uint64_t *value = tree->Search(key, 0);
+        found += value != nullptr && *value == key;
+    }
+
+    uint64 time_end = GetTimeMs64();
+
+    std::cout << CACHE_TREE_KEYS << " keys, " << HOT_PERCENT << "% of lookups on " << HOT_KEYS << ", "
+              << (cache ? "hot-key cache" : "tree only") << ", " << found << "/" << LOOKUPS << " found" << std::endl;
+    std::cout << "  ns per lookup:          " << (time_end - time_start) * 1000000.0 / LOOKUPS << std::endl;
+
+    if(found != LOOKUPS) {
+        exit(1);
+    }
+
+    if(cache) {
+        HotKeyCounters counters = tree->GetHotKeyCacheCounters();
+        std::cout << "  hits " << counters.mHits << ", misses " << counters.mMisses << " ("
+                  << 100.0 * counters.mHits / (counters.mHits + counters.mMisses) << "% hit rate), fills "
+                  << counters.mFills << std::endl;
+    }
+
+    pthread_t threads[CACHE_THREADS];
+    CacheArgs args[CACHE_THREADS];
+    uint64_t errors = 0;
+
+    for(int i=0; i<CACHE_THREADS; i++) {
+        args[i] = {tree, i, 0};
+        pthread_create(&threads[i], NULL, churn_worker, (void *) &args[i]);
+    }
+    for(int i=0; i<CACHE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].mErrors;
+    }
+
+    std::cout << "  " << CACHE_THREADS << " threads deleting and re-inserting hot keys: " << errors << " wrong reads";
+    if(cache) {
+        HotKeyCounters counters = tree->GetHotKeyCacheCounters();
+        std::cout << ", " << counters.mInvalidations << " invalidations, hits " << counters.mHits;
+    }
+    std::cout << std::endl;
+
+    if(errors != 0) {
+        exit(1);
+    }
+
+    free(order);
+}
+
+int main(void)
+{
+    run(false);
+    run(true);
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+#include "bench_tree.h"
+
+// microbenchmark for the data node layout: builds a balanced external tree
+// directly (no window transactions) and reports cache misses per lookup. larger
+// trees are opt-in on the command line and skipped if they would not fit in memory
+
+#define SMALL_TREE_KEYS 1000000
+#define LOOKUPS         1000000
+#define LEAF_BUCKET_SIZE 16
+
+// a tree of one-key leaves has an internal node and a leaf per key; buckets need less
+bool fits_in_memory(uint64_t numKeys)
+{
+    uint64_t needed = numKeys * 2 * sizeof(DataNode<uint64_t, uint64_t>) + LOOKUPS * sizeof(uint64_t);
+    uint64_t available = (uint64_t) sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+
+    if(needed > available) {
+        std::cout << numKeys << " keys: skipped, the tree needs " << needed / (1 << 20) << " MB and "
+                  << available / (1 << 20) << " MB are free" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void run(uint64_t numKeys, uint32_t bucketSize)
+{
+    Tree *tree = build_tree(numKeys, bucketSize);
+
+    uint64_t *probes = (uint64_t *) malloc(LOOKUPS * sizeof(uint64_t));
+    for(int i=0; i<LOOKUPS; i++) {
+        probes[i] = (((uint64_t) rand() << 31) | rand()) % numKeys;
+    }
+
+    int counter = open_cache_miss_counter();
+    uint64_t found = 0;
+
+    if(counter != -1) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<LOOKUPS; i++) {
+        DataNode<uint64_t, uint64_t> *dLeaf = tree->FindLeaf(probes[i], nullptr);
+        if(dLeaf->mBucket != nullptr) {
+            found += dLeaf->mBucket->Find(probes[i], tree->mCompare) != -1;
+        }
+        else {
+            found += dLeaf->mKey == probes[i];
+        }
+    }
+
+    uint64 time_end = GetTimeMs64();
+
+    long long misses = -1;
+    if(counter != -1) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(counter, &misses, sizeof(misses)) != sizeof(misses)) {
+            misses = -1;
+        }
+        close(counter);
+    }
+
+    std::cout << numKeys << " keys, bucket size " << bucketSize << ", " << found << "/" << LOOKUPS << " found" << std::endl;
+    std::cout << "  ns per lookup:          " << (time_end - time_start) * 1000000.0 / LOOKUPS << std::endl;
+
+    if(misses != -1) {
+        std::cout << "  cache misses per lookup: " << (double) misses / LOOKUPS << std::endl;
+    }
+    else {
+        std::cout << "  cache misses per lookup: unavailable (perf_event_open failed)" << std::endl;
+    }
+
+    free(probes);
+}
+
+int main(int argc, char **argv)
+{
+    srand(time(NULL));
+
+    std::cout << "sizeof(DataNode) = " << sizeof(DataNode<uint64_t, uint64_t>) << std::endl;
+
+    // key counts can be given on the command line, e.g. ./test_layout 1000000 100000000
+    if(argc > 1) {
+        for(int i=1; i<argc; i++) {
+            uint64_t numKeys = strtoull(argv[i], nullptr, 10);
+            if(fits_in_memory(numKeys)) {
+                run(numKeys, 0);
+                run(numKeys, LEAF_BUCKET_SIZE);
+            }
+        }
+    }
+    else {
+        run(SMALL_TREE_KEYS, 0);
+        run(SMALL_TREE_KEYS, LEAF_BUCKET_SIZE);
+    }
+}
@@ -16,10 +16,10 @@ pthread_mutex_t outputStream;
 template <class V>
 struct ArgsStruct
 {
-    ConcurrentTree<V> *mTree;
+    ConcurrentTree<uint32_t, V> *mTree;
     int mPid;
 
-    ArgsStruct(ConcurrentTree<V> *tree, int pid)
+    ArgsStruct(ConcurrentTree<uint32_t, V> *tree, int pid)
     {
         mTree = tree;
         mPid = pid;
@@ -76,7 +76,7 @@ int main(void)
 
     pthread_mutex_init(&outputStream, NULL);
 
-    ConcurrentTree<std::string> *tree = new ConcurrentTree<std::string>(NUM_THREADS);
+    ConcurrentTree<uint32_t, std::string> *tree = new ConcurrentTree<uint32_t, std::string>(NUM_THREADS);
 
     for(int i = 0; i < NUM_INSERT_THREADS; i++) {
         pthread_create(&threads[i], NULL, inserter<std::string>, (void*) new ArgsStruct<std::string>(tree, i));
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+#include "bench_tree.h"
+
+// compares MultiSearch against looping over Search for batches of keys. every
+// result of MultiSearch must be the record Search found for the same key, and
+// every key of the tree is present with the value build_tree stored
+
+#define TREE_KEYS   1000000
+#define LOOKUPS     1000000
+
+int main(int argc, char **argv)
+{
+    srand(time(NULL));
+
+    uint64_t numKeys = argc > 1 ? strtoull(argv[1], nullptr, 10) : TREE_KEYS;
+    Tree *tree = build_tree(numKeys, 0);
+
+    uint64_t *probes = (uint64_t *) malloc(LOOKUPS * sizeof(uint64_t));
+    uint64_t **serial = (uint64_t **) malloc(LOOKUPS * sizeof(uint64_t *));
+    uint64_t **values = (uint64_t **) malloc(LOOKUPS * sizeof(uint64_t *));
+    for(int i=0; i<LOOKUPS; i++) {
+        probes[i] = (((uint64_t) rand() << 31) | rand()) % numKeys;
+    }
+
+    int batchSizes[] = {1, 8, 32};
+
+    for(int batchSize : batchSizes) {
+        // no result of an earlier batch size can pass for one of this one
+        memset(serial, 0, LOOKUPS * sizeof(uint64_t *));
+        memset(values, 0, LOOKUPS * sizeof(uint64_t *));
+
+        uint64 time_start = GetTimeMs64();
+
+        for(int i=0; i + batchSize <= LOOKUPS; i += batchSize) {
+            for(int j=0; j<batchSize; j++) {
+                serial[i + j] = tree->Search(probes[i + j], 0);
+            }
+        }
+
+        uint64 time_serial = GetTimeMs64() - time_start;
+        time_start = GetTimeMs64();
+
+        for(int i=0; i + batchSize <= LOOKUPS; i += batchSize) {
+            tree->MultiSearch(&probes[i], &values[i], batchSize, 0);
+        }
+
+        uint64 time_batched = GetTimeMs64() - time_start;
+
+        // a final partial batch is not timed or checked
+        uint64_t checked = LOOKUPS - LOOKUPS % batchSize;
+        uint64_t found = 0, errors = 0;
+        for(uint64_t i=0; i<checked; i++) {
+            found += values[i] != nullptr;
+            errors += values[i] != serial[i] || values[i] == nullptr || *values[i] != bench_value;
+        }
+
+        std::cout << "batch " << batchSize << ": " << found << "/" << checked << " found, " << errors
+                  << " results different from Search" << std::endl;
+        std::cout << "  Search loop ns per key: " << time_serial * 1000000.0 / LOOKUPS << std::endl;
+        std::cout << "  MultiSearch ns per key: " << time_batched * 1000000.0 / LOOKUPS << std::endl;
+
+        if(errors != 0) {
+            exit(1);
+        }
+    }
+
+    free(values);
+    free(serial);
+    free(probes);
+}
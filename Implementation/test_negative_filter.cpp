@@ -0,0 +1,156 @@
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// lookups of absent keys with and without the negative filter of EnableNegativeFilter
+// (negative_filter.hpp). the filter is sized for a small fraction of the keys, so it
+// grows several times while threads insert overlapping ranges; afterwards the keys
+// it counts must equal the keys in the tree, before and after half are deleted, and
+// the share of absent lookups it lets through is the false-positive rate
+
+#define FILTER_THREADS 4
+#define FILTER_KEYS 200000
+// capacity the filter starts with
+#define FILTER_EXPECTED_KEYS 4096
+#define ABSENT_LOOKUPS 1000000
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct FilterArgs
+{
+    Tree *mTree;
+    int mPid;
+    bool mDelete;
+};
+
+// the keys in random order, since the tree is not rebalanced by default
+uint64_t *key_order;
+
+// every thread writes every key, starting at its own offset, so most keys are
+// inserted by one thread while others race to insert or delete them as well
+void *filter_worker(void *args)
+{
+    FilterArgs *myArgs = (FilterArgs *) args;
+    uint64_t offset = (uint64_t) myArgs->mPid * FILTER_KEYS / FILTER_THREADS;
+
+    myArgs->mTree->RegisterThread(myArgs->mPid);
+    for(uint64_t i=0; i<FILTER_KEYS; i++) {
+        uint64_t key = key_order[(offset + i) % FILTER_KEYS];
+
+        if(!myArgs->mDelete) {
+            myArgs->mTree->InsertOrUpdate(key, key, myArgs->mPid);
+        }
+        else if(key % 2 == 1) {
+            myArgs->mTree->Delete(key, myArgs->mPid);
+        }
+    }
+
+    return nullptr;
+}
+
+void run_workers(Tree *tree, bool deletes)
+{
+    pthread_t threads[FILTER_THREADS];
+    FilterArgs args[FILTER_THREADS];
+
+    for(int i=0; i<FILTER_THREADS; i++) {
+        args[i] = {tree, i, deletes};
+        pthread_create(&threads[i], NULL, filter_worker, (void *) &args[i]);
+    }
+    for(int i=0; i<FILTER_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// exits if the filter does not count exactly the keys the tree holds
+void check_population(Tree *tree, uint64_t expected, const char *phase)
+{
+    uint64_t counted;
+    uint32_t generations = tree->mNegativeFilter->Generations(&counted);
+    FilterCounters counters = tree->GetNegativeFilterCounters();
+
+    std::cout << "  after " << phase << ": " << counted << " keys counted in " << generations
+              << " generations, " << counters.mGrowths << " growths moved " << counters.mMoved << " keys" << std::endl;
+
+    if(counted != expected) {
+        std::cout << "  expected " << expected << " counted keys" << std::endl;
+        exit(1);
+    }
+}
+
+void run(bool filter)
+{
+    Tree *tree = new Tree(FILTER_THREADS);
+    if(filter) {
+        tree->EnableNegativeFilter(FILTER_EXPECTED_KEYS);
+    }
+
+    std::cout << (filter ? "negative filter" : "tree only") << ", " << FILTER_KEYS << " keys" << std::endl;
+
+    run_workers(tree, false);
+    if(filter) {
+        check_population(tree, FILTER_KEYS, "inserts");
+    }
+
+    run_workers(tree, true);
+    if(filter) {
+        check_population(tree, FILTER_KEYS / 2, "deletes");
+    }
+
+    // the even keys stayed, the odd ones are gone
+    for(uint64_t key=0; key<FILTER_KEYS; key++) {
+        uint64_t *value = tree->Search(key, 0);
+        if((key % 2 == 0) != (value != nullptr && *value == key)) {
+            std::cout << "  key " << key << (key % 2 == 0 ? " lost" : " not deleted") << std::endl;
+            exit(1);
+        }
+    }
+
+    FilterCounters before = filter ? tree->GetNegativeFilterCounters() : FilterCounters();
+    uint64_t found = 0;
+    unsigned seed = 1;
+
+    uint64 time_start = GetTimeMs64();
+
+    // half the probes are deleted keys, half were never inserted
+    for(int i=0; i<ABSENT_LOOKUPS; i++) {
+        uint64_t probe = (((uint64_t) rand_r(&seed) << 31) | rand_r(&seed)) % FILTER_KEYS;
+        uint64_t key = i % 2 == 0 ? probe | 1 : FILTER_KEYS + probe;
+        found += tree->Search(key, 0) != nullptr;
+    }
+
+    uint64 time_end = GetTimeMs64();
+
+    if(found != 0) {
+        std::cout << "  " << found << " absent keys found" << std::endl;
+        exit(1);
+    }
+
+    std::cout << "  ns per absent lookup:   " << (time_end - time_start) * 1000000.0 / ABSENT_LOOKUPS << std::endl;
+
+    if(filter) {
+        FilterCounters after = tree->GetNegativeFilterCounters();
+        uint64_t rejected = after.mRejected - before.mRejected;
+        uint64_t falsePositives = after.mFalsePositives - before.mFalsePositives;
+
+        std::cout << "  rejected " << rejected << ", false positives " << falsePositives << " ("
+                  << 100.0 * falsePositives / (rejected + falsePositives) << "%)" << std::endl;
+    }
+}
+
+int main(void)
+{
+    unsigned seed = 1;
+    key_order = (uint64_t *) malloc(FILTER_KEYS * sizeof(uint64_t));
+    for(uint64_t i=0; i<FILTER_KEYS; i++) {
+        key_order[i] = i;
+    }
+    for(uint64_t i=FILTER_KEYS - 1; i>0; i--) {
+        std::swap(key_order[i], key_order[rand_r(&seed) % (i + 1)]);
+    }
+
+    run(false);
+    run(true);
+}
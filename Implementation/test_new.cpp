@@ -0,0 +1,7 @@
+#include "bench_policies.h"
+
+// nodes and operation records from operator new, shared words updated with CAS
+int main(void)
+{
+    return run_policy_benchmark<NewAlloc, AtomicSync>("new + atomic");
+}
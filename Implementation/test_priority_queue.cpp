@@ -0,0 +1,130 @@
+#include <iostream>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// the tree as a scheduler queue keyed by deadline: every thread alternates between
+// adding a random deadline and popping the earliest one, on PopMin, on PopMin with
+// spraying, and on a std::priority_queue behind a mutex
+
+#define QUEUE_THREADS 4
+#define QUEUE_PREFILL 100000
+#define QUEUE_OPS_PER_THREAD 100000
+#define QUEUE_SPRAY_LEVELS 4
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct LockedQueue
+{
+    std::mutex mLock;
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> mQueue;
+};
+
+struct QueueArgs
+{
+    Tree *mTree;
+    LockedQueue *mLocked;
+    uint32_t mSpray;
+    int mPid;
+};
+
+uint64_t random_deadline(unsigned *seed)
+{
+    return ((uint64_t) rand_r(seed) << 31) | rand_r(seed);
+}
+
+void *tree_worker(void *args)
+{
+    QueueArgs *myArgs = (QueueArgs *) args;
+    Tree *tree = myArgs->mTree;
+    unsigned seed = myArgs->mPid + 1;
+    uint64_t key, value;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(int i=0; i<QUEUE_OPS_PER_THREAD; i++) {
+        uint64_t deadline = random_deadline(&seed);
+        tree->InsertOrUpdate(deadline, deadline, myArgs->mPid);
+        tree->PopMin(&key, &value, myArgs->mPid, myArgs->mSpray);
+    }
+
+    return nullptr;
+}
+
+void *locked_worker(void *args)
+{
+    QueueArgs *myArgs = (QueueArgs *) args;
+    LockedQueue *queue = myArgs->mLocked;
+    unsigned seed = myArgs->mPid + 1;
+
+    for(int i=0; i<QUEUE_OPS_PER_THREAD; i++) {
+        uint64_t deadline = random_deadline(&seed);
+        {
+            std::lock_guard<std::mutex> guard(queue->mLock);
+            queue->mQueue.push(deadline);
+        }
+        {
+            std::lock_guard<std::mutex> guard(queue->mLock);
+            queue->mQueue.pop();
+        }
+    }
+
+    return nullptr;
+}
+
+void run(const char *name, Tree *tree, LockedQueue *locked, uint32_t spray)
+{
+    pthread_t threads[QUEUE_THREADS];
+    QueueArgs args[QUEUE_THREADS];
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<QUEUE_THREADS; i++) {
+        args[i] = {tree, locked, spray, i};
+        pthread_create(&threads[i], NULL, tree != nullptr ? tree_worker : locked_worker, (void *) &args[i]);
+    }
+
+    for(int i=0; i<QUEUE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64 elapsed = GetTimeMs64() - time_start;
+    uint64_t ops = (uint64_t) QUEUE_THREADS * QUEUE_OPS_PER_THREAD * 2;
+
+    std::cout << name << ": " << ops * 1000.0 / (elapsed != 0 ? elapsed : 1) << " ops per second";
+    if(tree != nullptr) {
+        PopCounters counters = tree->GetPopCounters();
+        std::cout << ", " << counters.mRetries << " retried pops";
+    }
+    std::cout << std::endl;
+}
+
+Tree *prefilled_tree()
+{
+    Tree *tree = new Tree(QUEUE_THREADS);
+    unsigned seed = 0;
+
+    tree->SetSingleOwner(0);
+    for(int i=0; i<QUEUE_PREFILL; i++) {
+        uint64_t deadline = random_deadline(&seed);
+        tree->InsertOrUpdate(deadline, deadline, 0);
+    }
+
+    return tree;
+}
+
+int main(void)
+{
+    run("tree PopMin", prefilled_tree(), nullptr, 0);
+    run("tree PopMin, sprayed", prefilled_tree(), nullptr, QUEUE_SPRAY_LEVELS);
+
+    LockedQueue *locked = new LockedQueue();
+    unsigned seed = 0;
+    for(int i=0; i<QUEUE_PREFILL; i++) {
+        locked->mQueue.push(random_deadline(&seed));
+    }
+    run("locked std::priority_queue", nullptr, locked, 0);
+}
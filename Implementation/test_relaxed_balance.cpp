@@ -0,0 +1,151 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// inserts a burst of ascending keys, which turns the unbalanced tree into a
+// spine: through the default write path, and with the background rebalancer of
+// the relaxed-balance mode repairing the paths the writers logged. reports the
+// writers' latency and the searches after, and whether the rebalancer lowered
+// writer p99. fails if the relaxed tree is left deeper than a red-black tree
+// may be once its last logged paths are repaired
+
+#define BALANCE_THREADS 4
+#define BURST_KEYS_PER_THREAD 2000
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+enum BalanceMode {DEFAULT_WRITES, BACKGROUND_REBALANCER};
+
+struct BurstArgs
+{
+    Tree *mTree;
+    int mPid;
+    BalanceMode mMode;
+    uint64_t *mLatencies;
+};
+
+void *burst_worker(void *args)
+{
+    BurstArgs *myArgs = (BurstArgs *) args;
+    myArgs->mTree->RegisterThread(myArgs->mPid);
+
+    // the threads' keys interleave, so all of them append to the same end of the tree
+    for(uint64_t i=0; i<BURST_KEYS_PER_THREAD; i++) {
+        auto start = std::chrono::steady_clock::now();
+        myArgs->mTree->InsertOrUpdate(i * BALANCE_THREADS + myArgs->mPid, i, myArgs->mPid);
+        auto end = std::chrono::steady_clock::now();
+        myArgs->mLatencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+
+    return nullptr;
+}
+
+uint32_t height(DataNode<uint64_t, uint64_t> *dNode)
+{
+    if(dNode->isLeaf()) {
+        return 1;
+    }
+
+    uint32_t left = height(dNode->mLeft.unpack());
+    uint32_t right = height(dNode->mRight.unpack());
+    return 1 + (left > right ? left : right);
+}
+
+// writer p99 in ns
+uint64_t run(const char *name, BalanceMode mode)
+{
+    // the rebalancer takes the slot after the writers
+    Tree *tree = new Tree(BALANCE_THREADS + 1);
+    bool rebalance = mode == BACKGROUND_REBALANCER;
+    if(rebalance) {
+        tree->EnableRelaxedBalance();
+        tree->StartRebalancer(BALANCE_THREADS);
+    }
+
+    uint64_t numKeys = (uint64_t) BALANCE_THREADS * BURST_KEYS_PER_THREAD;
+    uint64_t *latencies = (uint64_t *) malloc(sizeof(uint64_t) * numKeys);
+    pthread_t threads[BALANCE_THREADS];
+    BurstArgs args[BALANCE_THREADS];
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<BALANCE_THREADS; i++) {
+        args[i] = {tree, i, mode, latencies + i * BURST_KEYS_PER_THREAD};
+        pthread_create(&threads[i], NULL, burst_worker, (void *) &args[i]);
+    }
+
+    for(int i=0; i<BALANCE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64 insert_elapsed = GetTimeMs64() - time_start;
+
+    // the paths logged after the rebalancer last looked are repaired here
+    if(rebalance) {
+        tree->StopRebalancer();
+        tree->Rebalance(BALANCE_THREADS);
+    }
+
+    // searches run after the burst, on whatever shape the writers and the rebalancer
+    // left, and every key must still be found with the value its writer gave it
+    uint64_t missing = 0;
+    time_start = GetTimeMs64();
+    for(uint64_t key=0; key<numKeys; key++) {
+        uint64_t *value = tree->Search(key, 0);
+        missing += value == nullptr || *value != key / BALANCE_THREADS;
+    }
+    uint64 search_elapsed = GetTimeMs64() - time_start;
+
+    if(missing != 0) {
+        std::cout << name << ": " << missing << " keys lost or changed" << std::endl;
+        exit(1);
+    }
+
+    std::sort(latencies, latencies + numKeys);
+    uint32_t treeHeight = height(tree->pRoot->unpack());
+
+    std::cout << name << ": inserts " << insert_elapsed * 1000000.0 / numKeys << " ns per op, p99 "
+              << latencies[numKeys * 99 / 100] << " ns; searches " << search_elapsed * 1000000.0 / numKeys
+              << " ns per op; height " << treeHeight;
+
+    if(rebalance) {
+        BalanceCounters counters = tree->GetBalanceCounters();
+        std::cout << ", " << counters.mViolations << " violations (" << counters.mDropped << " dropped), "
+                  << counters.mRepairs << " paths repaired with " << counters.mRecolorings << " recolourings and "
+                  << counters.mRotations << " rotations";
+
+        // a red-black tree of n leaves is at most 2 log2(n) deep; the root sentinels
+        // and the leaf level add a few levels
+        uint32_t bound = 2 * 64 - 2 * __builtin_clzll(numKeys) + 4;
+        if(treeHeight > bound) {
+            std::cout << std::endl << "the relaxed tree is " << treeHeight << " deep, more than " << bound << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << std::endl;
+
+    uint64_t p99 = latencies[numKeys * 99 / 100];
+    free(latencies);
+    return p99;
+}
+
+int main(void)
+{
+    uint64_t writes = run("default write path", DEFAULT_WRITES);
+    uint64_t background = run("background rebalancer", BACKGROUND_REBALANCER);
+
+    // on few cores the rebalancer competes with the writers for time, which can
+    // cost more than the shorter paths save them
+    if(background < writes) {
+        std::cout << "the background rebalancer lowered writer p99 by " << 100.0 - 100.0 * background / writes
+                  << "% against the default write path" << std::endl;
+    }
+    else {
+        std::cout << "the background rebalancer did not lower writer p99 against the default write path ("
+                  << background << " vs " << writes << " ns)" << std::endl;
+    }
+}
@@ -0,0 +1,196 @@
+#include <iostream>
+#include <cstdlib>
+#include <sched.h>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// one thread splits a tree at a fixed key and joins the halves back, over and
+// over, while the other threads keep using it: each inserts and deletes keys of
+// its own below the cut, which stay in the left tree, checking them against a
+// model, and looks up keys from the cut on, which Split and Join move between
+// the trees and which must always be in exactly one of them. at the end the left tree
+// holds exactly the keys of the models and the moved ones, with its invariants
+// intact, and the right tree is empty
+
+#define RESHARD_WORKERS 4
+#define RESHARD_ROUNDS 2000
+#define OWNED_KEYS 40000
+#define MOVED_KEYS 20000
+#define WORKER_OPS 200000
+// half the changes are to the owned keys just below the cut, whose paths share
+// the most nodes with the one Split copies
+#define NEAR_CUT_KEYS 512
+// a worker yields once in this many operations, so they interleave with the cuts on one core
+#define YIELD_EVERY 64
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct ReshardArgs
+{
+    Tree *mLeft;
+    Tree *mRight;
+    int mPid;
+    // odd while the reshard thread is inside Split or Join
+    uint64_t *mMoves;
+    // which of the keys this worker owns are present
+    std::vector<bool> *mPresent;
+    uint64_t mErrors;
+    // lookups of moved keys that were repeated because a move overlapped them
+    uint64_t mRepeated;
+    bool *mDone;
+};
+
+// a moved key is in exactly one of the trees; looking in both can find it in
+// neither or in both only if a move came in between
+bool find_moved(ReshardArgs *myArgs, uint64_t key)
+{
+    while(true) {
+        uint64_t moves = __atomic_load_n(myArgs->mMoves, __ATOMIC_ACQUIRE);
+        uint64_t *inLeft = myArgs->mLeft->Search(key, myArgs->mPid);
+        uint64_t *inRight = myArgs->mRight->Search(key, myArgs->mPid);
+
+        if((moves & 1) == 0 && __atomic_load_n(myArgs->mMoves, __ATOMIC_ACQUIRE) == moves) {
+            uint64_t *value = inLeft != nullptr ? inLeft : inRight;
+            return (inLeft == nullptr) != (inRight == nullptr) && *value == key;
+        }
+        myArgs->mRepeated++;
+    }
+}
+
+void *reshard_worker(void *args)
+{
+    ReshardArgs *myArgs = (ReshardArgs *) args;
+    Tree *tree = myArgs->mLeft;
+    std::vector<bool> &present = *myArgs->mPresent;
+    unsigned seed = myArgs->mPid;
+
+    tree->RegisterThread(myArgs->mPid);
+    myArgs->mRight->RegisterThread(myArgs->mPid);
+
+    for(int i=0; i<WORKER_OPS; i++) {
+        uint64_t slot = (uint64_t) rand_r(&seed) % (OWNED_KEYS / RESHARD_WORKERS);
+        if(rand_r(&seed) % 2 == 0) {
+            slot = (OWNED_KEYS - NEAR_CUT_KEYS) / RESHARD_WORKERS + slot % (NEAR_CUT_KEYS / RESHARD_WORKERS);
+        }
+        uint64_t key = slot * RESHARD_WORKERS + myArgs->mPid - 1;
+        uint32_t op = rand_r(&seed) % 3;
+
+        if(op == 0) {
+            tree->InsertOrUpdate(key, key, myArgs->mPid);
+            present[slot] = true;
+        }
+        else if(op == 1) {
+            tree->Delete(key, myArgs->mPid);
+            present[slot] = false;
+        }
+
+        uint64_t *value = tree->Search(key, myArgs->mPid);
+        if(value != nullptr ? *value != key || !present[slot] : present[slot]) {
+            myArgs->mErrors++;
+        }
+
+        if(!find_moved(myArgs, OWNED_KEYS + (uint64_t) rand_r(&seed) % MOVED_KEYS)) {
+            myArgs->mErrors++;
+        }
+
+        if(i % YIELD_EVERY == 0) {
+            sched_yield();
+        }
+    }
+
+    return nullptr;
+}
+
+void *reshard_mover(void *args)
+{
+    ReshardArgs *myArgs = (ReshardArgs *) args;
+
+    for(int i=0; i<RESHARD_ROUNDS && !__atomic_load_n(myArgs->mDone, __ATOMIC_ACQUIRE); i++) {
+        __atomic_add_fetch(myArgs->mMoves, 1, __ATOMIC_SEQ_CST);
+        bool moved = myArgs->mLeft->Split(OWNED_KEYS, myArgs->mRight, myArgs->mPid);
+        __atomic_add_fetch(myArgs->mMoves, 1, __ATOMIC_SEQ_CST);
+        sched_yield();
+
+        __atomic_add_fetch(myArgs->mMoves, 1, __ATOMIC_SEQ_CST);
+        moved = myArgs->mLeft->Join(myArgs->mRight, myArgs->mPid) && moved;
+        __atomic_add_fetch(myArgs->mMoves, 1, __ATOMIC_SEQ_CST);
+        sched_yield();
+
+        if(!moved) {
+            myArgs->mErrors++;
+        }
+    }
+
+    return nullptr;
+}
+
+int main(void)
+{
+    Tree *left = new Tree(RESHARD_WORKERS + 1);
+    Tree *right = new Tree(RESHARD_WORKERS + 1);
+    left->EnableFingers();
+    right->EnableFingers();
+
+    // the moved keys go in first, in random order, since the tree is not rebalanced by default
+    unsigned seed = 1;
+    std::vector<uint64_t> order(MOVED_KEYS);
+    for(uint64_t i=0; i<MOVED_KEYS; i++) {
+        order[i] = OWNED_KEYS + i;
+    }
+    for(uint64_t i=MOVED_KEYS - 1; i>0; i--) {
+        std::swap(order[i], order[rand_r(&seed) % (i + 1)]);
+    }
+    for(uint64_t key : order) {
+        left->InsertOrUpdate(key, key, 0);
+    }
+
+    uint64_t moves = 0;
+    bool done = false;
+    pthread_t threads[RESHARD_WORKERS + 1];
+    ReshardArgs args[RESHARD_WORKERS + 1];
+    std::vector<bool> present[RESHARD_WORKERS + 1];
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<=RESHARD_WORKERS; i++) {
+        present[i].assign(OWNED_KEYS / RESHARD_WORKERS, false);
+        args[i] = {left, right, i, &moves, &present[i], 0, 0, &done};
+        pthread_create(&threads[i], NULL, i == 0 ? reshard_mover : reshard_worker, (void *) &args[i]);
+    }
+
+    uint64_t errors = 0, repeated = 0;
+    for(int i=1; i<=RESHARD_WORKERS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].mErrors;
+        repeated += args[i].mRepeated;
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    pthread_join(threads[0], NULL);
+    errors += args[0].mErrors;
+
+    uint64 elapsed = GetTimeMs64() - time_start;
+
+    // the left tree holds exactly the owned keys of the models and every moved key
+    uint64_t expected = MOVED_KEYS;
+    for(uint64_t key=0; key<OWNED_KEYS + MOVED_KEYS; key++) {
+        bool inModel = key >= OWNED_KEYS || present[key % RESHARD_WORKERS + 1][key / RESHARD_WORKERS];
+        uint64_t *value = left->Search(key, 0);
+        errors += inModel != (value != nullptr && *value == key);
+        expected += key < OWNED_KEYS && inModel;
+    }
+
+    uint64_t keys, rightKeys;
+    uint32_t height;
+    bool valid = left->CheckInvariants(&keys, &height) && right->CheckInvariants(&rightKeys) && rightKeys == 0;
+
+    std::cout << moves / 4 << " splits and joins under " << RESHARD_WORKERS << " threads in " << elapsed
+              << " ms: " << errors << " wrong results, " << repeated << " lookups of moved keys repeated, "
+              << keys << "/" << expected << " keys, height " << height << ", invariants "
+              << (valid ? "hold" : "broken") << std::endl;
+
+    if(errors != 0 || !valid || keys != expected) {
+        exit(1);
+    }
+}
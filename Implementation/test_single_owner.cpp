@@ -0,0 +1,152 @@
+#include <iostream>
+#include <cstdlib>
+#include <sched.h>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// the owner set by SetSingleOwner streams inserts and deletes of its keys in
+// place while a second thread waits for a given point in that stream, calls
+// RegisterThread and starts writing its own keys and reading the owner's. both
+// check their reads against models, and the final tree must hold exactly the
+// keys of both models with its invariants intact. every round registers at a
+// different point, and some registrations find the owner inside an operation
+
+#define OWNER_ROUNDS 40
+#define OWNER_KEYS 20000
+#define OWNER_OPS 40000
+#define JOINER_OPS 20000
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct OwnerArgs
+{
+    Tree *mTree;
+    int mPid;
+    // owner operations to wait for before registering; unused by the owner
+    uint64_t mRegisterAt;
+    // owner operations completed so far, shared by both threads
+    uint64_t *mProgress;
+    // which of the keys this thread writes are present
+    std::vector<bool> *mPresent;
+    bool mFoundOwnerActive;
+    uint64_t mErrors;
+};
+
+// the owner writes the even keys, the second thread the odd ones
+void write_keys(OwnerArgs *myArgs, int ops, unsigned *seed, bool progress)
+{
+    Tree *tree = myArgs->mTree;
+    std::vector<bool> &present = *myArgs->mPresent;
+
+    for(int i=0; i<ops; i++) {
+        uint64_t slot = (uint64_t) rand_r(seed) % (OWNER_KEYS / 2);
+        uint64_t key = slot * 2 + myArgs->mPid;
+
+        if(rand_r(seed) % 2 == 0) {
+            tree->InsertOrUpdate(key, key, myArgs->mPid);
+            present[slot] = true;
+        }
+        else {
+            tree->Delete(key, myArgs->mPid);
+            present[slot] = false;
+        }
+
+        uint64_t *value = tree->Search(key, myArgs->mPid);
+        if(value != nullptr ? *value != key || !present[slot] : present[slot]) {
+            myArgs->mErrors++;
+        }
+
+        // an owner key read by the other thread only has to carry its own value
+        if(myArgs->mPid == 1) {
+            uint64_t other = (uint64_t) rand_r(seed) % (OWNER_KEYS / 2) * 2;
+            value = tree->Search(other, myArgs->mPid);
+            if(value != nullptr && *value != other) {
+                myArgs->mErrors++;
+            }
+        }
+
+        if(progress) {
+            __atomic_store_n(myArgs->mProgress, (uint64_t) i + 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+void *owner_worker(void *args)
+{
+    OwnerArgs *myArgs = (OwnerArgs *) args;
+    unsigned seed = myArgs->mRegisterAt + 1;
+
+    write_keys(myArgs, OWNER_OPS, &seed, true);
+    return nullptr;
+}
+
+void *joiner_worker(void *args)
+{
+    OwnerArgs *myArgs = (OwnerArgs *) args;
+    unsigned seed = myArgs->mRegisterAt + 2;
+
+    while(__atomic_load_n(myArgs->mProgress, __ATOMIC_ACQUIRE) < myArgs->mRegisterAt) {
+        sched_yield();
+    }
+
+    myArgs->mFoundOwnerActive = __atomic_load_n(&myArgs->mTree->mOwnerActive, __ATOMIC_ACQUIRE) != 0;
+    myArgs->mTree->RegisterThread(myArgs->mPid);
+
+    write_keys(myArgs, JOINER_OPS, &seed, false);
+    return nullptr;
+}
+
+int main(void)
+{
+    uint64_t errors = 0, activeRegistrations = 0;
+    uint64 time_start = GetTimeMs64();
+
+    for(int round=0; round<OWNER_ROUNDS; round++) {
+        Tree *tree = new Tree(2);
+        tree->SetSingleOwner(0);
+
+        std::vector<bool> present[2];
+        present[0].assign(OWNER_KEYS / 2, false);
+        present[1].assign(OWNER_KEYS / 2, false);
+
+        uint64_t progress = 0;
+        uint64_t registerAt = (uint64_t) round * OWNER_OPS / OWNER_ROUNDS;
+        OwnerArgs args[2];
+        pthread_t threads[2];
+
+        args[0] = {tree, 0, registerAt, &progress, &present[0], false, 0};
+        args[1] = {tree, 1, registerAt, &progress, &present[1], false, 0};
+        pthread_create(&threads[0], NULL, owner_worker, (void *) &args[0]);
+        pthread_create(&threads[1], NULL, joiner_worker, (void *) &args[1]);
+        pthread_join(threads[0], NULL);
+        pthread_join(threads[1], NULL);
+
+        errors += args[0].mErrors + args[1].mErrors;
+        activeRegistrations += args[1].mFoundOwnerActive;
+
+        // the tree holds exactly the keys of both models
+        uint64_t expected = 0;
+        for(uint64_t key=0; key<OWNER_KEYS; key++) {
+            bool inModel = present[key % 2][key / 2];
+            uint64_t *value = tree->Search(key, 0);
+            errors += inModel != (value != nullptr && *value == key);
+            expected += inModel;
+        }
+
+        uint64_t keys;
+        if(!tree->CheckInvariants(&keys) || keys != expected) {
+            std::cout << "round " << round << ": invariants broken after registering at " << registerAt << std::endl;
+            exit(1);
+        }
+    }
+
+    std::cout << OWNER_ROUNDS << " rounds registering a second thread mid-stream in "
+              << GetTimeMs64() - time_start << " ms, " << activeRegistrations
+              << " found the owner inside an operation, " << errors << " wrong results" << std::endl;
+
+    if(errors != 0) {
+        exit(1);
+    }
+}
@@ -0,0 +1,114 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include "concurrent.hpp"
+
+// moves the upper half of a tree into another one, once by re-inserting every key
+// there and deleting it from the source, and once with Split; then puts the halves
+// back together with Join, and appends many small trees to one with Join to show
+// how its height grows. test_reshard runs both while other threads use the trees
+
+#define SHARD_KEYS 1000000
+#define APPENDED_TREES 1000
+#define APPENDED_KEYS 64
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+// the same keys in the same order on every call with a fresh seed
+uint64_t random_key(unsigned *seed)
+{
+    return (((uint64_t) rand_r(seed) << 31) | rand_r(seed)) % (SHARD_KEYS * 4);
+}
+
+uint64_t microseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+Tree *random_tree()
+{
+    Tree *tree = new Tree(1);
+    tree->SetSingleOwner(0);
+
+    unsigned seed = 1;
+    for(uint64_t i=0; i<SHARD_KEYS; i++) {
+        uint64_t key = random_key(&seed);
+        tree->InsertOrUpdate(key, key, 0);
+    }
+
+    return tree;
+}
+
+int main(void)
+{
+    uint64_t cut = SHARD_KEYS * 2;
+    uint64_t value;
+
+    Tree *source = random_tree();
+    Tree *target = new Tree(1);
+    target->SetSingleOwner(0);
+
+    // the keys move in their insertion order; a sorted order would build a spine
+    unsigned seed = 1;
+    auto start = std::chrono::steady_clock::now();
+    for(uint64_t i=0; i<SHARD_KEYS; i++) {
+        uint64_t key = random_key(&seed);
+        if(key >= cut) {
+            target->InsertOrUpdate(key, key, 0);
+            source->Delete(key, 0);
+        }
+    }
+    uint64_t reinsert_elapsed = microseconds_since(start);
+
+    source = random_tree();
+    target = new Tree(1);
+
+    start = std::chrono::steady_clock::now();
+    bool split = source->Split(cut, target, 0);
+    uint64_t split_elapsed = microseconds_since(start);
+
+    uint64_t low, high;
+    target->PeekMin(&high, &value, 0);
+    source->PopMax(&low, &value, 0);
+    source->InsertOrUpdate(low, value, 0);
+
+    start = std::chrono::steady_clock::now();
+    bool joined = source->Join(target, 0);
+    uint64_t join_elapsed = microseconds_since(start);
+
+    uint64_t keys;
+    uint32_t height;
+    bool valid = source->CheckInvariants(&keys, &height);
+
+    std::cout << "re-insert upper half: " << reinsert_elapsed << " us" << std::endl;
+    std::cout << "Split: " << (split ? "" : "refused, ") << split_elapsed << " us, largest kept key "
+              << low << ", smallest moved key " << high << std::endl;
+    std::cout << "Join: " << (joined ? "" : "refused, ") << join_elapsed << " us, height " << height << std::endl;
+
+    if(!split || !joined || !valid) {
+        exit(1);
+    }
+
+    // each small tree is joined after the keys already there; hung under a new
+    // root every time, the height would grow by one per join
+    Tree *appended = new Tree(1);
+    seed = 1;
+    for(uint64_t i=0; i<APPENDED_TREES; i++) {
+        Tree *small = new Tree(1);
+        for(uint64_t j=0; j<APPENDED_KEYS; j++) {
+            uint64_t key = i * APPENDED_KEYS * 4 + rand_r(&seed) % (APPENDED_KEYS * 4);
+            small->InsertOrUpdate(key, key, 0);
+        }
+        if(!appended->Join(small, 0)) {
+            std::cout << "Join of small tree " << i << " refused" << std::endl;
+            exit(1);
+        }
+    }
+
+    valid = appended->CheckInvariants(&keys, &height);
+    std::cout << APPENDED_TREES << " small trees joined: " << keys << " keys, height " << height << std::endl;
+
+    if(!valid) {
+        exit(1);
+    }
+}
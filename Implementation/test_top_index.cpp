@@ -0,0 +1,115 @@
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+#include "bench_tree.h"
+
+// point lookups through Search on a balanced tree, once from the root and once
+// from the top index of EnableTopIndex. then keys are deleted and re-inserted at
+// random, which replaces nodes the index copied, while every lookup is checked
+// against a model; the index must keep answering right and rebuild itself. in a
+// tree not much deeper than the index most changes replace an indexed node
+
+#define TREE_KEYS 1000000
+#define SMALL_TREE_KEYS 8192
+#define LOOKUPS   1000000
+#define TOP_INDEX_DEPTH 12
+#define CHURN_OPS 200000
+
+void run(uint64_t numKeys, bool topIndex)
+{
+    Tree *tree = build_tree(numKeys, 0);
+    if(topIndex) {
+        tree->EnableTopIndex(TOP_INDEX_DEPTH);
+    }
+
+    uint64_t *probes = (uint64_t *) malloc(LOOKUPS * sizeof(uint64_t));
+    for(int i=0; i<LOOKUPS; i++) {
+        probes[i] = (((uint64_t) rand() << 31) | rand()) % numKeys;
+    }
+
+    int counter = open_cache_miss_counter();
+    uint64_t found = 0;
+
+    if(counter != -1) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<LOOKUPS; i++) {
+        found += tree->Search(probes[i], 0) != nullptr;
+    }
+
+    uint64 time_end = GetTimeMs64();
+
+    long long misses = -1;
+    if(counter != -1) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(counter, &misses, sizeof(misses)) != sizeof(misses)) {
+            misses = -1;
+        }
+        close(counter);
+    }
+
+    std::cout << numKeys << " keys, " << (topIndex ? "top index" : "from the root") << ", " << found << "/" << LOOKUPS << " found" << std::endl;
+    std::cout << "  ns per lookup:          " << (time_end - time_start) * 1000000.0 / LOOKUPS << std::endl;
+
+    if(misses != -1) {
+        std::cout << "  cache misses per lookup: " << (double) misses / LOOKUPS << std::endl;
+    }
+    else {
+        std::cout << "  cache misses per lookup: unavailable (perf_event_open failed)" << std::endl;
+    }
+
+    if(found != LOOKUPS) {
+        exit(1);
+    }
+
+    // deletes and re-inserts replace the nodes the index was copied from
+    std::vector<bool> present(numKeys, true);
+    unsigned seed = 1;
+
+    for(int i=0; i<CHURN_OPS; i++) {
+        uint64_t key = (((uint64_t) rand_r(&seed) << 31) | rand_r(&seed)) % numKeys;
+
+        if(present[key]) {
+            tree->Delete(key, 0);
+        }
+        else {
+            tree->InsertOrUpdate(key, bench_value, 0);
+        }
+        present[key] = !present[key];
+
+        uint64_t probe = (((uint64_t) rand_r(&seed) << 31) | rand_r(&seed)) % numKeys;
+        if((tree->Search(key, 0) != nullptr) != present[key] || (tree->Search(probe, 0) != nullptr) != present[probe]) {
+            std::cout << "  lookup disagrees with the model after " << i << " changes" << std::endl;
+            exit(1);
+        }
+    }
+
+    std::cout << "  " << CHURN_OPS << " deletes and inserts checked against a model";
+    if(topIndex) {
+        TopIndex<uint64_t, uint64_t> *index = tree->mTopIndex;
+        std::cout << ", index version " << tree->mTopIndexVersion << " with " << index->mCount << " entries, "
+                  << index->mStale << " stale lookups since its build";
+    }
+    std::cout << std::endl;
+
+    free(probes);
+}
+
+int main(int argc, char **argv)
+{
+    srand(time(NULL));
+
+    // the key count can be overridden on the command line, e.g. ./test_top_index 4000000
+    uint64_t numKeys = argc > 1 ? strtoull(argv[1], nullptr, 10) : TREE_KEYS;
+
+    run(numKeys, false);
+    run(numKeys, true);
+    run(SMALL_TREE_KEYS, true);
+}
@@ -0,0 +1,248 @@
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// moves entries between keys and updates groups of keys with Transact, once
+// with every thread in its own key range and once with all threads on a
+// small shared range, and reports how often transactions had to start over.
+// then threads transfer amounts between accounts with TX_ADD while others write
+// keys sharing the accounts' stripes and watch the smallest key with PeekMin:
+// the total over all accounts must not change, and the smallest key, which
+// transactions swap between 0 and 1, must always be one of the two. last, the
+// cost of single-key writes with transactions enabled and not
+
+#define TRANSACT_THREADS 4
+#define TRANSACTIONS_PER_THREAD 50000
+#define TRANSACT_STRIPES 4096
+// keys per thread in the disjoint run, and keys shared by all threads in the contended run
+#define DISJOINT_KEYS 4096
+#define SHARED_KEYS 16
+// the bank run: accounts are the keys from FIRST_ACCOUNT on, and few stripes make
+// the single-key writers collide with the transfers
+#define BANK_ACCOUNTS 256
+#define FIRST_ACCOUNT 2
+#define INITIAL_BALANCE 1000
+#define BANK_STRIPES 64
+#define TRANSFERS_PER_THREAD 50000
+#define BANK_WRITES 200000
+// keys written outside transactions during the bank run start here
+#define FIRST_SCRATCH_KEY 1000000
+#define WRITE_KEYS 100000
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct TransactArgs
+{
+    Tree *mTree;
+    int mPid;
+    uint64_t mBase;
+    uint64_t mRange;
+};
+
+void *transact_worker(void *args)
+{
+    TransactArgs *myArgs = (TransactArgs *) args;
+    unsigned int seed = myArgs->mPid + 1;
+
+    for(uint64_t i=0; i<TRANSACTIONS_PER_THREAD; i++) {
+        uint64_t a = myArgs->mBase + rand_r(&seed) % myArgs->mRange;
+        uint64_t b = myArgs->mBase + rand_r(&seed) % myArgs->mRange;
+        uint64_t c = myArgs->mBase + rand_r(&seed) % myArgs->mRange;
+
+        if(i % 2 == 0) {
+            // move an entry to another key
+            myArgs->mTree->Transact({{TX_MOVE, a, 0, b}}, myArgs->mPid);
+        }
+        else {
+            // set a group of keys together
+            myArgs->mTree->Transact({{TX_INSERT, a, i, 0}, {TX_INSERT, b, i, 0}, {TX_UPDATE, c, i, 0}}, myArgs->mPid);
+        }
+    }
+
+    return nullptr;
+}
+
+void run(const char *name, bool shared)
+{
+    Tree *tree = new Tree(TRANSACT_THREADS);
+    tree->EnableTransactions(TRANSACT_STRIPES);
+
+    // even keys drawn at random, so the unbalanced tree stays shallow
+    uint64_t range = shared ? SHARED_KEYS : DISJOINT_KEYS;
+    uint64_t numKeys = shared ? SHARED_KEYS : DISJOINT_KEYS * TRANSACT_THREADS;
+    unsigned int seed = 1;
+    for(uint64_t i=0; i<numKeys; i++) {
+        uint64_t key = rand_r(&seed) % numKeys;
+        if(key % 2 == 0) {
+            tree->InsertOrUpdate(key, key, 0);
+        }
+    }
+
+    pthread_t threads[TRANSACT_THREADS];
+    TransactArgs args[TRANSACT_THREADS];
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<TRANSACT_THREADS; i++) {
+        args[i] = {tree, i, shared ? 0 : i * range, range};
+        pthread_create(&threads[i], NULL, transact_worker, (void *) &args[i]);
+    }
+
+    for(int i=0; i<TRANSACT_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64 time_elapsed = GetTimeMs64() - time_start;
+
+    TransactionCounters counters = tree->GetTransactionCounters();
+    std::cout << name << ": " << time_elapsed * 1000000.0 / (TRANSACT_THREADS * TRANSACTIONS_PER_THREAD) << " ns per transaction, "
+              << counters.mCommits << " committed, " << counters.mAborts << " retried ("
+              << 100.0 * counters.mAborts / (counters.mCommits + counters.mAborts) << "% of attempts)" << std::endl;
+}
+
+struct BankArgs
+{
+    Tree *mTree;
+    int mPid;
+    uint64_t mErrors;
+};
+
+// moves a random amount between two accounts, and moves the smallest key from 0
+// to 1 or back; outside transactions exactly one of the two is present
+void *transfer_worker(void *args)
+{
+    BankArgs *myArgs = (BankArgs *) args;
+    unsigned int seed = myArgs->mPid + 1;
+
+    for(int i=0; i<TRANSFERS_PER_THREAD; i++) {
+        uint64_t from = FIRST_ACCOUNT + rand_r(&seed) % BANK_ACCOUNTS;
+        uint64_t to = FIRST_ACCOUNT + rand_r(&seed) % BANK_ACCOUNTS;
+        uint64_t amount = rand_r(&seed) % 100;
+
+        myArgs->mTree->Transact({{TX_ADD, from, 0 - amount, 0}, {TX_ADD, to, amount, 0},
+                                 {TX_MOVE, (uint64_t) i % 2, 0, (uint64_t) (i + 1) % 2}}, myArgs->mPid);
+    }
+
+    return nullptr;
+}
+
+// inserts and deletes keys of its own outside transactions, each checked by a
+// lookup, and checks the smallest key between writes
+void *bank_writer(void *args)
+{
+    BankArgs *myArgs = (BankArgs *) args;
+    unsigned int seed = myArgs->mPid + 1;
+
+    for(int i=0; i<BANK_WRITES; i++) {
+        uint64_t key = FIRST_SCRATCH_KEY + myArgs->mPid + TRANSACT_THREADS * (rand_r(&seed) % WRITE_KEYS);
+        bool insert = rand_r(&seed) % 2 == 0;
+
+        if(insert) {
+            myArgs->mTree->InsertOrUpdate(key, key, myArgs->mPid);
+        }
+        else {
+            myArgs->mTree->Delete(key, myArgs->mPid);
+        }
+
+        uint64_t *value = myArgs->mTree->Search(key, myArgs->mPid);
+        if(insert != (value != nullptr && *value == key)) {
+            myArgs->mErrors++;
+        }
+
+        uint64_t smallest, smallestValue;
+        if(!myArgs->mTree->PeekMin(&smallest, &smallestValue, myArgs->mPid) || smallest > 1) {
+            myArgs->mErrors++;
+        }
+    }
+
+    return nullptr;
+}
+
+void run_bank()
+{
+    Tree *tree = new Tree(TRANSACT_THREADS);
+    tree->EnableTransactions(BANK_STRIPES);
+
+    // the accounts in random order, since the tree is not rebalanced by default
+    uint64_t order[BANK_ACCOUNTS];
+    unsigned int seed = 1;
+    for(uint64_t i=0; i<BANK_ACCOUNTS; i++) {
+        order[i] = FIRST_ACCOUNT + i;
+    }
+    for(uint64_t i=BANK_ACCOUNTS - 1; i>0; i--) {
+        std::swap(order[i], order[rand_r(&seed) % (i + 1)]);
+    }
+    for(uint64_t i=0; i<BANK_ACCOUNTS; i++) {
+        tree->InsertOrUpdate(order[i], INITIAL_BALANCE, 0);
+    }
+    tree->InsertOrUpdate(0, (uint64_t) 0, 0);
+
+    // half the threads transfer, half write outside transactions
+    pthread_t threads[TRANSACT_THREADS];
+    BankArgs args[TRANSACT_THREADS];
+    uint64_t errors = 0;
+
+    for(int i=0; i<TRANSACT_THREADS; i++) {
+        args[i] = {tree, i, 0};
+        pthread_create(&threads[i], NULL, i % 2 == 0 ? transfer_worker : bank_writer, (void *) &args[i]);
+    }
+    for(int i=0; i<TRANSACT_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].mErrors;
+    }
+
+    // amounts taken from an account wrap around, so the total is kept modulo 2^64
+    uint64_t total = 0;
+    for(uint64_t i=0; i<BANK_ACCOUNTS; i++) {
+        uint64_t *balance = tree->Search(FIRST_ACCOUNT + i, 0);
+        total += balance != nullptr ? *balance : 0;
+        errors += balance == nullptr;
+    }
+    errors += (tree->Search(0, 0) != nullptr) == (tree->Search(1, 0) != nullptr);
+
+    TransactionCounters counters = tree->GetTransactionCounters();
+    std::cout << "bank: total " << total << "/" << (uint64_t) BANK_ACCOUNTS * INITIAL_BALANCE << " after "
+              << counters.mCommits << " transfers, " << errors << " wrong results, " << counters.mWriteWaits
+              << " writes waited for a transaction, " << counters.mSearchRetries << " lookups retried" << std::endl;
+
+    if(total != (uint64_t) BANK_ACCOUNTS * INITIAL_BALANCE || errors != 0) {
+        exit(1);
+    }
+}
+
+// single-key inserts and deletes by one thread, with transactions enabled or not
+void run_writes(bool transactions)
+{
+    Tree *tree = new Tree(1);
+    if(transactions) {
+        tree->EnableTransactions(TRANSACT_STRIPES);
+    }
+
+    unsigned int seed = 1;
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<BANK_WRITES; i++) {
+        uint64_t key = rand_r(&seed) % WRITE_KEYS;
+        if(i % 2 == 0) {
+            tree->InsertOrUpdate(key, key, 0);
+        }
+        else {
+            tree->Delete(key, 0);
+        }
+    }
+
+    std::cout << "single-key writes, transactions " << (transactions ? "enabled" : "disabled") << ": "
+              << (GetTimeMs64() - time_start) * 1000000.0 / BANK_WRITES << " ns per write" << std::endl;
+}
+
+int main(void)
+{
+    run("disjoint keys", false);
+    run("shared keys", true);
+    run_bank();
+    run_writes(false);
+    run_writes(true);
+}
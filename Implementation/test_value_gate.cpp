@@ -0,0 +1,155 @@
+#include <iostream>
+#include <cstdlib>
+#include <sched.h>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// four threads increment one shared counter through SearchRecord and a
+// read-modify-write on its record: ReadValue and WriteValue on the gate for a
+// value kept behind a pointer, CompareExchange for a word value. no increment
+// may be lost, and a thread must never read a count below one it wrote
+
+#define GATE_THREADS 4
+#define GATE_TREE_KEYS 10000
+#define INCREMENTS_PER_THREAD 100000
+#define COUNTER_KEY 4242
+// one increment in this many yields between its read and its write, so the
+// threads conflict even when they share a core
+#define YIELD_EVERY 16
+
+// a counter kept on the generic path, behind the gate
+struct BoxedCounter
+{
+    uint64_t mCount;
+};
+
+template <>
+struct WordValue<BoxedCounter> : std::false_type {};
+
+struct GateArgs
+{
+    void *mTree;
+    int mPid;
+    uint64_t mRetries;
+    uint64_t mErrors;
+};
+
+// the writer allocates every new count; the tree does not own it
+bool increment(ValueRecord<BoxedCounter> *record, bool yield, uint64_t *written)
+{
+    uint32_t gate;
+    BoxedCounter *current = record->ReadValue(&gate);
+    BoxedCounter *next = (BoxedCounter *) malloc(sizeof(BoxedCounter));
+    next->mCount = current->mCount + 1;
+
+    if(yield) {
+        sched_yield();
+    }
+
+    if(!record->WriteValue(next, gate)) {
+        free(next);
+        return false;
+    }
+    *written = next->mCount;
+    return true;
+}
+
+bool increment(ValueRecord<uint64_t> *record, bool yield, uint64_t *written)
+{
+    uint64_t current = record->LoadValue();
+    if(yield) {
+        sched_yield();
+    }
+    if(!record->CompareExchange(&current, current + 1)) {
+        return false;
+    }
+    *written = current + 1;
+    return true;
+}
+
+uint64_t count(BoxedCounter *value)
+{
+    return value->mCount;
+}
+
+uint64_t count(uint64_t *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+template <class V>
+void *gate_worker(void *args)
+{
+    GateArgs *myArgs = (GateArgs *) args;
+    auto tree = (ConcurrentTree<uint64_t, V> *) myArgs->mTree;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(int i=0; i<INCREMENTS_PER_THREAD; i++) {
+        uint64_t written;
+        while(!increment(tree->SearchRecord(COUNTER_KEY, myArgs->mPid), i % YIELD_EVERY == 0, &written)) {
+            myArgs->mRetries++;
+        }
+
+        V *value = tree->Search(COUNTER_KEY, myArgs->mPid);
+        if(value == nullptr || count(value) < written) {
+            myArgs->mErrors++;
+        }
+    }
+
+    return nullptr;
+}
+
+template <class V>
+void run(const char *name, const V &zero)
+{
+    auto tree = new ConcurrentTree<uint64_t, V>(GATE_THREADS);
+    unsigned seed = 1;
+
+    // random insertion order, since the tree is not rebalanced by default
+    uint64_t *order = (uint64_t *) malloc(GATE_TREE_KEYS * sizeof(uint64_t));
+    for(uint64_t i=0; i<GATE_TREE_KEYS; i++) {
+        order[i] = i;
+    }
+    for(uint64_t i=GATE_TREE_KEYS - 1; i>0; i--) {
+        std::swap(order[i], order[rand_r(&seed) % (i + 1)]);
+    }
+    for(uint64_t i=0; i<GATE_TREE_KEYS; i++) {
+        tree->InsertOrUpdate(order[i], zero, 0);
+    }
+
+    pthread_t threads[GATE_THREADS];
+    GateArgs args[GATE_THREADS];
+    uint64_t retries = 0, errors = 0;
+
+    uint64 time_start = GetTimeMs64();
+
+    for(int i=0; i<GATE_THREADS; i++) {
+        args[i] = {tree, i, 0, 0};
+        pthread_create(&threads[i], NULL, gate_worker<V>, (void *) &args[i]);
+    }
+    for(int i=0; i<GATE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        retries += args[i].mRetries;
+        errors += args[i].mErrors;
+    }
+
+    uint64 elapsed = GetTimeMs64() - time_start;
+    uint64_t total = count(tree->Search(COUNTER_KEY, 0));
+    uint64_t expected = (uint64_t) GATE_THREADS * INCREMENTS_PER_THREAD;
+
+    std::cout << name << ": counter " << total << "/" << expected << " after " << elapsed << " ms, "
+              << retries << " retries on conflict, " << errors << " reads below a count written" << std::endl;
+
+    if(total != expected || errors != 0) {
+        exit(1);
+    }
+
+    free(order);
+}
+
+int main(void)
+{
+    run<BoxedCounter>("gate (ReadValue/WriteValue)", BoxedCounter{0});
+    run<uint64_t>("word value (CompareExchange)", 0);
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cstdlib>
+#include <set>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// random inserts, deletes and lookups checked against a std::set, by one thread
+// and by several threads that each own a share of the keys, with and without leaf
+// buckets. after each run CheckInvariants checks the shape the window transactions
+// left, and the counters show how many windows slid down cheaply per full one
+
+#define MODEL_THREADS 4
+#define MODEL_KEYS 20000
+#define MODEL_OPS_PER_THREAD 200000
+
+typedef ConcurrentTree<uint64_t, uint64_t> Tree;
+
+struct ModelArgs
+{
+    Tree *mTree;
+    int mPid;
+    // the keys this thread owns are those equal to mPid modulo mStride
+    int mStride;
+    std::set<uint64_t> *mModel;
+    uint64_t mErrors;
+};
+
+void *model_worker(void *args)
+{
+    ModelArgs *myArgs = (ModelArgs *) args;
+    Tree *tree = myArgs->mTree;
+    std::set<uint64_t> &model = *myArgs->mModel;
+    unsigned seed = myArgs->mPid + 1;
+
+    tree->RegisterThread(myArgs->mPid);
+    for(int i=0; i<MODEL_OPS_PER_THREAD; i++) {
+        uint64_t key = (((uint64_t) rand_r(&seed) << 31) | rand_r(&seed)) % (MODEL_KEYS / myArgs->mStride);
+        key = key * myArgs->mStride + myArgs->mPid;
+        uint32_t op = rand_r(&seed) % 3;
+
+        if(op == 0) {
+            tree->InsertOrUpdate(key, key, myArgs->mPid);
+            model.insert(key);
+        }
+        else if(op == 1) {
+            tree->Delete(key, myArgs->mPid);
+            model.erase(key);
+        }
+
+        uint64_t *value = tree->Search(key, myArgs->mPid);
+        if(value != nullptr ? *value != key || model.count(key) == 0 : model.count(key) != 0) {
+            myArgs->mErrors++;
+        }
+    }
+
+    return nullptr;
+}
+
+void run(int numThreads, uint32_t bucketSize)
+{
+    Tree *tree = new Tree(numThreads, std::less<uint64_t>(), bucketSize);
+
+    pthread_t threads[MODEL_THREADS];
+    ModelArgs args[MODEL_THREADS];
+    std::set<uint64_t> models[MODEL_THREADS];
+    uint64_t errors = 0, expected = 0;
+
+    for(int i=0; i<numThreads; i++) {
+        args[i] = {tree, i, numThreads, &models[i], 0};
+        pthread_create(&threads[i], NULL, model_worker, (void *) &args[i]);
+    }
+    for(int i=0; i<numThreads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].mErrors;
+        expected += models[i].size();
+    }
+
+    // the tree ends up holding exactly the keys of the models
+    for(uint64_t key=0; key<MODEL_KEYS; key++) {
+        errors += (tree->Search(key, 0) != nullptr) != (models[key % numThreads].count(key) != 0);
+    }
+
+    uint64_t keys;
+    bool valid = tree->CheckInvariants(&keys);
+    WindowCounters counters = tree->GetWindowCounters();
+
+    std::cout << numThreads << " threads, bucket size " << bucketSize << ": " << errors << " wrong results, "
+              << keys << "/" << expected << " keys, invariants " << (valid ? "hold" : "broken") << ", "
+              << counters.mCheap << " cheap and " << counters.mFull << " full transactions ("
+              << (double) counters.mCheap / (counters.mFull != 0 ? counters.mFull : 1)
+              << " per full)" << std::endl;
+
+    if(errors != 0 || !valid || keys != expected) {
+        exit(1);
+    }
+}
+
+int main(void)
+{
+    run(1, 0);
+    run(MODEL_THREADS, 0);
+    run(1, 16);
+    run(MODEL_THREADS, 16);
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <cstdlib>
+#include "concurrent.hpp"
+#include "time.h"
+#include "systimer.h"
+
+// compares the word-value path of ConcurrentTree<uint32_t, uint64_t>, where the
+// value sits in the leaf and is updated with one CAS, against the generic path
+// for the same 8-byte value (a pointer to a tree-owned copy behind the gate)
+
+#define TREE_KEYS   200000
+#define OPERATIONS  1000000
+
+// the same 8 bytes, kept on the generic path
+struct BoxedValue
+{
+    uint64_t mValue;
+};
+
+template <>
+struct WordValue<BoxedValue> : std::false_type {};
+
+uint64_t unbox(uint64_t *value)
+{
+    return *value;
+}
+
+uint64_t unbox(BoxedValue *value)
+{
+    return value->mValue;
+}
+
+template <class V>
+void run(const char *name, uint32_t numKeys, uint32_t *probes)
+{
+    ConcurrentTree<uint32_t, V> *tree = new ConcurrentTree<uint32_t, V>(1);
+
+    // random insertion order keeps the unbalanced tree shallow
+    uint64 time_start = GetTimeMs64();
+    for(uint32_t i=0; i<numKeys; i++) {
+        tree->InsertOrUpdate(probes[i], V{probes[i]}, 0);
+    }
+    uint64 time_insert = GetTimeMs64() - time_start;
+
+    uint64_t sum = 0;
+    time_start = GetTimeMs64();
+    for(int i=0; i<OPERATIONS; i++) {
+        V *value = tree->Search(probes[i % numKeys], 0);
+        sum += value != nullptr ? unbox(value) : 0;
+    }
+    uint64 time_search = GetTimeMs64() - time_start;
+
+    time_start = GetTimeMs64();
+    for(int i=0; i<OPERATIONS; i++) {
+        tree->InsertOrUpdate(probes[i % numKeys], V{(uint64_t) i}, 0);
+    }
+    uint64 time_update = GetTimeMs64() - time_start;
+
+    std::cout << name << " (checksum " << sum << ")" << std::endl;
+    std::cout << "  insert ns per op: " << time_insert * 1000000.0 / numKeys << std::endl;
+    std::cout << "  search ns per op: " << time_search * 1000000.0 / OPERATIONS << std::endl;
+    std::cout << "  update ns per op: " << time_update * 1000000.0 / OPERATIONS << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    srand(time(NULL));
+
+    uint32_t numKeys = argc > 1 ? strtoul(argv[1], nullptr, 10) : TREE_KEYS;
+
+    // distinct keys in random order
+    uint32_t *probes = (uint32_t *) malloc(numKeys * sizeof(uint32_t));
+    for(uint32_t i=0; i<numKeys; i++) {
+        probes[i] = i;
+    }
+    for(uint32_t i=numKeys - 1; i>0; i--) {
+        uint32_t j = (((uint32_t) rand() << 15) ^ rand()) % (i + 1);
+        uint32_t key = probes[i];
+        probes[i] = probes[j];
+        probes[j] = key;
+    }
+
+    run<uint64_t>("word values", numKeys, probes);
+    run<BoxedValue>("generic values", numKeys, probes);
+
+    free(probes);
+}
@@ -0,0 +1,67 @@
+#ifndef _THREAD_COUNTERS_HPP_
+#define _THREAD_COUNTERS_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// per-thread statistics, padded so threads do not share lines. Counters is a
+// plain struct of uint64_t fields, which Sum adds up field by field; state a
+// thread keeps beside its counters lives elsewhere, since it does not add up
+template <class Counters>
+class ThreadCounters
+{
+public:
+    static_assert(std::is_trivially_copyable<Counters>::value && sizeof(Counters) % sizeof(uint64_t) == 0,
+                  "counters must be a plain struct of uint64_t fields");
+
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        Counters mCounters;
+    };
+
+    Slot *mSlots;
+    uint32_t mNumThreads;
+
+    void InitializeThreadCounters(uint32_t numThreads)
+    {
+        mNumThreads = numThreads;
+        mSlots = (Slot *) aligned_alloc(CACHE_LINE_SIZE, sizeof(Slot) * numThreads);
+        memset((void *) mSlots, 0, sizeof(Slot) * numThreads);
+    }
+
+    Counters &operator[](int myid)
+    {
+        return mSlots[myid].mCounters;
+    }
+
+    // adds every field of counters to the same field of *total
+    static void Add(Counters *total, const Counters &counters)
+    {
+        uint64_t *to = (uint64_t *) total;
+        const uint64_t *from = (const uint64_t *) &counters;
+        for(size_t i=0; i<sizeof(Counters) / sizeof(uint64_t); i++) {
+            to[i] += from[i];
+        }
+    }
+
+    // every thread's counters added up
+    Counters Sum()
+    {
+        Counters total;
+        memset((void *) &total, 0, sizeof(total));
+
+        for(uint32_t i=0; i<mNumThreads; i++) {
+            Add(&total, mSlots[i].mCounters);
+        }
+
+        return total;
+    }
+};
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef _TL2_STM_HPP_
+#define _TL2_STM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// word-based software transactional memory after TL2 (Dice, Shalev, Shavit): a
+// global version clock, a table of versioned locks striped over addresses, and
+// per-thread read and write sets. a transaction reads at the clock value it began
+// with, buffers its writes, and at commit locks the stripes it writes, takes a
+// new clock value, revalidates its reads and writes back. it exposes the macros
+// tree_policies.hpp is written against:
+//   TM_BEGIN(); ... TM_READ(var) ... TM_WRITE(var, value) ... TM_END();
+// runs the statements between the two as one transaction, re-executing them
+// after a conflict, and TM_ALLOC(size) allocates from the calling thread's slab
+
+// number of versioned locks; addresses map onto them by their 8-byte word
+#define TL2_LOCK_STRIPES ((uint64_t) 1 << 18)
+// initial capacity of the read and write sets, doubled when full
+#define TL2_SET_CAPACITY 64
+// bytes carved out of one TM_ALLOC slab
+#define TL2_ALLOC_CHUNK ((size_t) 1 << 20)
+// upper bound of the spin before an aborted transaction retries, doubled per abort
+#define TL2_MAX_BACKOFF 1024
+
+// thrown by a read or commit that found a conflict; caught by TM_END
+struct TL2Abort {};
+
+struct TL2Write
+{
+    void *mAddress;
+    uint64_t mValue;
+    uint32_t mSize;
+};
+
+struct TL2Lock
+{
+    uint64_t *mLock;
+    // version the stripe had before it was locked, for validating reads from it
+    uint64_t mVersion;
+};
+
+// kept in each thread's descriptor, which is padded already
+struct TL2Counters
+{
+    uint64_t mCommits;
+    uint64_t mAborts;
+};
+
+class alignas(CACHE_LINE_SIZE) TL2Transaction
+{
+public:
+    uint64_t mReadVersion;
+    uint64_t **mReads;
+    uint32_t mNumReads;
+    uint32_t mReadCapacity;
+    TL2Write *mWrites;
+    uint32_t mNumWrites;
+    uint32_t mWriteCapacity;
+    // one bit per address hash of the write set, so most reads skip searching it
+    uint64_t mWriteFilter;
+    TL2Lock *mLocked;
+    uint32_t mNumLocked;
+    uint32_t mBackoff;
+    // thread-local allocation; what an aborted attempt allocated is handed out again
+    char *mChunk;
+    size_t mChunkUsed;
+    size_t mChunkMark;
+    TL2Counters mCounters;
+    // every thread's descriptor, for GetTL2Counters
+    TL2Transaction *mNext;
+
+    static inline uint64_t sClock = 0;
+    // a lock word holds version << 1 while free, and the owning transaction | 1 while locked
+    static inline uint64_t *sLocks = nullptr;
+    static inline TL2Transaction *sTransactions = nullptr;
+    static inline thread_local TL2Transaction *tCurrent = nullptr;
+
+    void InitializeTL2Transaction()
+    {
+        mReadVersion = 0;
+        mReadCapacity = TL2_SET_CAPACITY;
+        mReads = (uint64_t **) malloc(sizeof(uint64_t *) * mReadCapacity);
+        mNumReads = 0;
+        mWriteCapacity = TL2_SET_CAPACITY;
+        mWrites = (TL2Write *) malloc(sizeof(TL2Write) * mWriteCapacity);
+        mNumWrites = 0;
+        mWriteFilter = 0;
+        mLocked = (TL2Lock *) malloc(sizeof(TL2Lock) * mWriteCapacity);
+        mNumLocked = 0;
+        mBackoff = 1;
+        mChunk = nullptr;
+        mChunkUsed = TL2_ALLOC_CHUNK;
+        mChunkMark = TL2_ALLOC_CHUNK;
+        mCounters = {0, 0};
+    }
+
+    // the calling thread's descriptor, created on its first transaction
+    static TL2Transaction *Current()
+    {
+        if(tCurrent == nullptr) {
+            tCurrent = Create();
+        }
+
+        return tCurrent;
+    }
+
+    static TL2Transaction *Create()
+    {
+        // the lock table is set up by whichever thread gets there first
+        if(__atomic_load_n(&sLocks, __ATOMIC_ACQUIRE) == nullptr) {
+            uint64_t *locks = (uint64_t *) calloc(TL2_LOCK_STRIPES, sizeof(uint64_t));
+            if(!__sync_bool_compare_and_swap(&sLocks, nullptr, locks)) {
+                free(locks);
+            }
+        }
+
+        auto tx = (TL2Transaction *) aligned_alloc(CACHE_LINE_SIZE, sizeof(TL2Transaction));
+        tx->InitializeTL2Transaction();
+
+        do {
+            tx->mNext = __atomic_load_n(&sTransactions, __ATOMIC_ACQUIRE);
+        } while(!__sync_bool_compare_and_swap(&sTransactions, tx->mNext, tx));
+
+        return tx;
+    }
+
+    static uint64_t *LockFor(const void *address)
+    {
+        return &sLocks[((uintptr_t) address >> 3) & (TL2_LOCK_STRIPES - 1)];
+    }
+
+    static uint64_t FilterBit(const void *address)
+    {
+        return (uint64_t) 1 << (((uintptr_t) address >> 3) & 63);
+    }
+
+    void Begin()
+    {
+        mNumReads = 0;
+        mNumWrites = 0;
+        mWriteFilter = 0;
+        mNumLocked = 0;
+        mChunkMark = mChunkUsed;
+        mReadVersion = __atomic_load_n(&sClock, __ATOMIC_ACQUIRE);
+    }
+
+    template <class T>
+    T Read(T *address)
+    {
+        static_assert(std::is_trivially_copyable<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8),
+                      "transactional accesses are to single words");
+
+        // the transaction sees its own writes, the latest one to the address
+        if((mWriteFilter & FilterBit(address)) != 0) {
+            for(uint32_t i=mNumWrites; i-->0;) {
+                if(mWrites[i].mAddress == address) {
+                    T value;
+                    memcpy(&value, &mWrites[i].mValue, sizeof(T));
+                    return value;
+                }
+            }
+        }
+
+        // the value is consistent if its stripe was free and unchanged around the
+        // load, and not written since the transaction began
+        uint64_t *lock = LockFor(address);
+        uint64_t before = __atomic_load_n(lock, __ATOMIC_ACQUIRE);
+
+        T value;
+        __atomic_load(address, &value, __ATOMIC_RELAXED);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t after = __atomic_load_n(lock, __ATOMIC_RELAXED);
+        if(before != after || (before & 1) != 0 || (before >> 1) > mReadVersion) {
+            throw TL2Abort();
+        }
+
+        if(mNumReads == mReadCapacity) {
+            mReadCapacity *= 2;
+            mReads = (uint64_t **) realloc(mReads, sizeof(uint64_t *) * mReadCapacity);
+        }
+        mReads[mNumReads++] = lock;
+
+        return value;
+    }
+
+    template <class T>
+    void Write(T *address, T value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8),
+                      "transactional accesses are to single words");
+
+        if(mNumWrites == mWriteCapacity) {
+            mWriteCapacity *= 2;
+            mWrites = (TL2Write *) realloc(mWrites, sizeof(TL2Write) * mWriteCapacity);
+            mLocked = (TL2Lock *) realloc(mLocked, sizeof(TL2Lock) * mWriteCapacity);
+        }
+
+        TL2Write *write = &mWrites[mNumWrites++];
+        write->mAddress = address;
+        write->mValue = 0;
+        memcpy(&write->mValue, &value, sizeof(T));
+        write->mSize = sizeof(T);
+        mWriteFilter |= FilterBit(address);
+    }
+
+    // false if the transaction conflicted and has to run again
+    bool Commit()
+    {
+        // a read-only transaction was consistent at its read version all along
+        if(mNumWrites == 0) {
+            mCounters.mCommits++;
+            mBackoff = 1;
+            return true;
+        }
+
+        uint64_t locked = (uint64_t) this | 1;
+
+        for(uint32_t i=0; i<mNumWrites; i++) {
+            uint64_t *lock = LockFor(mWrites[i].mAddress);
+            uint64_t current = __atomic_load_n(lock, __ATOMIC_ACQUIRE);
+
+            if(current == locked) {
+                continue;
+            }
+
+            if((current & 1) != 0 || !__sync_bool_compare_and_swap(lock, current, locked)) {
+                Unlock();
+                return false;
+            }
+
+            mLocked[mNumLocked++] = {lock, current >> 1};
+        }
+
+        uint64_t writeVersion = __sync_add_and_fetch(&sClock, 1);
+
+        // nothing committed since the transaction began, so its reads are still valid
+        if(writeVersion != mReadVersion + 1 && !ValidateReads(locked)) {
+            Unlock();
+            return false;
+        }
+
+        for(uint32_t i=0; i<mNumWrites; i++) {
+            TL2Write *write = &mWrites[i];
+            switch(write->mSize) {
+            case 1:
+                __atomic_store_n((uint8_t *) write->mAddress, (uint8_t) write->mValue, __ATOMIC_RELAXED);
+                break;
+            case 2:
+                __atomic_store_n((uint16_t *) write->mAddress, (uint16_t) write->mValue, __ATOMIC_RELAXED);
+                break;
+            case 4:
+                __atomic_store_n((uint32_t *) write->mAddress, (uint32_t) write->mValue, __ATOMIC_RELAXED);
+                break;
+            default:
+                __atomic_store_n((uint64_t *) write->mAddress, write->mValue, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+
+        // the release of each lock publishes the write-back to the next reader of the stripe
+        for(uint32_t i=0; i<mNumLocked; i++) {
+            __atomic_store_n(mLocked[i].mLock, writeVersion << 1, __ATOMIC_RELEASE);
+        }
+
+        mNumLocked = 0;
+        mCounters.mCommits++;
+        mBackoff = 1;
+        return true;
+    }
+
+    bool ValidateReads(uint64_t locked)
+    {
+        for(uint32_t i=0; i<mNumReads; i++) {
+            uint64_t current = __atomic_load_n(mReads[i], __ATOMIC_ACQUIRE);
+            uint64_t version = current >> 1;
+
+            if(current == locked) {
+                // locked by this commit; what matters is the version it had before
+                for(uint32_t j=0; j<mNumLocked; j++) {
+                    if(mLocked[j].mLock == mReads[i]) {
+                        version = mLocked[j].mVersion;
+                        break;
+                    }
+                }
+            }
+            else if((current & 1) != 0) {
+                return false;
+            }
+
+            if(version > mReadVersion) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // unlocks the stripes locked so far without changing their versions
+    void Unlock()
+    {
+        for(uint32_t i=0; i<mNumLocked; i++) {
+            __atomic_store_n(mLocked[i].mLock, mLocked[i].mVersion << 1, __ATOMIC_RELEASE);
+        }
+
+        mNumLocked = 0;
+    }
+
+    // after a conflict: forget the attempt, including its allocations, and back off
+    void Abort()
+    {
+        Unlock();
+        mChunkUsed = mChunkMark;
+        mCounters.mAborts++;
+
+        for(volatile uint32_t i=0; i<mBackoff; i++);
+        if(mBackoff < TL2_MAX_BACKOFF) {
+            mBackoff *= 2;
+        }
+    }
+
+    void *Allocate(size_t bytes)
+    {
+        bytes = (bytes + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        if(bytes > TL2_ALLOC_CHUNK / 4) {
+            return malloc(bytes);
+        }
+
+        if(mChunkUsed + bytes > TL2_ALLOC_CHUNK) {
+            mChunk = (char *) aligned_alloc(CACHE_LINE_SIZE, TL2_ALLOC_CHUNK);
+            mChunkUsed = 0;
+            mChunkMark = 0;
+        }
+
+        void *memory = mChunk + mChunkUsed;
+        mChunkUsed += bytes;
+        return memory;
+    }
+};
+
+// commits and aborts of every thread's transactions so far
+inline TL2Counters GetTL2Counters()
+{
+    TL2Counters total = {0, 0};
+
+    for(TL2Transaction *tx = __atomic_load_n(&TL2Transaction::sTransactions, __ATOMIC_ACQUIRE); tx != nullptr; tx = tx->mNext) {
+        ThreadCounters<TL2Counters>::Add(&total, tx->mCounters);
+    }
+
+    return total;
+}
+
+#define TM_BEGIN() \
+    for(TL2Transaction *tm_tx = TL2Transaction::Current();; tm_tx->Abort()) { \
+        try { \
+            tm_tx->Begin();
+
+#define TM_END() \
+            if(tm_tx->Commit()) { \
+                break; \
+            } \
+        } \
+        catch(TL2Abort &) {} \
+    } do {} while(0)
+
+#define TM_READ(var) (tm_tx->Read(&(var)))
+#define TM_WRITE(var, value) (tm_tx->Write(&(var), (std::remove_reference_t<decltype(var)>) (value)))
+#define TM_ALLOC(size) (TL2Transaction::Current()->Allocate(size))
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef _TRANSACTION_LOCKS_HPP_
+#define _TRANSACTION_LOCKS_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include "key_hash.hpp"
+#include "thread_counters.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// keys (counting the targets of moves) one Transact call may touch
+#define TRANSACTION_MAX_KEYS 16
+// upper bound of the spin before a transaction that found a stripe taken retries;
+// past it the thread yields, in case the holder is not running
+#define TRANSACTION_MAX_BACKOFF 1024
+// attempts on a taken stripe before a single-key operation or search yields
+#define TRANSACTION_SPINS 64
+// a transaction applying its operations, in the low half of TransactionLocks::mApplying
+#define TRANSACTION_APPLYING 1
+// the version in the high half of mApplying, bumped as a transaction finishes
+#define TRANSACTION_APPLIED ((uint64_t) 1 << 32)
+
+// an operation of a Transact call:
+//   TX_INSERT  inserts mKey with mValue, or updates it if present
+//   TX_UPDATE  sets the value of mKey to mValue only if mKey is present
+//   TX_DELETE  removes mKey
+//   TX_MOVE    moves the value of mKey to mTarget, replacing any value there;
+//              nothing changes if mKey is absent
+//   TX_ADD     adds mValue to the value of mKey if mKey is present; arithmetic
+//              value types only
+enum TransactionType {TX_INSERT, TX_UPDATE, TX_DELETE, TX_MOVE, TX_ADD};
+
+template <class K, class V>
+struct TransactionOp
+{
+    TransactionType mType;
+    K mKey;
+    V mValue;
+    K mTarget;
+};
+
+struct TransactionCounters
+{
+    uint64_t mCommits;
+    // attempts that found one of their stripes taken and started over
+    uint64_t mAborts;
+    // searches that raced with a transaction on their key's stripe and looked again
+    uint64_t mSearchRetries;
+    // single-key writes that found their stripe held by a transaction and waited
+    uint64_t mWriteWaits;
+};
+
+// a thread's side of the stripes, read by transactions waiting out its write;
+// padded so threads do not share lines
+struct alignas(CACHE_LINE_SIZE) StripeWriter
+{
+    // stripe of the single-key write the thread is applying, nullptr between writes
+    uint64_t *mWriting;
+    uint32_t mBackoff;
+};
+
+// versioned locks striped over key hashes. a Transact call takes the stripes of
+// all its keys in address order, so transactions on disjoint stripes run in
+// parallel. a single-key modification takes no lock: it announces its stripe in
+// its thread's StripeWriter and goes ahead if no transaction holds the stripe, and a
+// transaction waits out the writes announced on its stripes before it applies
+// anything. a search reads between two transactions on its key's stripe. a stripe
+// word holds the owning thread + 1 in its low half (0 while free) and a version
+// bumped by every release in its high half
+class TransactionLocks
+{
+public:
+    uint64_t *mStripes;
+    uint64_t mMask;
+    // transactions applying their operations in the low half, and the number that
+    // finished in the high half; lookups that have no single key to take the
+    // stripe of, like PeekMin, read between two changes of it
+    uint64_t *mApplying;
+    StripeWriter *mWriters;
+    ThreadCounters<TransactionCounters> mCounters;
+    uint32_t mNumThreads;
+
+    void InitializeTransactionLocks(uint64_t numStripes, uint32_t numThreads)
+    {
+        uint64_t size = 64;
+        while(size < numStripes) {
+            size <<= 1;
+        }
+
+        mStripes = (uint64_t *) aligned_alloc(CACHE_LINE_SIZE, sizeof(uint64_t) * size);
+        memset(mStripes, 0, sizeof(uint64_t) * size);
+        mMask = size - 1;
+
+        mApplying = (uint64_t *) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE);
+        *mApplying = 0;
+
+        mNumThreads = numThreads;
+        mCounters.InitializeThreadCounters(numThreads);
+        mWriters = (StripeWriter *) aligned_alloc(CACHE_LINE_SIZE, sizeof(StripeWriter) * numThreads);
+        for(uint32_t i=0; i<numThreads; i++) {
+            mWriters[i].mWriting = nullptr;
+            mWriters[i].mBackoff = 1;
+        }
+    }
+
+    uint64_t *StripeOf(uint64_t hash)
+    {
+        return &mStripes[(hash >> 32) & mMask];
+    }
+
+    static uint64_t Owner(uint64_t word)
+    {
+        return word & UINT32_MAX;
+    }
+
+    bool Holds(uint64_t *stripe, int myid)
+    {
+        return Owner(__atomic_load_n(stripe, __ATOMIC_RELAXED)) == (uint64_t) myid + 1;
+    }
+
+    bool TryLock(uint64_t *stripe, int myid)
+    {
+        uint64_t word = __atomic_load_n(stripe, __ATOMIC_RELAXED);
+        return Owner(word) == 0 && __sync_bool_compare_and_swap(stripe, word, word | ((uint64_t) myid + 1));
+    }
+
+    // announces a single-key write on the stripe once no transaction holds it. the
+    // write announces itself before checking the stripe and a transaction takes the
+    // stripe before checking the announcements, so at least one of them sees the
+    // other: either the write waits for the transaction, or the transaction for it
+    void BeginWrite(uint64_t *stripe, int myid)
+    {
+        StripeWriter *writer = &mWriters[myid];
+
+        while(true) {
+            __atomic_store_n(&writer->mWriting, stripe, __ATOMIC_SEQ_CST);
+            if(Owner(__atomic_load_n(stripe, __ATOMIC_SEQ_CST)) == 0) {
+                return;
+            }
+
+            __atomic_store_n(&writer->mWriting, (uint64_t *) nullptr, __ATOMIC_RELEASE);
+            mCounters[myid].mWriteWaits++;
+            BeginRead(stripe);
+        }
+    }
+
+    void EndWrite(int myid)
+    {
+        __atomic_store_n(&mWriters[myid].mWriting, (uint64_t *) nullptr, __ATOMIC_RELEASE);
+    }
+
+    bool Writing(uint64_t *stripe, int myid)
+    {
+        return mWriters[myid].mWriting == stripe;
+    }
+
+    void Unlock(uint64_t *stripe)
+    {
+        uint64_t word = __atomic_load_n(stripe, __ATOMIC_RELAXED);
+        __atomic_store_n(stripe, ((word >> 32) + 1) << 32, __ATOMIC_RELEASE);
+    }
+
+    // locks every stripe of a sorted, duplicate-free list, or none of them if one
+    // is taken; a failed attempt backs off before the caller tries again
+    bool TryLockAll(uint64_t **stripes, uint32_t count, int myid)
+    {
+        StripeWriter *writer = &mWriters[myid];
+
+        for(uint32_t i=0; i<count; i++) {
+            if(!TryLock(stripes[i], myid)) {
+                while(i-- > 0) {
+                    // nothing changed under these, so their versions stay
+                    __atomic_store_n(stripes[i], __atomic_load_n(stripes[i], __ATOMIC_RELAXED) & ~(uint64_t) UINT32_MAX, __ATOMIC_RELEASE);
+                }
+
+                mCounters[myid].mAborts++;
+                if(writer->mBackoff < TRANSACTION_MAX_BACKOFF) {
+                    for(volatile uint32_t j=0; j<writer->mBackoff; j++);
+                    writer->mBackoff *= 2;
+                }
+                else {
+                    sched_yield();
+                }
+                return false;
+            }
+        }
+
+        writer->mBackoff = 1;
+
+        // single-key writes that announced themselves on these stripes before they
+        // were taken finish first; they never wait on a stripe once announced
+        for(uint32_t i=0; i<mNumThreads; i++) {
+            if(i == (uint32_t) myid) {
+                continue;
+            }
+
+            uint64_t *writing;
+            for(uint32_t spins = 1; (writing = __atomic_load_n(&mWriters[i].mWriting, __ATOMIC_SEQ_CST)) != nullptr &&
+                                    std::binary_search(stripes, stripes + count, writing); spins++) {
+                if(spins % TRANSACTION_SPINS == 0) {
+                    sched_yield();
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // marks a transaction that holds its stripes as applying its operations, for
+    // BeginReadAll, and as finished
+    void BeginApply()
+    {
+        __atomic_fetch_add(mApplying, TRANSACTION_APPLYING, __ATOMIC_SEQ_CST);
+    }
+
+    void EndApply()
+    {
+        __atomic_fetch_add(mApplying, TRANSACTION_APPLIED - TRANSACTION_APPLYING, __ATOMIC_RELEASE);
+    }
+
+    // the stripe's word once no transaction holds it, to be compared after the read
+    uint64_t BeginRead(uint64_t *stripe)
+    {
+        uint64_t word;
+        for(uint32_t spins = 1; Owner(word = __atomic_load_n(stripe, __ATOMIC_ACQUIRE)) != 0; spins++) {
+            if(spins % TRANSACTION_SPINS == 0) {
+                sched_yield();
+            }
+        }
+        return word;
+    }
+
+    bool EndRead(uint64_t *stripe, uint64_t word, int myid)
+    {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(stripe, __ATOMIC_RELAXED) == word) {
+            return true;
+        }
+
+        mCounters[myid].mSearchRetries++;
+        return false;
+    }
+
+    // as BeginRead and EndRead, for a lookup ordered against every transaction
+    uint64_t BeginReadAll()
+    {
+        return BeginRead(mApplying);
+    }
+
+    bool EndReadAll(uint64_t word, int myid)
+    {
+        return EndRead(mApplying, word, myid);
+    }
+
+    TransactionCounters GetCounters()
+    {
+        return mCounters.Sum();
+    }
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _TREE_ENGINE_HPP_
+#define _TREE_ENGINE_HPP_
+
+#include "concurrent.hpp"
+#include "external_bst.hpp"
+#include "skip_list.hpp"
+
+// the engine behind TreeEngine, chosen at compile time: the window-transaction
+// ConcurrentTree by default, the lock-free external BST with -DEXTERNAL_BST_ENGINE or
+// the lock-free skip list with -DSKIP_LIST_ENGINE. all are constructed from the number
+// of threads and offer Search, SearchRecord, InsertOrUpdate, Delete and Quiesce with
+// the same value records
+#if defined(EXTERNAL_BST_ENGINE)
+template <class K, class V, class Compare = std::less<K>, class AllocPolicy = MallocAlloc>
+using TreeEngine = LockFreeBST<K, V, Compare, AllocPolicy>;
+#elif defined(SKIP_LIST_ENGINE)
+template <class K, class V, class Compare = std::less<K>, class AllocPolicy = MallocAlloc>
+using TreeEngine = LockFreeSkipList<K, V, Compare, AllocPolicy>;
+#else
+template <class K, class V, class Compare = std::less<K>, class AllocPolicy = MallocAlloc>
+using TreeEngine = ConcurrentTree<K, V, Compare, AllocPolicy>;
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef _TREE_POLICIES_HPP_
+#define _TREE_POLICIES_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// the transactional policies are written against the usual STM interface:
+// TM_BEGIN()/TM_END() delimit a transaction, TM_READ/TM_WRITE access a shared
+// word inside it and TM_ALLOC allocates. unless an STM such as RSTM defined
+// them before this header, they come from the built-in TL2 backend
+#ifndef TM_BEGIN
+#include "tl2_stm.hpp"
+#endif
+
+// keeps the value arguments of the synchronization policies out of template
+// argument deduction, so CompareAndSwap(&mResult, nullptr, pResult) deduces from the address
+template <class T>
+struct SyncValue
+{
+    typedef T type;
+};
+
+// allocation policies: where the tree's nodes, operation records, states, positions,
+// leaf buckets and bucket records come from. nothing the protocol published is
+// freed, since a helper may still read a record or node long after it left the
+// tree; Free is only called on memory no other thread has seen
+
+// operator new
+struct NewAlloc
+{
+    static void *Allocate(size_t bytes, size_t alignment)
+    {
+        if(alignment > alignof(std::max_align_t)) {
+            return ::operator new(bytes, std::align_val_t(alignment));
+        }
+
+        return ::operator new(bytes);
+    }
+
+    static void Free(void *memory, size_t bytes, size_t alignment)
+    {
+        if(alignment > alignof(std::max_align_t)) {
+            ::operator delete(memory, bytes, std::align_val_t(alignment));
+            return;
+        }
+
+        ::operator delete(memory, bytes);
+    }
+};
+
+// malloc, which only guarantees 16-byte alignment, so cache-line aligned data
+// nodes go through aligned_alloc
+struct MallocAlloc
+{
+    static void *Allocate(size_t bytes, size_t alignment)
+    {
+        if(alignment > alignof(std::max_align_t)) {
+            return aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+        }
+
+        return malloc(bytes);
+    }
+
+    static void Free(void *memory, size_t bytes, size_t alignment)
+    {
+        free(memory);
+    }
+};
+
+// the STM's allocator, over-allocating to align
+struct TMAlloc
+{
+    static void *Allocate(size_t bytes, size_t alignment)
+    {
+        if(alignment > alignof(std::max_align_t)) {
+            uintptr_t memory = (uintptr_t) TM_ALLOC(bytes + alignment - 1);
+            return (void *) ((memory + alignment - 1) & ~(uintptr_t) (alignment - 1));
+        }
+
+        return TM_ALLOC(bytes);
+    }
+
+    // the slabs are carved sequentially and never returned, so there is nothing to give back
+    static void Free(void *memory, size_t bytes, size_t alignment)
+    {
+    }
+};
+
+// synchronization policies: how the protocol loads, stores, CASes and counts on
+// the words it shares between threads (links, owner words, operation states and
+// results). plain traversal reads of links are the same for every policy
+
+// hardware atomics
+struct AtomicSync
+{
+    template <class T>
+    static T Load(T *address)
+    {
+        return __atomic_load_n(address, __ATOMIC_ACQUIRE);
+    }
+
+    template <class T>
+    static void Store(T *address, typename SyncValue<T>::type value)
+    {
+        __atomic_store_n(address, value, __ATOMIC_RELEASE);
+    }
+
+    template <class T>
+    static bool CompareAndSwap(T *address, typename SyncValue<T>::type expected, typename SyncValue<T>::type desired)
+    {
+        return __sync_bool_compare_and_swap(address, expected, desired);
+    }
+
+    template <class T>
+    static T FetchAndAdd(T *address, typename SyncValue<T>::type value)
+    {
+        return __sync_fetch_and_add(address, value);
+    }
+};
+
+// every access is a small transaction, for comparing the protocol on an STM
+// against the same protocol on CAS
+struct TMSync
+{
+    template <class T>
+    static T Load(T *address)
+    {
+        T value;
+        TM_BEGIN();
+        value = TM_READ(*address);
+        TM_END();
+        return value;
+    }
+
+    template <class T>
+    static void Store(T *address, typename SyncValue<T>::type value)
+    {
+        TM_BEGIN();
+        TM_WRITE(*address, value);
+        TM_END();
+    }
+
+    template <class T>
+    static bool CompareAndSwap(T *address, typename SyncValue<T>::type expected, typename SyncValue<T>::type desired)
+    {
+        bool swapped;
+        TM_BEGIN();
+        swapped = TM_READ(*address) == expected;
+        if(swapped) {
+            TM_WRITE(*address, desired);
+        }
+        TM_END();
+        return swapped;
+    }
+
+    template <class T>
+    static T FetchAndAdd(T *address, typename SyncValue<T>::type value)
+    {
+        T previous;
+        TM_BEGIN();
+        previous = TM_READ(*address);
+        TM_WRITE(*address, previous + value);
+        TM_END();
+        return previous;
+    }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef _VALUE_ARENA_HPP_
+#define _VALUE_ARENA_HPP_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// values up to this size are stored in the value record itself
+#define VALUE_INLINE_BYTES 32
+// slots carved out of one arena allocation
+#define VALUE_ARENA_CHUNK 1024
+// retired values a thread collects between attempts to reclaim them
+#define VALUE_RETIRE_BATCH 64
+// announced by a thread that holds no values returned by the tree
+#define QUIESCENT_EPOCH UINT64_MAX
+
+// storage for one value; the free list link overlays the value once it is released
+template <class V>
+union ValueSlot
+{
+    ValueSlot<V> *mNext;
+    alignas(V) unsigned char mBytes[sizeof(V)];
+};
+
+template <class V>
+struct RetiredValue
+{
+    V *mValue;
+    // stored in a value record rather than an arena slot; destroyed but not freed
+    bool mInline;
+    uint64_t mEpoch;
+};
+
+// per-thread state, padded so threads do not share lines
+template <class V>
+struct alignas(CACHE_LINE_SIZE) ValueArenaThread
+{
+    uint64_t mEpoch;
+    ValueSlot<V> *mFree;
+    ValueSlot<V> *mChunk;
+    uint32_t mChunkUsed;
+    uint32_t mNumRetired;
+    uint32_t mRetiredCapacity;
+    RetiredValue<V> *mRetired;
+    uint64_t mAllocated;
+    uint64_t mReclaimed;
+};
+
+// owner of the values the tree copies in. values too large to be inlined live in
+// per-thread slabs; replaced and deleted values are retired and only destroyed
+// once every thread has announced a later epoch, so a value returned by the tree
+// stays valid until the thread that got it starts its next operation (or quiesces)
+template <class V>
+class ValueArena
+{
+public:
+    uint64_t mEpoch;
+    ValueArenaThread<V> *mThreads;
+    uint32_t mNumThreads;
+
+    static constexpr bool INLINE = sizeof(V) <= VALUE_INLINE_BYTES && alignof(V) <= alignof(std::max_align_t);
+
+    void InitializeValueArena(uint32_t numThreads)
+    {
+        mEpoch = 0;
+        mNumThreads = numThreads;
+
+        mThreads = (ValueArenaThread<V> *) aligned_alloc(CACHE_LINE_SIZE, sizeof(ValueArenaThread<V>) * numThreads);
+        memset((void *) mThreads, 0, sizeof(ValueArenaThread<V>) * numThreads);
+        for(uint32_t i=0; i<numThreads; i++) {
+            mThreads[i].mEpoch = QUIESCENT_EPOCH;
+            mThreads[i].mChunkUsed = VALUE_ARENA_CHUNK;
+        }
+    }
+
+    // called at the start of every operation; values obtained before are no longer used
+    void Enter(int myid)
+    {
+        __atomic_store_n(&mThreads[myid].mEpoch, __atomic_load_n(&mEpoch, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    }
+
+    void Quiesce(int myid)
+    {
+        __atomic_store_n(&mThreads[myid].mEpoch, QUIESCENT_EPOCH, __ATOMIC_RELEASE);
+    }
+
+    // an owned copy of value in an arena slot
+    V *Copy(const V &value, int myid)
+    {
+        ValueArenaThread<V> *thread = &mThreads[myid];
+        ValueSlot<V> *slot = thread->mFree;
+
+        if(slot != nullptr) {
+            thread->mFree = slot->mNext;
+        }
+        else {
+            if(thread->mChunkUsed == VALUE_ARENA_CHUNK) {
+                thread->mChunk = (ValueSlot<V> *) aligned_alloc(CACHE_LINE_SIZE, sizeof(ValueSlot<V>) * VALUE_ARENA_CHUNK);
+                thread->mChunkUsed = 0;
+            }
+            slot = &thread->mChunk[thread->mChunkUsed++];
+        }
+
+        thread->mAllocated++;
+        return new (slot->mBytes) V(value);
+    }
+
+    // frees a copy that was never published
+    void Release(V *value, int myid)
+    {
+        value->~V();
+
+        ValueSlot<V> *slot = (ValueSlot<V> *) value;
+        slot->mNext = mThreads[myid].mFree;
+        mThreads[myid].mFree = slot;
+    }
+
+    // hands over a value that is no longer reachable through the tree
+    void Retire(V *value, bool isInline, int myid)
+    {
+        ValueArenaThread<V> *thread = &mThreads[myid];
+
+        if(thread->mNumRetired == thread->mRetiredCapacity) {
+            thread->mRetiredCapacity = thread->mRetiredCapacity == 0 ? VALUE_RETIRE_BATCH : thread->mRetiredCapacity * 2;
+            thread->mRetired = (RetiredValue<V> *) realloc(thread->mRetired, sizeof(RetiredValue<V>) * thread->mRetiredCapacity);
+        }
+
+        thread->mRetired[thread->mNumRetired++] = {value, isInline, __atomic_load_n(&mEpoch, __ATOMIC_ACQUIRE)};
+
+        if(thread->mNumRetired % VALUE_RETIRE_BATCH == 0) {
+            TryAdvance();
+            Reclaim(myid);
+        }
+    }
+
+    // the epoch moves on once every active thread has announced it
+    void TryAdvance()
+    {
+        uint64_t epoch = __atomic_load_n(&mEpoch, __ATOMIC_ACQUIRE);
+
+        for(uint32_t i=0; i<mNumThreads; i++) {
+            uint64_t announced = __atomic_load_n(&mThreads[i].mEpoch, __ATOMIC_SEQ_CST);
+            if(announced != QUIESCENT_EPOCH && announced != epoch) {
+                return;
+            }
+        }
+
+        __sync_bool_compare_and_swap(&mEpoch, epoch, epoch + 1);
+    }
+
+    // destroys the values retired two or more epochs ago, when no thread can still hold them
+    void Reclaim(int myid)
+    {
+        ValueArenaThread<V> *thread = &mThreads[myid];
+        uint64_t epoch = __atomic_load_n(&mEpoch, __ATOMIC_ACQUIRE);
+        uint32_t kept = 0;
+
+        for(uint32_t i=0; i<thread->mNumRetired; i++) {
+            RetiredValue<V> retired = thread->mRetired[i];
+
+            if(retired.mEpoch + 2 > epoch) {
+                thread->mRetired[kept++] = retired;
+            }
+            else if(retired.mInline) {
+                retired.mValue->~V();
+                thread->mReclaimed++;
+            }
+            else {
+                Release(retired.mValue, myid);
+                thread->mReclaimed++;
+            }
+        }
+
+        thread->mNumRetired = kept;
+    }
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _WORD_VALUE_HPP_
+#define _WORD_VALUE_HPP_
+
+#include <type_traits>
+
+// values that fit in a machine word are kept in the value record itself and
+// updated with a single CAS, instead of behind a pointer guarded by the gate.
+// specialize to std::false_type to keep a word-sized type on the generic path
+template <class V>
+struct WordValue : std::integral_constant<bool, std::is_trivially_copyable<V>::value &&
+    (sizeof(V) == 1 || sizeof(V) == 2 || sizeof(V) == 4 || sizeof(V) == 8)> {};
+
+template <class V, bool Word = WordValue<V>::value>
+class ValueRecord;
+
+#endif